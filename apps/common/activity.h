@@ -0,0 +1,337 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Track the regions of the mesh that are not at rest.
+///
+/// A cell is disturbed when its state differs from the uniform ambient state.
+/// The vertices of a disturbed cell and the cells touching them form the
+/// first layer of active entities, and each further layer adds the vertices
+/// of the previous cells and the cells touching those.  A multi-stage scheme
+/// spreads a disturbance by one layer per stage, so it needs one layer per
+/// stage.  The vertices of the active cells are active too, so the corners of
+/// an active cell are always evaluated.  A cell or vertex that is not active
+/// sits in a uniform region at rest and its update vanishes to round-off, so
+/// the kernels only visit the active lists.
+///
+/// The cells around the boundary vertices are always active, since a
+/// boundary condition can move those vertices while the gas is at rest.
+///
+/// Inactive cells on this rank never change, so a new disturbance can only
+/// show up in an active cell that was not disturbed yet, or in a ghost cell,
+/// which is updated by the rank that owns it.  Only those cells are checked
+/// after each step, which grows the active region with the front, and lets a
+/// disturbance cross from one rank to the next.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the activity tracking.
+///////////////////////////////////////////////////////////////////////////////
+struct activity_inputs_t {
+
+  //! if true, only the active cells and vertices are updated
+  bool enabled = false;
+
+  //! the ambient density and pressure, the ambient velocity is zero
+  //! \{
+  double density = 1;
+  double pressure = 0;
+  //! \}
+
+  //! the relative tolerance used to compare against the ambient state
+  double tolerance = 1.e-12;
+
+  //! \brief return true if a state differs from the ambient one
+  //! \param [in] d,p,v  The density, pressure and velocity.
+  template< typename T, typename V >
+  bool is_disturbed( T d, T p, const V & v ) const
+  {
+    if ( std::abs( d - density ) > tolerance * density ) return true;
+    if ( std::abs( p - pressure ) > tolerance * pressure ) return true;
+    // compare the velocity against the ambient sound speed scale
+    T v2(0);
+    for ( std::size_t i=0; i<v.size(); ++i ) v2 += v[i]*v[i];
+    return v2 > tolerance * tolerance * pressure / density;
+  }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The lists of active cells and vertices on this rank.
+//!
+//! Entities are referred to by their local ids.
+///////////////////////////////////////////////////////////////////////////////
+class activity_tracker_t {
+
+public:
+
+  //! the local id type
+  using id_t = std::size_t;
+
+  //! \brief return true once the lists have been built
+  bool is_enabled() const
+  { return enabled_; }
+
+  //! \brief Build the lists from scratch.
+  //!
+  //! \param [in] mesh  The mesh.
+  //! \param [in] updated_cells  The cells whose state is updated.
+  //! \param [in] solved_vertices  The vertices whose velocity is solved for.
+  //! \param [in] num_layers  The number of layers activated around a
+  //!                         disturbed cell.
+  //! \param [in] is_disturbed  A function returning true if a cell differs
+  //!                           from the ambient state.
+  template< typename M, typename C, typename V, typename P >
+  void initialize(
+    const M & mesh, const C & updated_cells, const V & solved_vertices,
+    std::size_t num_layers, P && is_disturbed
+  ) {
+    num_layers_ = std::max<std::size_t>( num_layers, 1 );
+
+    auto num_cells = mesh.cells().size();
+    auto num_verts = mesh.vertices().size();
+
+    disturbed_.assign( num_cells, false );
+    active_cell_.assign( num_cells, false );
+    active_vertex_.assign( num_verts, false );
+    updated_cell_.assign( num_cells, false );
+    solved_vertex_.assign( num_verts, false );
+    cells_.clear();
+    vertices_.clear();
+    all_vertices_.clear();
+    front_.clear();
+    ghosts_.clear();
+
+    for ( auto c : updated_cells ) updated_cell_[c.id()] = true;
+    for ( auto v : solved_vertices ) solved_vertex_[v.id()] = true;
+
+    // the cells updated by other ranks can be disturbed at any time
+    for ( auto c : mesh.cells() )
+      if ( !updated_cell_[c.id()] ) ghosts_.emplace_back( c.id() );
+
+    // the boundary conditions may move a boundary vertex even when the
+    // cells around it are at rest, like a piston does, and those cells have
+    // to follow the new volume
+    for ( auto v : mesh.vertices() )
+      if ( v->is_boundary() )
+        for ( auto c : mesh.cells(v) ) activate_cell( mesh, c );
+
+    for ( auto c : mesh.cells() )
+      if ( is_disturbed(c) ) disturb( mesh, c );
+
+    sort();
+    enabled_ = true;
+  }
+
+  //! \brief Grow the lists with the cells that became disturbed.
+  //!
+  //! The ghost cells must be up to date, since they are checked too.
+  //! \param [in] mesh  The mesh.
+  //! \param [in] is_disturbed  See initialize.
+  //! \return the number of newly disturbed cells
+  template< typename M, typename P >
+  std::size_t update( const M & mesh, P && is_disturbed )
+  {
+    // the front changes as cells are disturbed, so work on a copy
+    std::vector<id_t> front;
+    std::swap( front, front_ );
+
+    std::size_t num_new = 0;
+    const auto & cells = mesh.cells();
+    for ( auto id : front ) {
+      if ( disturbed_[id] ) continue;
+      auto c = cells[id];
+      if ( is_disturbed(c) ) {
+        disturb( mesh, c );
+        ++num_new;
+      }
+      else {
+        front_.emplace_back( id );
+      }
+    }
+
+    for ( auto id : ghosts_ ) {
+      if ( disturbed_[id] ) continue;
+      auto c = cells[id];
+      if ( is_disturbed(c) ) {
+        disturb( mesh, c );
+        ++num_new;
+      }
+    }
+
+    if ( num_new ) sort();
+    return num_new;
+  }
+
+  //! \brief the active cells that are updated
+  const std::vector<id_t> & cells() const
+  { return cells_; }
+
+  //! \brief the active vertices that are solved for
+  const std::vector<id_t> & vertices() const
+  { return vertices_; }
+
+  //! \brief all the active vertices, including ghosts
+  const std::vector<id_t> & all_vertices() const
+  { return all_vertices_; }
+
+  //! \brief the fraction of the updated cells that are active
+  double active_fraction() const
+  {
+    auto n = std::count( updated_cell_.begin(), updated_cell_.end(), true );
+    return n ? static_cast<double>( cells_.size() ) / n : 0.;
+  }
+
+private:
+
+  //! \brief Mark a cell as disturbed and activate its neighborhood.
+  template< typename M, typename C >
+  void disturb( const M & mesh, const C & c )
+  {
+    disturbed_[c.id()] = true;
+
+    std::vector<id_t> layer, next;
+    for ( auto v : mesh.vertices(c) ) layer.emplace_back( v.id() );
+
+    const auto & vertices = mesh.vertices();
+    for ( std::size_t i=0; i<num_layers_; ++i ) {
+      next.clear();
+      for ( auto id : layer ) {
+        activate_vertex( id );
+        for ( auto neighbor : mesh.cells( vertices[id] ) ) {
+          activate_cell( mesh, neighbor );
+          for ( auto v : mesh.vertices(neighbor) ) next.emplace_back( v.id() );
+        }
+      }
+      std::sort( next.begin(), next.end() );
+      next.erase( std::unique( next.begin(), next.end() ), next.end() );
+      std::swap( layer, next );
+    }
+  }
+
+  //! \brief Activate a cell and its vertices.
+  template< typename M, typename C >
+  void activate_cell( const M & mesh, const C & c )
+  {
+    auto id = c.id();
+    if ( active_cell_[id] ) return;
+    active_cell_[id] = true;
+    if ( updated_cell_[id] ) cells_.emplace_back( id );
+    if ( !disturbed_[id] ) front_.emplace_back( id );
+    for ( auto v : mesh.vertices(c) ) activate_vertex( v.id() );
+  }
+
+  //! \brief Activate a vertex.
+  void activate_vertex( id_t id )
+  {
+    if ( active_vertex_[id] ) return;
+    active_vertex_[id] = true;
+    all_vertices_.emplace_back( id );
+    if ( solved_vertex_[id] ) vertices_.emplace_back( id );
+  }
+
+  //! \brief Keep the lists in memory order.
+  void sort()
+  {
+    std::sort( cells_.begin(), cells_.end() );
+    std::sort( vertices_.begin(), vertices_.end() );
+    std::sort( all_vertices_.begin(), all_vertices_.end() );
+  }
+
+  //! true once the lists are built
+  bool enabled_ = false;
+
+  //! the number of layers activated around a disturbed cell
+  std::size_t num_layers_ = 1;
+
+  //! per entity flags
+  //! \{
+  std::vector<bool> disturbed_;
+  std::vector<bool> active_cell_;
+  std::vector<bool> active_vertex_;
+  std::vector<bool> updated_cell_;
+  std::vector<bool> solved_vertex_;
+  //! \}
+
+  //! the active lists
+  //! \{
+  std::vector<id_t> cells_;
+  std::vector<id_t> vertices_;
+  std::vector<id_t> all_vertices_;
+  //! \}
+
+  //! the active cells that are not disturbed yet
+  std::vector<id_t> front_;
+
+  //! the cells that are updated by other ranks
+  std::vector<id_t> ghosts_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the activity tracker of this rank.
+///////////////////////////////////////////////////////////////////////////////
+inline activity_tracker_t & activity_tracker()
+{
+  static activity_tracker_t tracker;
+  return tracker;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the activity inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   activity = {
+//!     density = 1,         -- the ambient state
+//!     pressure = 1.e-6,
+//!     tolerance = 1.e-12   -- optional, relative to the ambient state
+//!   }
+//! \endcode
+//! \param [in] activity_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_activity( const T & activity_input, activity_inputs_t & inputs )
+{
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.enabled = true;
+  inputs.density = lua_try_access_as( activity_input, "density", double );
+  inputs.pressure = lua_try_access_as( activity_input, "pressure", double );
+  if ( inputs.density <= 0 || inputs.pressure <= 0 )
+    THROW_RUNTIME_ERROR( "The ambient density and pressure must be positive" );
+
+  auto tol_input = activity_input["tolerance"];
+  if ( !tol_input.empty() ) inputs.tolerance = tol_input.template as<double>();
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
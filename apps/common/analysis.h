@@ -0,0 +1,87 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Inputs that control the in situ python analysis.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <string>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the in situ python analysis.
+///////////////////////////////////////////////////////////////////////////////
+struct analysis_inputs_t {
+
+  //! the number of steps between calls, zero disables the analysis
+  std::size_t frequency = 0;
+
+  //! the python script to load
+  std::string script;
+
+  //! the function in the script to call
+  std::string function = "analyze";
+
+  //! \brief return true if the analysis should run at this step
+  bool is_due( std::size_t step ) const
+  { return frequency > 0 && step % frequency == 0; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the analysis inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   analysis = {
+//!     script = "analyze.py",
+//!     ["function"] = "analyze", -- optional
+//!     frequency = 10
+//!   }
+//! \endcode
+//! \param [in] analysis_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_analysis( const T & analysis_input, analysis_inputs_t & inputs )
+{
+#if defined(FLECSALE_ENABLE_LUA) && defined(FLECSALE_ENABLE_PYTHON)
+
+  inputs.script = lua_try_access_as( analysis_input, "script", std::string );
+  inputs.frequency =
+    lua_try_access_as( analysis_input, "frequency", std::size_t );
+
+  auto func_input = analysis_input["function"];
+  if ( !func_input.empty() )
+    inputs.function = func_input.template as<std::string>();
+
+#elif defined(FLECSALE_ENABLE_LUA)
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with python in order to use the python analysis."
+  );
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
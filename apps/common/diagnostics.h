@@ -0,0 +1,262 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Utilities for streaming global diagnostics and point probes.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The global quantities tracked by the diagnostics stage.
+///////////////////////////////////////////////////////////////////////////////
+enum class diagnostic_t
+{
+  mass,
+  momentum,
+  total_energy,
+  min_density,
+  max_density,
+  min_pressure,
+  max_pressure,
+  shock_radius
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The probe quantities sampled at each probe location.
+///////////////////////////////////////////////////////////////////////////////
+enum class probe_t
+{
+  distance,
+  density,
+  pressure,
+  velocity
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the identity of the reduction used for a diagnostic.
+//!
+//! Each rank returns this value when it has nothing to contribute.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+constexpr T diagnostic_identity( diagnostic_t quantity )
+{
+  switch (quantity) {
+    case diagnostic_t::min_density:
+    case diagnostic_t::min_pressure:
+      return std::numeric_limits<T>::max();
+    case diagnostic_t::max_density:
+    case diagnostic_t::max_pressure:
+      return std::numeric_limits<T>::lowest();
+    default:
+      return 0;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the diagnostics stage.
+//! \tparam R  The real type.
+//! \tparam V  The vector type.
+///////////////////////////////////////////////////////////////////////////////
+template< typename R, typename V >
+struct diagnostics_inputs_u {
+
+  //! the number of steps between diagnostics, zero disables them
+  std::size_t frequency = 0;
+
+  //! write binary rows instead of csv ones
+  bool binary = false;
+
+  //! the origin used to measure the shock-front radius
+  V shock_origin = 0;
+
+  //! cells with a pressure above this value are considered shocked
+  R shock_pressure = std::numeric_limits<R>::max();
+
+  //! the point probes
+  std::vector<V> probes;
+
+  //! \brief return true if the diagnostics should run at this step
+  bool is_due( std::size_t step ) const
+  { return frequency > 0 && step % frequency == 0; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the diagnostics inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   diagnostics = {
+//!     frequency = 10,
+//!     format = "csv", -- or "binary"
+//!     shock = { origin = {0,0}, pressure = 1.e-3 },
+//!     probes = { {0.1, 0.0}, {0.2, 0.0} }
+//!   }
+//! \endcode
+//! \param [in] diag_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, typename R, typename V >
+void load_diagnostics(
+  const T & diag_input, diagnostics_inputs_u<R,V> & inputs
+) {
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.frequency =
+    lua_try_access_as( diag_input, "frequency", std::size_t );
+
+  auto format = diag_input["format"];
+  if ( !format.empty() )
+    inputs.binary = ( format.template as<std::string>() == "binary" );
+
+  auto shock_input = diag_input["shock"];
+  if ( !shock_input.empty() ) {
+    inputs.shock_origin = lua_try_access_as( shock_input, "origin", V );
+    inputs.shock_pressure = lua_try_access_as( shock_input, "pressure", R );
+  }
+
+  auto probe_input = diag_input["probes"];
+  if ( !probe_input.empty() ) {
+    inputs.probes.clear();
+    for ( int i=1; i<=probe_input.size(); ++i )
+      inputs.probes.emplace_back( probe_input[i].template as<V>() );
+  }
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Append one diagnostics row per call to a file.
+//!
+//! Only one rank should ever own an open writer.  The file is either a csv
+//! file with a commented header, or a binary file with a small header
+//! listing the column names, followed by rows of doubles.
+///////////////////////////////////////////////////////////////////////////////
+class diagnostics_writer_t {
+
+public:
+
+  //! the type used for every column
+  using value_t = double;
+
+  //! \brief Open the file and write the header.
+  //! \param [in] filename  The name of the file to write.
+  //! \param [in] columns  The names of the columns.
+  //! \param [in] binary  If true, write binary rows.
+  diagnostics_writer_t(
+    const std::string & filename,
+    const std::vector<std::string> & columns,
+    bool binary
+  ) : num_columns_(columns.size()), binary_(binary)
+  {
+    auto mode = binary_ ? std::ios::out | std::ios::binary : std::ios::out;
+    file_.open( filename, mode );
+    if ( !file_.good() )
+      THROW_RUNTIME_ERROR( "Could not open \"" << filename << "\"" );
+
+    if ( binary_ ) {
+      uint64_t n = num_columns_;
+      file_.write( magic, sizeof(magic) );
+      file_.write( reinterpret_cast<const char*>(&n), sizeof(n) );
+      for ( const auto & c : columns )
+        file_.write( c.c_str(), c.size()+1 );
+    }
+    else {
+      file_.precision( std::numeric_limits<value_t>::max_digits10 );
+      file_.setf( std::ios::scientific );
+      file_ << "#";
+      for ( const auto & c : columns ) file_ << " " << c;
+      file_ << std::endl;
+    }
+  }
+
+  //! \brief Append a row.
+  //! \param [in] row  The values to write, one per column.
+  void write( const std::vector<value_t> & row )
+  {
+    if ( row.size() != num_columns_ )
+      THROW_RUNTIME_ERROR(
+        "Expected " << num_columns_ << " diagnostics, got " << row.size()
+      );
+
+    if ( binary_ ) {
+      file_.write(
+        reinterpret_cast<const char*>(row.data()),
+        row.size()*sizeof(value_t)
+      );
+    }
+    else {
+      for ( std::size_t i=0; i<row.size(); ++i )
+        file_ << (i ? " " : "") << row[i];
+      file_ << "\n";
+    }
+
+    // rows are small, make sure they survive a crash
+    file_.flush();
+  }
+
+private:
+
+  //! the magic string at the start of binary files
+  static constexpr char magic[8] = {'F','L','E','C','D','I','A','G'};
+
+  //! the output stream
+  std::ofstream file_;
+  //! the number of columns
+  std::size_t num_columns_ = 0;
+  //! true if binary output is requested
+  bool binary_ = false;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Build the list of diagnostics column names.
+//! \param [in] num_dims  The number of dimensions.
+//! \param [in] num_probes  The number of probes.
+///////////////////////////////////////////////////////////////////////////////
+inline auto diagnostics_columns( std::size_t num_dims, std::size_t num_probes )
+{
+  std::vector<std::string> cols{ "step", "time", "mass" };
+  for ( std::size_t d=0; d<num_dims; ++d )
+    cols.emplace_back( "momentum(" + std::to_string(d) + ")" );
+  cols.insert( cols.end(), {
+    "total_energy", "min_density", "max_density", "min_pressure",
+    "max_pressure", "shock_radius"
+  } );
+  for ( std::size_t i=0; i<num_probes; ++i ) {
+    auto name = "probe" + std::to_string(i);
+    cols.emplace_back( name + ":density" );
+    cols.emplace_back( name + ":pressure" );
+    for ( std::size_t d=0; d<num_dims; ++d )
+      cols.emplace_back( name + ":velocity(" + std::to_string(d) + ")" );
+  }
+  return cols;
+}
+
+} // namespace
+} // namespace
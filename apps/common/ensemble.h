@@ -0,0 +1,286 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Run several members of a parameter sweep on one mesh.
+///
+/// Reading, partitioning and setting up the mesh often takes longer than a
+/// short run on it.  An ensemble sets the mesh up once and holds the state of
+/// every member side by side, in fixed size arrays inside the cell and face
+/// fields.  A face loop gathers the connectivity and geometry once, and then
+/// evaluates the flux of every member; the cell updates do the same.  Each
+/// member has its own equation of state and initial conditions.  The initial
+/// conditions get the member number as an extra argument, so one script can
+/// hold the whole sweep.
+///
+/// The members either share the smallest time step of them all, and stay on
+/// one clock, or each takes its own stable step and keeps its own clock.
+/// At most FLECSALE_ENSEMBLE_WIDTH members fit in one run.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+//! the most members the ensemble fields hold
+constexpr std::size_t max_ensemble_members = FLECSALE_ENSEMBLE_WIDTH;
+
+//! one value per ensemble member, the unused ones at the end are ignored
+template< typename T >
+using member_array_t = std::array< T, max_ensemble_members >;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief How the ensemble members pick their time steps.
+///////////////////////////////////////////////////////////////////////////////
+enum class ensemble_time_step_t
+{
+  //! every member takes the smallest stable step of them all
+  shared,
+  //! every member takes its own stable step
+  independent
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Convert an ensemble time step name to its enum.
+//! \param [in] name  One of "shared" or "independent".
+///////////////////////////////////////////////////////////////////////////////
+inline ensemble_time_step_t ensemble_time_step( const std::string & name )
+{
+  if ( name == "shared" )
+    return ensemble_time_step_t::shared;
+  else if ( name == "independent" )
+    return ensemble_time_step_t::independent;
+  else
+    THROW_RUNTIME_ERROR( "Unknown ensemble time step \"" << name << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs of one ensemble member that differ from the base case.
+///////////////////////////////////////////////////////////////////////////////
+struct ensemble_member_t {
+
+  //! the specific heat ratio, zero keeps the base one
+  double gas_constant = 0;
+
+  //! the specific heat at constant volume, zero keeps the base one
+  double specific_heat = 0;
+
+  //! \brief Return the equation of state of this member.
+  //! \param [in] base  The equation of state of the base case.
+  template< typename E >
+  E eos( const E & base ) const
+  {
+    auto eos = base;
+    if ( gas_constant > 0 ) eos.set_gamma( gas_constant );
+    if ( specific_heat > 0 ) eos.set_specific_heat_v( specific_heat );
+    return eos;
+  }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The ensemble inputs, with no members for a single run.
+///////////////////////////////////////////////////////////////////////////////
+struct ensemble_inputs_t {
+
+  //! the members
+  std::vector<ensemble_member_t> members;
+
+  //! how the members pick their time steps
+  ensemble_time_step_t time_step = ensemble_time_step_t::shared;
+
+  //! \brief the number of members
+  std::size_t size() const
+  { return members.size(); }
+
+  //! \brief return true if there is an ensemble
+  bool is_enabled() const
+  { return !members.empty(); }
+
+  //! \brief Return the equation of state of every member.
+  //! \param [in] base  The equation of state of the base case.
+  template< typename E >
+  member_array_t<E> eos( const E & base ) const
+  {
+    member_array_t<E> eos;
+    eos.fill( base );
+    for ( std::size_t i=0; i<members.size(); ++i )
+      eos[i] = members[i].eos( base );
+    return eos;
+  }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The solution times of the ensemble members.
+//!
+//! With a shared time step, every member gets the same step and the times
+//! stay equal.  A member that reached the final time takes no more steps.
+///////////////////////////////////////////////////////////////////////////////
+class ensemble_clock_t {
+
+public:
+
+  //! \brief Start every member at time zero.
+  //! \param [in] num_members  The number of members.
+  //! \param [in] final_time  The time every member runs to.
+  ensemble_clock_t( std::size_t num_members, double final_time ) :
+    times_( num_members, 0 ), final_time_( final_time )
+  {}
+
+  //! \brief the number of members
+  std::size_t num_members() const
+  { return times_.size(); }
+
+  //! \brief the solution time of a member
+  double time( std::size_t member ) const
+  { return times_[member]; }
+
+  //! \brief the time a member has left, the most its next step may take
+  double remaining( std::size_t member ) const
+  { return std::max( final_time_ - times_[member], 0. ); }
+
+  //! \brief return true once a member reached the final time
+  bool is_finished( std::size_t member ) const
+  { return !( times_[member] < final_time_ ); }
+
+  //! \brief return true once every member reached the final time
+  bool is_finished() const
+  {
+    return std::all_of( times_.begin(), times_.end(),
+      [&]( double t ) { return !( t < final_time_ ); } );
+  }
+
+  //! \brief Advance the members that are not finished.
+  //!
+  //! A step that covers the time left lands on the final time exactly.
+  //! \param [in] steps  The time step of every member.
+  template< typename A >
+  void advance( const A & steps )
+  {
+    for ( std::size_t i=0; i<times_.size(); ++i ) {
+      if ( is_finished(i) ) continue;
+      double step = steps[i];
+      // a step that does not advance the time would repeat until max_steps
+      if ( !( step > 0 ) )
+        THROW_RUNTIME_ERROR( "The time step " << step << " of ensemble "
+          "member " << i+1 << " does not advance its time " << times_[i] );
+      if ( step >= remaining(i) )
+        times_[i] = final_time_;
+      else
+        times_[i] += step;
+    }
+  }
+
+private:
+
+  //! the solution time of every member
+  std::vector<double> times_;
+  //! the time every member runs to
+  double final_time_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the output prefix of one member.
+//! \param [in] prefix  The prefix of the base case.
+//! \param [in] member  The member, counted from zero.
+//! \param [in] num_members  The number of members, zero for a single run.
+///////////////////////////////////////////////////////////////////////////////
+inline std::string member_prefix(
+  const std::string & prefix, std::size_t member, std::size_t num_members
+) {
+  if ( num_members == 0 ) return prefix;
+  std::stringstream ss;
+  ss << prefix << "-member" << std::setfill('0') << std::setw(4) << member;
+  return ss.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the ensemble inputs from a lua table.
+//!
+//! The table has one entry per member, and each may override the equation
+//! of state.  The time step is optional, and shared by default.  The
+//! initial conditions get the member number, counted from one, as their
+//! last argument, for example
+//! \code
+//!   e0 = { 0.5, 1.0, 2.0 },
+//!   ensemble = {
+//!     time_step = "independent",
+//!     {}, {}, { gas_constant = 1.67 }
+//!   },
+//!   ics = function (x,y,t,member)
+//!     ... e0[member or 1] ...
+//!   end
+//! \endcode
+//! \param [in] ensemble_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_ensemble( const T & ensemble_input, ensemble_inputs_t & inputs )
+{
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.members.clear();
+  for ( int i=1; i<=ensemble_input.size(); ++i ) {
+    auto member_input = ensemble_input[i];
+    ensemble_member_t member;
+
+    auto gamma_input = member_input["gas_constant"];
+    if ( !gamma_input.empty() ) {
+      member.gas_constant = gamma_input.template as<double>();
+      if ( member.gas_constant <= 1 )
+        THROW_RUNTIME_ERROR( "The gas constant of ensemble member " << i
+          << " must be above one" );
+    }
+
+    auto cv_input = member_input["specific_heat"];
+    if ( !cv_input.empty() ) {
+      member.specific_heat = cv_input.template as<double>();
+      if ( member.specific_heat <= 0 )
+        THROW_RUNTIME_ERROR( "The specific heat of ensemble member " << i
+          << " must be positive" );
+    }
+
+    inputs.members.emplace_back( member );
+  }
+
+  if ( inputs.members.size() > max_ensemble_members )
+    THROW_RUNTIME_ERROR( "The ensemble has " << inputs.members.size()
+      << " members, but at most " << max_ensemble_members << " fit, see "
+      "FLECSALE_ENSEMBLE_WIDTH" );
+
+  auto time_step_input = ensemble_input["time_step"];
+  if ( !time_step_input.empty() )
+    inputs.time_step =
+      ensemble_time_step( time_step_input.template as<std::string>() );
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
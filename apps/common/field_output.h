@@ -0,0 +1,221 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Inputs that control the format of the field output.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/io/aggregator.h>
+#include <flecsale/io/field_file.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The formats the fields can be written in.
+///////////////////////////////////////////////////////////////////////////////
+enum class output_format_t
+{
+  exodus,
+  compressed,
+  vtu
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the field output.
+///////////////////////////////////////////////////////////////////////////////
+struct field_output_inputs_t {
+
+  //! the compression settings type
+  using compression_t = flecsale::io::compression_t;
+
+  //! the output format
+  output_format_t format = output_format_t::exodus;
+
+  //! the settings used by fields without their own entry
+  compression_t default_codec;
+
+  //! the per-field settings
+  std::map<std::string, compression_t> codecs;
+
+  //! how ranks are grouped into writers, the default is a file per rank
+  flecsale::io::aggregation_t aggregation;
+
+  //! \brief return the settings of a field
+  const compression_t & codec( const std::string & name ) const
+  {
+    auto it = codecs.find( name );
+    return it == codecs.end() ? default_codec : it->second;
+  }
+
+  //! \brief the names of the fields that can be given their own settings
+  static const std::vector<std::string> & field_names()
+  {
+    static const std::vector<std::string> names = {
+      "density", "velocity", "internal_energy", "pressure", "temperature",
+      "sound_speed"
+    };
+    return names;
+  }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the compression settings of one field from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   { mode = "lossy", absolute = 1.e-6, relative = 1.e-4 }
+//! \endcode
+//! where the tolerances are only used by the lossy mode.  When both are
+//! given, the tighter one wins.
+//! \param [in] codec_input  The lua table.
+//! \param [in,out] codec  The settings to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_compression(
+  const T & codec_input, flecsale::io::compression_t & codec
+) {
+#ifdef FLECSALE_ENABLE_LUA
+
+  codec.mode = flecsale::io::compression_mode(
+    lua_try_access_as( codec_input, "mode", std::string )
+  );
+
+  auto abs_input = codec_input["absolute"];
+  if ( !abs_input.empty() ) codec.absolute = abs_input.template as<double>();
+
+  auto rel_input = codec_input["relative"];
+  if ( !rel_input.empty() ) codec.relative = rel_input.template as<double>();
+
+  if ( codec.mode == flecsale::io::compression_mode_t::lossy &&
+       codec.absolute <= 0 && codec.relative <= 0 )
+    THROW_RUNTIME_ERROR(
+      "Lossy compression needs an absolute or relative tolerance"
+    );
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the field output inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   field_output = {
+//!     format = "compressed", -- or "exodus", or "vtu"
+//!     default = { mode = "lossless" },
+//!     fields = {
+//!       pressure = { mode = "lossy", relative = 1.e-4 },
+//!       velocity = { mode = "lossy", absolute = 1.e-6 }
+//!     },
+//!     aggregation = { ranks_per_writer = 64 } -- or writers_per_node = 1
+//!   }
+//! \endcode
+//! \param [in] output_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_field_output(
+  const T & output_input, field_output_inputs_t & inputs
+) {
+#ifdef FLECSALE_ENABLE_LUA
+
+  auto format = lua_try_access_as( output_input, "format", std::string );
+  if ( format == "compressed" )
+    inputs.format = output_format_t::compressed;
+  else if ( format == "exodus" )
+    inputs.format = output_format_t::exodus;
+  else if ( format == "vtu" ) {
+#ifdef FLECSALE_ENABLE_VTK
+    inputs.format = output_format_t::vtu;
+#else
+    THROW_IMPLEMENTED_ERROR(
+      "You need to link with vtk in order to write vtu files."
+    );
+#endif
+  }
+  else
+    THROW_RUNTIME_ERROR( "Unknown output format \"" << format << "\"" );
+
+  auto default_input = output_input["default"];
+  if ( !default_input.empty() )
+    load_compression( default_input, inputs.default_codec );
+
+  auto fields_input = output_input["fields"];
+  if ( !fields_input.empty() ) {
+    for ( const auto & name : field_output_inputs_t::field_names() ) {
+      auto codec_input = fields_input[name.c_str()];
+      if ( !codec_input.empty() )
+        load_compression( codec_input, inputs.codecs[name] );
+    }
+  }
+
+  auto agg_input = output_input["aggregation"];
+  if ( !agg_input.empty() ) {
+    auto ratio_input = agg_input["ranks_per_writer"];
+    if ( !ratio_input.empty() )
+      inputs.aggregation.ranks_per_writer =
+        ratio_input.template as<std::size_t>();
+    auto node_input = agg_input["writers_per_node"];
+    if ( !node_input.empty() )
+      inputs.aggregation.writers_per_node =
+        node_input.template as<std::size_t>();
+  }
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The aggregator used by this rank's field output.
+//!
+//! It is created on first use, by a task that runs on every rank at once,
+//! and has to be reset before MPI shuts down to free its communicators.
+///////////////////////////////////////////////////////////////////////////////
+inline std::unique_ptr<flecsale::io::aggregator_t> & field_aggregator()
+{
+  static std::unique_ptr<flecsale::io::aggregator_t> aggregator;
+  return aggregator;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The aggregated field output of this rank that is still in flight.
+//!
+//! It has to be waited on before the next output, and before the
+//! aggregator is reset.
+///////////////////////////////////////////////////////////////////////////////
+inline flecsale::io::aggregate_write_t & pending_field_write()
+{
+  static flecsale::io::aggregate_write_t pending;
+  return pending;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,122 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Describe solver storage so it can be wrapped without copies.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A strided view of the values of a set of entities.
+//! \tparam T  The type of each component.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+struct field_view_u {
+
+  //! the address of the first value
+  const T * data = nullptr;
+  //! the number of entities
+  std::size_t size = 0;
+  //! the number of components per entity
+  std::size_t components = 1;
+  //! the distance between consecutive entities in bytes
+  std::ptrdiff_t stride = sizeof(T);
+  //! true if every entity sits at the same stride
+  bool uniform = true;
+
+  //! \brief return true if the values are packed back to back
+  bool contiguous() const
+  {
+    return uniform &&
+      stride == static_cast<std::ptrdiff_t>( components * sizeof(T) );
+  }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Find out how the values of some entities are laid out in memory.
+//!
+//! \tparam T  The type of each component.
+//! \param [in] entities  The entities.
+//! \param [in] get  Return a reference to the value of an entity, either a T
+//!                  or a packed array of T.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, typename R, typename G >
+auto make_field_view( R && entities, G && get )
+{
+  using ref_t = decltype( get( *std::begin(entities) ) );
+  static_assert( std::is_lvalue_reference<ref_t>::value,
+    "fields must be returned by reference to be viewed in place" );
+  using value_t = std::decay_t<ref_t>;
+  static_assert( sizeof(value_t) % sizeof(T) == 0,
+    "values must be packed arrays of the component type" );
+
+  field_view_u<T> view;
+  view.components = sizeof(value_t) / sizeof(T);
+  view.stride = sizeof(value_t);
+
+  const char * prev = nullptr;
+  for ( auto && e : entities ) {
+    auto ptr = reinterpret_cast<const char *>( std::addressof( get(e) ) );
+    if ( view.size == 0 )
+      view.data = reinterpret_cast<const T *>( ptr );
+    else if ( view.size == 1 )
+      view.stride = ptr - prev;
+    else if ( ptr - prev != view.stride )
+      view.uniform = false;
+    prev = ptr;
+    ++view.size;
+  }
+
+  view.uniform = view.uniform &&
+    view.stride >= static_cast<std::ptrdiff_t>( sizeof(value_t) ) &&
+    view.stride % static_cast<std::ptrdiff_t>( alignof(T) ) == 0;
+
+  return view;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Pack the values of some entities into a buffer.
+//!
+//! This is the fallback for storage that cannot be viewed in place.
+//! \param [in] entities  The entities.
+//! \param [in] get  Return a reference to the value of an entity.
+//! \param [out] buffer  The packed values.
+//! \return A contiguous view of the buffer.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, typename R, typename G >
+auto copy_field_view( R && entities, G && get, std::vector<T> & buffer )
+{
+  using value_t = std::decay_t< decltype( get( *std::begin(entities) ) ) >;
+
+  field_view_u<T> view;
+  view.components = sizeof(value_t) / sizeof(T);
+  view.stride = sizeof(value_t);
+
+  buffer.clear();
+  for ( auto && e : entities ) {
+    buffer.resize( buffer.size() + view.components );
+    std::memcpy( buffer.data() + view.size*view.components,
+      std::addressof( get(e) ), sizeof(value_t) );
+    ++view.size;
+  }
+
+  view.data = buffer.data();
+  return view;
+}
+
+} // namespace
+} // namespace
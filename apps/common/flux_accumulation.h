@@ -0,0 +1,130 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief The ways of summing the face fluxes into the cells.
+///
+/// A gather loops over the cells and reads the flux of every face of each
+/// cell, so an interior face is read twice.  A scatter loops over the faces
+/// and adds each flux to the cells of the face, reading it once.  The faces
+/// are colored so the threads of a scatter never write to the same cell.
+/// Which one is faster depends on the machine, so it can also be measured
+/// at start up.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale/mesh/coloring.h>
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The available ways of summing the face fluxes.
+///////////////////////////////////////////////////////////////////////////////
+enum class flux_accumulation_t
+{
+  //! each cell reads the fluxes of its faces
+  gather,
+  //! each face adds its flux to its cells
+  scatter,
+  //! time both and keep the faster one
+  automatic
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Convert a flux accumulation name to its enum.
+//! \param [in] name  One of "gather", "scatter" or "auto".
+///////////////////////////////////////////////////////////////////////////////
+inline flux_accumulation_t flux_accumulation( const std::string & name )
+{
+  if ( name == "gather" )
+    return flux_accumulation_t::gather;
+  else if ( name == "scatter" )
+    return flux_accumulation_t::scatter;
+  else if ( name == "auto" )
+    return flux_accumulation_t::automatic;
+  else
+    THROW_RUNTIME_ERROR( "Unknown flux accumulation \"" << name << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The faces around the owned cells of this rank, split into colors.
+//!
+//! The mesh does not change, so the colors are found once.  Two faces
+//! conflict when they share a cell, owned or not.
+///////////////////////////////////////////////////////////////////////////////
+class face_coloring_t {
+
+public:
+
+  //! the local id type
+  using id_t = std::size_t;
+
+  //! \brief return true once the colors have been found
+  bool is_built() const
+  { return coloring_.is_built(); }
+
+  //! \brief Color the faces.
+  //! \param [in] mesh  The mesh.
+  //! \param [in] owned_cells  The owned cells.
+  template< typename M, typename C >
+  void build( const M & mesh, const C & owned_cells )
+  {
+    faces_.clear();
+    for ( auto c : owned_cells )
+      for ( auto f : mesh.faces(c) )
+        faces_.emplace_back( f.id() );
+    std::sort( faces_.begin(), faces_.end() );
+    faces_.erase( std::unique( faces_.begin(), faces_.end() ), faces_.end() );
+
+    const auto & fs = mesh.faces();
+    coloring_.build( faces_.size(), [&]( std::size_t i ) {
+      std::vector<id_t> cells;
+      for ( auto c : mesh.cells( fs[ faces_[i] ] ) )
+        cells.emplace_back( c.id() );
+      return cells;
+    } );
+  }
+
+  //! \brief the number of colors
+  std::size_t num_colors() const
+  { return coloring_.num_colors(); }
+
+  //! \brief the faces of one color, as indices to pass to face()
+  const std::vector<id_t> & items( std::size_t color ) const
+  { return coloring_.items( color ); }
+
+  //! \brief the local id of a face, given its index in a color
+  id_t face( id_t item ) const
+  { return faces_[item]; }
+
+private:
+
+  //! the faces around the owned cells
+  std::vector<id_t> faces_;
+  //! the colors, of indices into faces_
+  flecsale::mesh::coloring_t coloring_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the face coloring of this rank.
+///////////////////////////////////////////////////////////////////////////////
+inline face_coloring_t & face_coloring()
+{
+  static face_coloring_t coloring;
+  return coloring;
+}
+
+} // namespace
+} // namespace
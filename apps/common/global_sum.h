@@ -0,0 +1,163 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Global sums that do not depend on the number of threads or ranks.
+///
+/// A global sum takes a few reductions.  The largest term and the number of
+/// terms are found first, and then each fold of a
+/// flecsale::utils::folded_sum_t is summed on its own.  The folds are exact,
+/// so the order in which the ranks are added does not matter.  Several sums
+/// can share the round trips of each stage, see global_sums.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale/utils/reduction.h>
+
+// system includes
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Which part of a global sum a reduction asks for.
+///////////////////////////////////////////////////////////////////////////////
+struct sum_request_t {
+
+  //! the stages that come before the folds
+  enum stage_t : int {
+    //! the largest magnitude of a term, reduced with a max
+    bound = -2,
+    //! the number of terms, reduced with a sum
+    count = -1
+  };
+
+  //! the stage, or the fold to sum
+  int stage = bound;
+  //! the global largest magnitude, for the folds
+  double global_bound = 0;
+  //! the global number of terms, for the folds
+  double global_count = 0;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the contribution of this rank to one stage of a global sum.
+//! \param [in] request  The stage.
+//! \param [in] n  The number of local terms.
+//! \param [in] f  Return the i-th local term.
+///////////////////////////////////////////////////////////////////////////////
+template< typename F >
+double local_sum( const sum_request_t & request, std::size_t n, F && f )
+{
+  using namespace flecsale::utils;
+
+  switch ( request.stage ) {
+    case sum_request_t::bound:
+      return n == 0 ? 0 :
+        reproducible_max<double>( n, [&]( std::size_t i ) {
+          return std::abs( static_cast<double>( f(i) ) ); } );
+    case sum_request_t::count:
+      return n;
+    default: {
+      folded_sum_t folder( request.global_bound, request.global_count );
+      // the folds are exact, so the chunked sum is too
+      return reproducible_sum<double>( n, [&]( std::size_t i ) {
+        return folder.fold( f(i), request.stage ); } );
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate a global sum.
+//!
+//! Every rank must call this since it launches the reductions.
+//!
+//! \param [in] reduce_max  Return the max-reduction of the rank
+//!                         contributions to a request, see local_sum.
+//! \param [in] reduce_sum  Return the sum-reduction of the rank
+//!                         contributions to a request.
+///////////////////////////////////////////////////////////////////////////////
+template< typename M, typename S >
+double global_sum( M && reduce_max, S && reduce_sum )
+{
+  using flecsale::utils::folded_sum_t;
+
+  sum_request_t request;
+  request.stage = sum_request_t::bound;
+  request.global_bound = reduce_max( request );
+  request.stage = sum_request_t::count;
+  request.global_count = reduce_sum( request );
+
+  folded_sum_t::folds_t folds;
+  for ( int k = 0; k < folded_sum_t::num_folds; ++k ) {
+    request.stage = k;
+    folds[k] = reduce_sum( request );
+  }
+  return folded_sum_t::result( folds );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate several global sums together.
+//!
+//! Each stage is launched for all the sums before any of them is waited
+//! on, so the sums cost two round trips however many there are.  Every rank
+//! must call this since it launches the reductions.
+//!
+//! \param [in] num_sums  The number of sums.
+//! \param [in] launch_max  Launch the max-reduction of the rank
+//!                         contributions to a request of the j-th sum,
+//!                         called as launch_max(j, request), and return
+//!                         its future.
+//! \param [in] launch_sum  Launch the sum-reduction instead.
+//! \return the value of each sum
+///////////////////////////////////////////////////////////////////////////////
+template< typename M, typename S >
+std::vector<double> global_sums(
+  std::size_t num_sums, M && launch_max, S && launch_sum
+) {
+  using flecsale::utils::folded_sum_t;
+  using max_future_t = decltype( launch_max( std::size_t{0}, sum_request_t{} ) );
+  using sum_future_t = decltype( launch_sum( std::size_t{0}, sum_request_t{} ) );
+
+  // the bounds and the counts do not depend on each other
+  sum_request_t bound_request, count_request;
+  bound_request.stage = sum_request_t::bound;
+  count_request.stage = sum_request_t::count;
+
+  std::vector<max_future_t> bounds;
+  std::vector<sum_future_t> counts;
+  for ( std::size_t j = 0; j < num_sums; ++j ) {
+    bounds.emplace_back( launch_max( j, bound_request ) );
+    counts.emplace_back( launch_sum( j, count_request ) );
+  }
+
+  std::vector<sum_future_t> folds;
+  for ( std::size_t j = 0; j < num_sums; ++j ) {
+    sum_request_t request;
+    request.global_bound = bounds[j].get();
+    request.global_count = counts[j].get();
+    for ( int k = 0; k < folded_sum_t::num_folds; ++k ) {
+      request.stage = k;
+      folds.emplace_back( launch_sum( j, request ) );
+    }
+  }
+
+  std::vector<double> results( num_sums );
+  for ( std::size_t j = 0; j < num_sums; ++j ) {
+    folded_sum_t::folds_t sums;
+    for ( int k = 0; k < folded_sum_t::num_folds; ++k )
+      sums[k] = folds[ j * folded_sum_t::num_folds + k ].get();
+    results[j] = folded_sum_t::result( sums );
+  }
+  return results;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,103 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Split the owned faces into an interior and a halo part.
+///
+/// The interior faces only touch owned cells, so their fluxes can be
+/// evaluated while the ghost exchange is still in flight.  The halo faces
+/// touch ghosts and have to wait for it.  Anything that reads all the fluxes,
+/// like the cell update, waits for both parts.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The two parts of the owned faces.
+///////////////////////////////////////////////////////////////////////////////
+enum class region_t
+{
+  //! no ghost is touched
+  interior,
+  //! some ghost is touched
+  halo
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The interior and halo face lists of this rank.
+//!
+//! A face is interior when all its cells are owned.  Faces are referred to by
+//! their local ids.
+///////////////////////////////////////////////////////////////////////////////
+class halo_split_t {
+
+public:
+
+  //! the local id type
+  using id_t = std::size_t;
+
+  //! \brief return true once the lists have been built
+  bool is_built() const
+  { return built_; }
+
+  //! \brief Build the lists.
+  //! \param [in] mesh  The mesh.
+  //! \param [in] owned_cells,owned_faces  The owned entities.
+  template< typename M, typename C, typename F >
+  void build( const M & mesh, const C & owned_cells, const F & owned_faces )
+  {
+    std::vector<bool> is_owned( mesh.cells().size(), false );
+    for ( auto c : owned_cells ) is_owned[c.id()] = true;
+
+    auto all_owned = [&]( const auto & cells ) {
+      for ( auto c : cells ) if ( !is_owned[c.id()] ) return false;
+      return true;
+    };
+
+    for ( auto & list : faces_ ) list.clear();
+    for ( auto f : owned_faces )
+      faces_[ index( all_owned( mesh.cells(f) ) ) ].emplace_back( f.id() );
+
+    built_ = true;
+  }
+
+  //! \brief the owned faces of one part
+  const std::vector<id_t> & faces( region_t region ) const
+  { return faces_[ static_cast<std::size_t>(region) ]; }
+
+private:
+
+  //! \brief the list index of an entity
+  static std::size_t index( bool interior )
+  {
+    return static_cast<std::size_t>(
+      interior ? region_t::interior : region_t::halo );
+  }
+
+  //! true once the lists are built
+  bool built_ = false;
+
+  //! the lists, indexed by region_t
+  std::vector<id_t> faces_[2];
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the split of this rank.
+///////////////////////////////////////////////////////////////////////////////
+inline halo_split_t & halo_split()
+{
+  static halo_split_t split;
+  return split;
+}
+
+} // namespace
+} // namespace
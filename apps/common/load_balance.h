@@ -0,0 +1,108 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Measure the load imbalance between ranks.
+///
+/// Each rank estimates its work from a cost model of its owned entities,
+/// and the imbalance is the largest cost over the average one.  The slowest
+/// rank sets the pace, so an imbalance of 1.3 means the run takes 30%
+/// longer than a balanced one.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <cstddef>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the load balance checks.
+///////////////////////////////////////////////////////////////////////////////
+struct load_balance_inputs_t {
+
+  //! the number of steps between checks, zero disables them
+  std::size_t frequency = 0;
+
+  //! the largest acceptable ratio of the maximum to the average cost
+  double threshold = 1.2;
+
+  //! the relative cost of a vertex with boundary conditions, its velocity
+  //! solve grows with the symmetry constraints
+  double boundary_weight = 4;
+
+  //! \brief return true if the balance should be checked at this step
+  bool is_due( std::size_t step ) const
+  { return frequency > 0 && step % frequency == 0; }
+
+  //! \brief return true if an imbalance calls for a repartition
+  bool needs_repartition( double imbalance ) const
+  { return imbalance > threshold; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the ratio of the largest to the average cost.
+//! \param [in] max_cost  The largest cost of any rank.
+//! \param [in] total_cost  The sum of the costs of all ranks.
+//! \param [in] num_ranks  The number of ranks.
+///////////////////////////////////////////////////////////////////////////////
+inline double load_imbalance(
+  double max_cost, double total_cost, std::size_t num_ranks
+) {
+  if ( total_cost <= 0 || num_ranks == 0 ) return 1;
+  return max_cost * num_ranks / total_cost;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the load balance inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   load_balance = {
+//!     frequency = 100,     -- steps between checks
+//!     threshold = 1.2,     -- optional, the acceptable max/avg cost
+//!     boundary_weight = 4  -- optional, the cost of a boundary vertex
+//!   }
+//! \endcode
+//! \param [in] balance_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_load_balance( const T & balance_input, load_balance_inputs_t & inputs )
+{
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.frequency = lua_try_access_as( balance_input, "frequency", std::size_t );
+
+  auto threshold_input = balance_input["threshold"];
+  if ( !threshold_input.empty() )
+    inputs.threshold = threshold_input.template as<double>();
+  if ( inputs.threshold < 1 )
+    THROW_RUNTIME_ERROR( "The load imbalance threshold can not be below one" );
+
+  auto weight_input = balance_input["boundary_weight"];
+  if ( !weight_input.empty() )
+    inputs.boundary_weight = weight_input.template as<double>();
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
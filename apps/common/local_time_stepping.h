@@ -0,0 +1,129 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Tools for local time stepping by power of two time classes.
+///
+/// A step is split into 2^levels ticks of the base time step dt0.  A cell of
+/// class k advances with a time step of 2^k dt0, so it is updated every 2^k
+/// ticks.  A face is integrated with the time step of the finer of its two
+/// cells, and its flux times its time step is accumulated into both cells.
+/// This keeps the scheme conservative across class interfaces.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace apps {
+namespace common {
+
+//! \brief The type of a time class.
+using time_class_t = int;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control local time stepping.
+///////////////////////////////////////////////////////////////////////////////
+struct local_time_stepping_inputs_t {
+
+  //! the number of classes above the finest, zero disables local stepping
+  std::size_t levels = 0;
+
+  //! the number of steps between reclassifications of the cells
+  std::size_t reclassify_frequency = 10;
+
+  //! \brief return true if local time stepping is enabled
+  bool is_enabled() const
+  { return levels > 0; }
+
+  //! \brief return the number of base time steps in one step
+  std::size_t num_ticks() const
+  { return std::size_t(1) << levels; }
+
+  //! \brief return true if the cells should be reclassified at this step
+  bool is_due( std::size_t step ) const
+  { return step % std::max<std::size_t>( reclassify_frequency, 1 ) == 0; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the time class of a cell.
+//! \param [in] dt  The stable time step of the cell.
+//! \param [in] dt_min  The smallest stable time step of all cells.
+//! \param [in] levels  The coarsest class allowed.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+time_class_t time_class( T dt, T dt_min, std::size_t levels )
+{
+  if ( dt <= dt_min ) return 0;
+  auto k = static_cast<std::size_t>( std::floor( std::log2( dt / dt_min ) ) );
+  return static_cast<time_class_t>( std::min( k, levels ) );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the number of ticks per step of a class.
+///////////////////////////////////////////////////////////////////////////////
+inline std::size_t class_ticks( time_class_t k )
+{ return std::size_t(1) << k; }
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return true if an entity of class k starts a step at this tick.
+///////////////////////////////////////////////////////////////////////////////
+inline bool starts_step( std::size_t tick, time_class_t k )
+{ return tick % class_ticks(k) == 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return true if an entity of class k finishes a step at this tick.
+///////////////////////////////////////////////////////////////////////////////
+inline bool ends_step( std::size_t tick, time_class_t k )
+{ return (tick + 1) % class_ticks(k) == 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the local time stepping inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   local_time_stepping = {
+//!     levels = 3,        -- cells step with up to 2^3 times the base step
+//!     reclassify = 10    -- optional, steps between reclassifications
+//!   }
+//! \endcode
+//! \param [in] lts_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_local_time_stepping(
+  const T & lts_input, local_time_stepping_inputs_t & inputs
+) {
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.levels = lua_try_access_as( lts_input, "levels", std::size_t );
+  if ( inputs.levels > 16 )
+    THROW_RUNTIME_ERROR( "At most 16 local time stepping levels are allowed" );
+
+  auto freq_input = lts_input["reclassify"];
+  if ( !freq_input.empty() )
+    inputs.reclassify_frequency = freq_input.template as<std::size_t>();
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
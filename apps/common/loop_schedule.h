@@ -0,0 +1,125 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief How the irregular entity loops are split between threads.
+///
+/// Most loops do the same work for every entity and a static schedule is
+/// best.  Some, like the nodal solve, cost much more for a few entities, and
+/// a task can opt into a work stealing schedule for them.  Running the
+/// costly entities first also helps, since the cheap ones then fill the
+/// gaps at the end of the loop.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/utils/work_stealing.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the irregular loops.
+///////////////////////////////////////////////////////////////////////////////
+struct loop_schedule_inputs_t {
+
+  //! if true, the threads balance the irregular loops by stealing chunks
+  bool work_stealing = false;
+
+  //! if true, the costly entities, like boundary vertices, go first
+  bool costly_first = false;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Call f on every entity of a list, in parallel.
+//!
+//! \param [in] schedule  The schedule inputs.
+//! \param [in] chunk_size  The entities per chunk, tuned for the loop.
+//! \param [in] entities  The entities, indexable.
+//! \param [in] is_costly  Return true for an entity that costs more than
+//!                        most, used if schedule.costly_first is set.
+//! \param [in] f  The loop body, called with an entity.
+///////////////////////////////////////////////////////////////////////////////
+template< typename L, typename C, typename F >
+void irregular_for(
+  const loop_schedule_inputs_t & schedule,
+  std::size_t chunk_size,
+  const L & entities,
+  C && is_costly,
+  F && f
+) {
+  std::size_t num_entities = entities.size();
+
+  // the stable partition keeps the entities close to storage order
+  std::vector<std::size_t> order;
+  if ( schedule.costly_first ) {
+    order.resize( num_entities );
+    for ( std::size_t i = 0; i < num_entities; ++i ) order[i] = i;
+    std::stable_partition( order.begin(), order.end(),
+      [&]( std::size_t i ) { return is_costly( entities[i] ); } );
+  }
+
+  auto body = [&]( std::size_t i ) {
+    f( entities[ order.empty() ? i : order[i] ] );
+  };
+
+  if ( schedule.work_stealing ) {
+    flecsale::utils::work_stealing_for( num_entities, body, chunk_size );
+  }
+  else {
+    #pragma omp parallel for
+    for ( std::size_t i = 0; i < num_entities; ++i ) body( i );
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the loop schedule inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   loop_schedule = {
+//!     work_stealing = true,  -- optional, balance by stealing chunks
+//!     costly_first = true    -- optional, boundary vertices first
+//!   }
+//! \endcode
+//! \param [in] schedule_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_loop_schedule(
+  const T & schedule_input, loop_schedule_inputs_t & inputs
+) {
+#ifdef FLECSALE_ENABLE_LUA
+
+  auto stealing_input = schedule_input["work_stealing"];
+  if ( !stealing_input.empty() )
+    inputs.work_stealing = stealing_input.template as<bool>();
+
+  auto costly_input = schedule_input["costly_first"];
+  if ( !costly_input.empty() )
+    inputs.costly_first = costly_input.template as<bool>();
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
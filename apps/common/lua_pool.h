@@ -0,0 +1,109 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief One lua interpreter per thread.
+///
+/// A lua state can not be used by two threads at once.  The pool keeps one
+/// state per thread, each with the same script loaded, so a parallel loop
+/// can call lua functions without locking.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+namespace apps {
+namespace common {
+
+#ifdef FLECSALE_ENABLE_LUA
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A set of lua states with one script loaded, one per thread.
+///////////////////////////////////////////////////////////////////////////////
+class lua_pool_t {
+
+public:
+
+  //! the interpreter type
+  using lua_t = ristra::embedded::lua_t;
+
+  //! \brief Load a script into one state per thread.
+  //!
+  //! Nothing is done if the script is already loaded.  This must be called
+  //! outside of a parallel region.
+  //!
+  //! \param [in] file  The name of the lua file to load.
+  void load( const std::string & file )
+  {
+    if ( file == file_ && !states_.empty() ) return;
+
+#ifdef _OPENMP
+    auto num_threads = omp_get_max_threads();
+#else
+    auto num_threads = 1;
+#endif
+
+    states_.clear();
+    for ( int i=0; i<num_threads; ++i ) {
+      states_.emplace_back( std::make_unique<lua_t>() );
+      states_.back()->loadfile( file );
+    }
+    file_ = file;
+  }
+
+  //! \brief the state of the calling thread
+  lua_t & state()
+  {
+#ifdef _OPENMP
+    std::size_t thread = omp_get_thread_num();
+#else
+    std::size_t thread = 0;
+#endif
+    if ( thread >= states_.size() )
+      THROW_RUNTIME_ERROR( "No lua state was loaded for thread " << thread );
+    return *states_[thread];
+  }
+
+  //! \brief the number of states
+  std::size_t size() const
+  { return states_.size(); }
+
+private:
+
+  //! the loaded script
+  std::string file_;
+  //! the states, indexed by thread
+  std::vector< std::unique_ptr<lua_t> > states_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the lua pool of this rank.
+///////////////////////////////////////////////////////////////////////////////
+inline lua_pool_t & lua_pool()
+{
+  static lua_pool_t pool;
+  return pool;
+}
+
+#endif // FLECSALE_ENABLE_LUA
+
+} // namespace
+} // namespace
@@ -0,0 +1,163 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Place the field storage close to the threads that use it.
+///
+/// The operating system maps a page to the memory of the socket whose
+/// thread first writes to it.  If the fields are first written by one
+/// thread, every page ends up on one socket and the threads of the other
+/// sockets read remote memory for the whole run.  Touching the fields in
+/// parallel, with the same loops and schedule as the solver, gives each
+/// thread the pages it will work on.  This only helps the loops with that
+/// same static schedule.  Loops that balance their work dynamically, like
+/// the work stealing vertex loops, hand entities to other threads, which
+/// then read some of their pages from another socket.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+#ifdef __linux__
+#  include <sched.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Where one thread runs.
+///////////////////////////////////////////////////////////////////////////////
+struct thread_binding_t {
+  //! the thread number
+  int thread = 0;
+  //! the cpu, or -1 if unknown
+  int cpu = -1;
+  //! the NUMA node, or -1 if unknown
+  int node = -1;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Find where each thread of the parallel loops runs.
+///////////////////////////////////////////////////////////////////////////////
+inline std::vector<thread_binding_t> thread_bindings()
+{
+  std::vector<thread_binding_t> bindings;
+
+  auto find = [&]( thread_binding_t & b ) {
+#ifdef __linux__
+    unsigned cpu = 0, node = 0;
+    if ( syscall( SYS_getcpu, &cpu, &node, nullptr ) == 0 ) {
+      b.cpu = cpu;
+      b.node = node;
+    }
+#endif
+  };
+
+#ifdef _OPENMP
+  bindings.resize( omp_get_max_threads() );
+  #pragma omp parallel
+  {
+    auto & b = bindings[ omp_get_thread_num() ];
+    b.thread = omp_get_thread_num();
+    find( b );
+  }
+#else
+  bindings.resize( 1 );
+  find( bindings.front() );
+#endif
+
+  return bindings;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Print the thread bindings of one rank on one line.
+//! \param [in,out] os  The stream.
+//! \param [in] rank  The rank.
+//! \param [in] bindings  The bindings, see thread_bindings.
+///////////////////////////////////////////////////////////////////////////////
+inline void print_thread_bindings(
+  std::ostream & os, std::size_t rank,
+  const std::vector<thread_binding_t> & bindings
+) {
+  std::set<int> nodes;
+  os << "Rank " << rank << " runs " << bindings.size() << " thread(s) on cpu";
+  for ( const auto & b : bindings ) {
+    os << " " << b.cpu;
+    nodes.insert( b.node );
+  }
+  os << ", NUMA node";
+  for ( auto n : nodes ) os << " " << n;
+  os << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Ask for a range of memory to be backed by huge pages.
+//!
+//! This only affects pages that have not been touched yet, so it has to be
+//! done before the first touch.  The pages that are only partly inside the
+//! range are left alone.
+//!
+//! \param [in] begin,end  The range.
+//! \return true if the request was accepted
+///////////////////////////////////////////////////////////////////////////////
+inline bool advise_huge_pages( const void * begin, const void * end )
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  const auto page = static_cast<std::uintptr_t>( sysconf( _SC_PAGESIZE ) );
+  auto first = reinterpret_cast<std::uintptr_t>( begin );
+  auto last = reinterpret_cast<std::uintptr_t>( end );
+  first = ( first + page - 1 ) / page * page;
+  last = last / page * page;
+  if ( last <= first ) return false;
+  return madvise(
+    reinterpret_cast<void *>( first ), last - first, MADV_HUGEPAGE ) == 0;
+#else
+  return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Write zeros to the value of every entity of a list, in parallel.
+//!
+//! The loop has to match the solver loops over the same list, so each
+//! thread gets the pages it will later work on.  Only the statically
+//! scheduled loops keep to those pages.
+//!
+//! \param [in] entities  The entities, indexable and in storage order.
+//! \param [in,out] h  The field handle.
+//! \param [in] huge_pages  If true, ask for huge pages first.
+///////////////////////////////////////////////////////////////////////////////
+template< typename L, typename H >
+void first_touch( const L & entities, H & h, bool huge_pages = false )
+{
+  auto num_entities = entities.size();
+  if ( num_entities == 0 ) return;
+
+  if ( huge_pages )
+    advise_huge_pages( &h( entities[0] ), &h( entities[num_entities-1] ) + 1 );
+
+  #pragma omp parallel for
+  for ( std::size_t i = 0; i < num_entities; ++i ) {
+    auto & value = h( entities[i] );
+    std::memset( static_cast<void *>( &value ), 0, sizeof(value) );
+  }
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,186 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Tools to store fields in a lower precision than they are computed.
+///
+/// With FLECSALE_MIXED_PRECISION the bulk fields are stored as float while
+/// all the arithmetic is done in the mesh real type.  Without it, the stored
+/// types are the computed ones, and every helper here reduces to a reference.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+
+// system includes
+#include <cstddef>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Replace the floating point type in a value type.
+//!
+//! Scalars, fixed size arrays such as ristra::math::array, and tuples of
+//! those are supported.  Anything else is left alone.
+//! \tparam T  The value type.
+//! \tparam R  The new floating point type.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, typename R >
+struct rebind_real
+{ using type = T; };
+
+//! \copydoc rebind_real
+template< typename R >
+struct rebind_real< float, R >
+{ using type = R; };
+
+//! \copydoc rebind_real
+template< typename R >
+struct rebind_real< double, R >
+{ using type = R; };
+
+//! \copydoc rebind_real
+template<
+  template<typename, std::size_t> class V, typename T, std::size_t N,
+  typename R
+>
+struct rebind_real< V<T,N>, R >
+{ using type = V< typename rebind_real<T,R>::type, N >; };
+
+//! \copydoc rebind_real
+template< typename... Ts, typename R >
+struct rebind_real< std::tuple<Ts...>, R >
+{ using type = std::tuple< typename rebind_real<Ts,R>::type... >; };
+
+//! \brief A shorthand for rebind_real.
+template< typename T, typename R >
+using rebind_real_t = typename rebind_real<T,R>::type;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The type a field of T is stored as.
+///////////////////////////////////////////////////////////////////////////////
+#ifdef FLECSALE_MIXED_PRECISION
+template< typename T >
+using stored_t = rebind_real_t<T, float>;
+#else
+template< typename T >
+using stored_t = T;
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Convert a value to a different precision.
+//!
+//! If the types already match, a reference to the value is returned.
+//! \tparam To  The type to convert to.
+//! \param [in] x  The value to convert.
+///////////////////////////////////////////////////////////////////////////////
+template< typename To, typename From >
+decltype(auto) precision_cast( const From & x )
+{
+  if constexpr ( std::is_same< To, From >::value ) {
+    return x;
+  }
+  else if constexpr ( std::is_arithmetic< From >::value ) {
+    return static_cast<To>( x );
+  }
+  else {
+    To y;
+    for ( std::size_t i=0; i<x.size(); ++i )
+      y[i] = precision_cast< std::decay_t<decltype(y[i])> >( x[i] );
+    return y;
+  }
+}
+
+namespace detail {
+
+//! \brief The type of element I of a state in the compute precision.
+//!
+//! Elements that are already in the compute precision stay references.
+template< typename R, typename E >
+using compute_element_t = std::conditional_t<
+  std::is_same< rebind_real_t<std::decay_t<E>, R>, std::decay_t<E> >::value,
+  E, rebind_real_t< std::decay_t<E>, R >
+>;
+
+//! \brief Pass an element through, or convert it to the compute precision.
+template< typename R, typename X >
+decltype(auto) compute_element( X & x )
+{
+  using value_t = std::remove_const_t<X>;
+  if constexpr ( std::is_same< rebind_real_t<value_t, R>, value_t >::value )
+    return x;
+  else
+    return precision_cast< rebind_real_t<value_t, R> >( x );
+}
+
+//! \brief The implementation of compute_state.
+template< typename R, typename P, std::size_t... I >
+auto compute_state( P & packed, std::index_sequence<I...> )
+{
+  using result_t = std::tuple<
+    compute_element_t< R, std::tuple_element_t<I,P> >...
+  >;
+  return result_t( compute_element<R>( std::get<I>(packed) )... );
+}
+
+//! \brief Copy one converted element back.
+template< std::size_t I, typename P, typename U >
+void commit_element( P & packed, const U & u )
+{
+  using element_t = std::tuple_element_t<I,P>;
+  using computed_t = std::tuple_element_t<I,U>;
+  // references already point at the storage, and read-only data is not
+  // written back
+  if constexpr (
+    !std::is_reference<computed_t>::value &&
+    !std::is_const< std::remove_reference_t<element_t> >::value
+  )
+    std::get<I>(packed) =
+      precision_cast< std::decay_t<element_t> >( std::get<I>(u) );
+}
+
+//! \brief The implementation of commit_state.
+template< typename P, typename U, std::size_t... I >
+void commit_state( P & packed, const U & u, std::index_sequence<I...> )
+{ (void)std::initializer_list<int>{ (commit_element<I>( packed, u ), 0)... }; }
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Present a packed state in the compute precision.
+//!
+//! The result is a tuple like the one pack() returns.  Elements stored in
+//! the compute precision are references to the storage, the others are
+//! converted copies that have to be written back with commit_state.
+//! \tparam R  The compute real type.
+//! \param [in] packed  The tuple of references returned by pack().
+///////////////////////////////////////////////////////////////////////////////
+template< typename R, typename P >
+auto compute_state( P & packed )
+{
+  return detail::compute_state<R>(
+    packed, std::make_index_sequence< std::tuple_size<P>::value >() );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Write the converted elements of a state back to the storage.
+//! \param [in,out] packed  The tuple of references returned by pack().
+//! \param [in] u  The state returned by compute_state.
+///////////////////////////////////////////////////////////////////////////////
+template< typename P, typename U >
+void commit_state( P & packed, const U & u )
+{
+  detail::commit_state(
+    packed, u, std::make_index_sequence< std::tuple_size<P>::value >() );
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,227 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief An embedded python hook for in situ analysis.
+///
+/// The solver fields are handed to a python function as read-only numpy
+/// arrays that point straight at the solver storage.  The arrays are only
+/// valid for the duration of the call; scripts that want to keep values
+/// around have to copy them, e.g. with numpy.array(x).
+///
+/// \remark This header uses the numpy C API, so only include it from one
+///         translation unit.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#include "analysis.h"
+#include "field_view.h"
+
+#ifdef FLECSALE_ENABLE_PYTHON
+#  define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#  include <Python.h>
+#  include <numpy/arrayobject.h>
+#endif
+
+// system includes
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+#ifdef FLECSALE_ENABLE_PYTHON
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Map a floating point type to its numpy type number.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+constexpr int numpy_type()
+{
+  static_assert( std::is_same<T,float>::value || std::is_same<T,double>::value,
+    "only float and double fields can be exposed to python" );
+  return std::is_same<T,double>::value ? NPY_DOUBLE : NPY_FLOAT;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Call a python function with views of the solver fields.
+///////////////////////////////////////////////////////////////////////////////
+class python_hook_t {
+
+public:
+
+  //! \brief Start the interpreter and load the analysis function.
+  //! \param [in] script  The python script to load.
+  //! \param [in] function  The name of the function to call.
+  python_hook_t( const std::string & script, const std::string & function )
+  {
+    if ( !Py_IsInitialized() ) Py_Initialize();
+
+    if ( _import_array() < 0 ) {
+      PyErr_Print();
+      THROW_RUNTIME_ERROR( "Could not import numpy" );
+    }
+
+    // run the script in its own namespace
+    FILE * fp = std::fopen( script.c_str(), "r" );
+    if ( !fp )
+      THROW_RUNTIME_ERROR( "Could not open \"" << script << "\"" );
+
+    globals_ = PyDict_New();
+    PyDict_SetItemString( globals_, "__builtins__", PyEval_GetBuiltins() );
+    auto file = PyUnicode_FromString( script.c_str() );
+    PyDict_SetItemString( globals_, "__file__", file );
+    Py_DECREF( file );
+
+    auto res = PyRun_FileEx( fp, script.c_str(), Py_file_input, globals_,
+      globals_, /* close */ 1 );
+    if ( !res ) {
+      PyErr_Print();
+      THROW_RUNTIME_ERROR( "Error running \"" << script << "\"" );
+    }
+    Py_DECREF( res );
+
+    func_ = PyDict_GetItemString( globals_, function.c_str() );
+    if ( !func_ || !PyCallable_Check( func_ ) )
+      THROW_RUNTIME_ERROR(
+        "\"" << script << "\" has no function named \"" << function << "\""
+      );
+    Py_INCREF( func_ );
+  }
+
+  //! \brief Release the python objects.
+  ~python_hook_t()
+  {
+    if ( !Py_IsInitialized() ) return;
+    clear();
+    Py_XDECREF( func_ );
+    Py_XDECREF( globals_ );
+  }
+
+  //! the hook owns python objects, so it cannot be copied
+  python_hook_t( const python_hook_t & ) = delete;
+  python_hook_t & operator=( const python_hook_t & ) = delete;
+
+  //! \brief Expose a field to the next call.
+  //!
+  //! If the values of consecutive entities sit at a constant stride in
+  //! memory, the array is a view of the storage.  Otherwise the values are
+  //! copied into a scratch buffer that lives until the call returns.
+  //!
+  //! \tparam T  The floating point type of each component.
+  //! \param [in] name  The name of the array in the dictionary.
+  //! \param [in] entities  The entities to expose.
+  //! \param [in] get  Return a reference to the value of an entity, either
+  //!                  a T or a packed array of T.
+  template< typename T, typename R, typename G >
+  void add_field( const std::string & name, R && entities, G && get )
+  {
+    auto view = make_field_view<T>( entities, get );
+
+    // fall back to a copy
+    if ( !view.uniform ) {
+      buffers_.emplace_back();
+      auto & buf = buffers_.back();
+      std::vector<T> values;
+      view = copy_field_view( entities, get, values );
+      buf.resize( values.size() * sizeof(T) );
+      std::memcpy( buf.data(), values.data(), buf.size() );
+      view.data = reinterpret_cast<const T *>( buf.data() );
+      ++num_copies_;
+    }
+
+    // wrap the memory without copying it, and without write access
+    npy_intp dims[2] = {
+      static_cast<npy_intp>(view.size), static_cast<npy_intp>(view.components)
+    };
+    npy_intp strides[2] = { view.stride, sizeof(T) };
+    auto arr = PyArray_New(
+      &PyArray_Type, view.components > 1 ? 2 : 1, dims, numpy_type<T>(),
+      strides, const_cast<T *>(view.data), 0, NPY_ARRAY_ALIGNED, nullptr
+    );
+    if ( !arr ) {
+      PyErr_Print();
+      THROW_RUNTIME_ERROR( "Could not wrap \"" << name << "\"" );
+    }
+
+    arrays_.emplace_back( name, arr );
+  }
+
+  //! \brief Call the analysis function.
+  //!
+  //! The function is called as `function(step, time, rank, size, fields)`
+  //! where fields is a dictionary of the arrays added since the last call.
+  //! \param [in] step  The current step.
+  //! \param [in] time  The current solution time.
+  //! \param [in] rank  The rank of this process.
+  //! \param [in] size  The number of processes.
+  void call( std::size_t step, double time, int rank, int size )
+  {
+    auto fields = PyDict_New();
+    for ( const auto & a : arrays_ )
+      PyDict_SetItemString( fields, a.first.c_str(), a.second );
+
+    auto res = PyObject_CallFunction( func_, "ndiiO",
+      static_cast<Py_ssize_t>(step), time, rank, size, fields );
+    Py_DECREF( fields );
+    clear();
+
+    if ( !res ) {
+      PyErr_Print();
+      THROW_RUNTIME_ERROR( "The python analysis failed at step " << step );
+    }
+    Py_DECREF( res );
+  }
+
+  //! \brief Return the number of fields that had to be copied so far.
+  std::size_t num_copies() const
+  { return num_copies_; }
+
+private:
+
+  //! \brief drop the arrays and scratch buffers
+  void clear()
+  {
+    for ( auto & a : arrays_ ) Py_DECREF( a.second );
+    arrays_.clear();
+    buffers_.clear();
+  }
+
+  //! the namespace the script was run in
+  PyObject * globals_ = nullptr;
+  //! the analysis function
+  PyObject * func_ = nullptr;
+  //! the arrays for the next call
+  std::vector< std::pair<std::string, PyObject *> > arrays_;
+  //! the scratch buffers of the fields that had to be copied
+  std::vector< std::vector<char> > buffers_;
+  //! the number of copies made
+  std::size_t num_copies_ = 0;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The python hook of this process.
+//!
+//! It is created the first time it is needed.
+//! \param [in] inputs  The analysis inputs.
+///////////////////////////////////////////////////////////////////////////////
+inline python_hook_t & python_hook( const analysis_inputs_t & inputs )
+{
+  static std::unique_ptr<python_hook_t> hook;
+  if ( !hook )
+    hook = std::make_unique<python_hook_t>( inputs.script, inputs.function );
+  return *hook;
+}
+
+#endif // FLECSALE_ENABLE_PYTHON
+
+} // namespace
+} // namespace
@@ -0,0 +1,100 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Inputs that control the reconstruction of the face states.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eqns/reconstruction.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <string>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the reconstruction of the face states.
+///////////////////////////////////////////////////////////////////////////////
+struct reconstruction_inputs_t {
+
+  //! the limiter type
+  using limiter_t = flecsale::eqns::limiter_t;
+
+  //! the spatial order, 1 uses the cell averages and 2 turns on MUSCL
+  std::size_t order = 1;
+
+  //! the slope limiter
+  limiter_t limiter = limiter_t::venkatakrishnan;
+
+  //! the constant K in the venkatakrishnan smoothing parameter (K h)^3
+  double venkatakrishnan_k = 5;
+
+  //! if true, the face states are advanced half a step (MUSCL-Hancock)
+  bool predictor = true;
+
+  //! \brief return true if the face states are reconstructed
+  bool is_second_order() const
+  { return order > 1; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the reconstruction inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   reconstruction = {
+//!     order = 2,
+//!     limiter = "venkatakrishnan", -- or "barth_jespersen", or "none"
+//!     K = 5,                        -- optional
+//!     predictor = true              -- optional
+//!   }
+//! \endcode
+//! \param [in] recon_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_reconstruction(
+  const T & recon_input, reconstruction_inputs_t & inputs
+) {
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.order = lua_try_access_as( recon_input, "order", std::size_t );
+  if ( inputs.order < 1 || inputs.order > 2 )
+    THROW_RUNTIME_ERROR(
+      "Only first and second order reconstructions are supported"
+    );
+
+  auto limiter_input = recon_input["limiter"];
+  if ( !limiter_input.empty() )
+    inputs.limiter =
+      flecsale::eqns::limiter( limiter_input.template as<std::string>() );
+
+  auto k_input = recon_input["K"];
+  if ( !k_input.empty() ) inputs.venkatakrishnan_k = k_input.template as<double>();
+
+  auto predictor_input = recon_input["predictor"];
+  if ( !predictor_input.empty() )
+    inputs.predictor = predictor_input.template as<bool>();
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
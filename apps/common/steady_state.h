@@ -0,0 +1,160 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief Tools to march a solution to steady state.
+///
+/// Every cell takes its own pseudo time step from its local CFL limit, so the
+/// intermediate solutions are not time accurate.  The iterations stop once
+/// a norm of the residual has dropped by a given number of orders of
+/// magnitude from its first value.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+#ifdef FLECSALE_ENABLE_LUA
+#  include <ristra/embedded/embed_lua.h>
+#endif
+
+// system includes
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The available residual norms.
+///////////////////////////////////////////////////////////////////////////////
+enum class residual_norm_t
+{
+  l1,
+  l2,
+  linf
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Convert a norm name to its enum.
+//! \param [in] name  One of "l1", "l2" or "linf".
+///////////////////////////////////////////////////////////////////////////////
+inline residual_norm_t residual_norm( const std::string & name )
+{
+  if ( name == "l1" )
+    return residual_norm_t::l1;
+  else if ( name == "l2" )
+    return residual_norm_t::l2;
+  else if ( name == "linf" )
+    return residual_norm_t::linf;
+  else
+    THROW_RUNTIME_ERROR( "Unknown residual norm \"" << name << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Return the contribution of one cell to a residual norm.
+//!
+//! The l1 and l2 norms are volume weighted sums, the l2 one is squared and
+//! needs a final square root, see finish_residual_norm.  The linf norm is a
+//! maximum.
+//!
+//! \param [in] norm  The norm.
+//! \param [in] r  The cell residual.
+//! \param [in] vol  The cell volume.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+T residual_norm_contribution( residual_norm_t norm, T r, T vol )
+{
+  switch ( norm ) {
+    case residual_norm_t::l1:
+      return std::abs(r) * vol;
+    case residual_norm_t::l2:
+      return r * r * vol;
+    default:
+      return std::abs(r);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Finish a reduced residual norm.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+T finish_residual_norm( residual_norm_t norm, T reduced )
+{ return norm == residual_norm_t::l2 ? std::sqrt( reduced ) : reduced; }
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The inputs that control the steady state mode.
+///////////////////////////////////////////////////////////////////////////////
+struct steady_state_inputs_t {
+
+  //! if true, march to steady state with local pseudo time steps
+  bool enabled = false;
+
+  //! the number of orders of magnitude the residual has to drop
+  double orders = 6;
+
+  //! the norm that is monitored
+  residual_norm_t norm = residual_norm_t::l2;
+
+  //! the number of iterations between residual reports, zero for none
+  std::size_t frequency = 100;
+
+  //! \brief return true if the residual has dropped far enough
+  //! \param [in] residual  The current residual.
+  //! \param [in] initial  The residual of the first iteration.
+  bool is_converged( double residual, double initial ) const
+  { return residual <= initial * std::pow( 10., -orders ); }
+
+  //! \brief return true if the residual should be reported at this iteration
+  bool is_due( std::size_t iteration ) const
+  { return frequency > 0 && iteration % frequency == 0; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Load the steady state inputs from a lua table.
+//!
+//! The table looks like
+//! \code
+//!   steady_state = {
+//!     orders = 8,        -- the drop in the residual
+//!     norm = "l2",       -- optional, or "l1", or "linf"
+//!     frequency = 100    -- optional, iterations between reports
+//!   }
+//! \endcode
+//! \param [in] steady_input  The lua table.
+//! \param [in,out] inputs  The inputs to fill in.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void load_steady_state( const T & steady_input, steady_state_inputs_t & inputs )
+{
+#ifdef FLECSALE_ENABLE_LUA
+
+  inputs.enabled = true;
+  inputs.orders = lua_try_access_as( steady_input, "orders", double );
+  if ( inputs.orders <= 0 )
+    THROW_RUNTIME_ERROR( "The residual has to drop by a positive number of "
+      "orders of magnitude" );
+
+  auto norm_input = steady_input["norm"];
+  if ( !norm_input.empty() )
+    inputs.norm = residual_norm( norm_input.template as<std::string>() );
+
+  auto freq_input = steady_input["frequency"];
+  if ( !freq_input.empty() )
+    inputs.frequency = freq_input.template as<std::size_t>();
+
+#else
+
+  THROW_IMPLEMENTED_ERROR(
+    "You need to link with lua in order to use lua functionality."
+  );
+
+#endif // HAVE_LUA
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,147 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the activity tracking.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <array>
+#include <vector>
+
+// user includes
+#include "../activity.h"
+
+using namespace apps::common;
+
+//! \brief a cell or vertex of the line mesh
+struct entity_t {
+  std::size_t i;
+  bool boundary;
+  std::size_t id() const { return i; }
+  const entity_t * operator->() const { return this; }
+  bool is_boundary() const { return boundary; }
+};
+
+//! \brief a mesh of cells on a line, with the same interface as the
+//!        flecsi mesh for the activity tracker
+class line_mesh_t {
+
+public:
+
+  explicit line_mesh_t( std::size_t num_cells )
+  {
+    for ( std::size_t i=0; i<num_cells; ++i )
+      cells_.push_back( { i, i == 0 || i == num_cells-1 } );
+    for ( std::size_t i=0; i<=num_cells; ++i )
+      vertices_.push_back( { i, i == 0 || i == num_cells } );
+  }
+
+  const std::vector<entity_t> & cells() const { return cells_; }
+  const std::vector<entity_t> & vertices() const { return vertices_; }
+
+  std::vector<entity_t> cells( const entity_t & v ) const
+  {
+    std::vector<entity_t> cs;
+    if ( v.i > 0 ) cs.push_back( cells_[v.i-1] );
+    if ( v.i < cells_.size() ) cs.push_back( cells_[v.i] );
+    return cs;
+  }
+
+  std::vector<entity_t> vertices( const entity_t & c ) const
+  { return { vertices_[c.i], vertices_[c.i+1] }; }
+
+private:
+
+  std::vector<entity_t> cells_;
+  std::vector<entity_t> vertices_;
+
+};
+
+//! \brief the state of a lagrangian isothermal gas pushed by a piston
+struct piston_t {
+
+  std::vector<double> x, u, m, d;
+
+  //! \brief set a uniform gas at rest
+  explicit piston_t( std::size_t num_cells ) :
+    x( num_cells+1 ), u( num_cells+1, 0 ), m( num_cells, 1. / num_cells ),
+    d( num_cells )
+  {
+    for ( std::size_t i=0; i<=num_cells; ++i ) x[i] = double(i) / num_cells;
+    for ( std::size_t c=0; c<num_cells; ++c ) update_cell( c );
+  }
+
+  //! \brief solve for the velocity of a vertex, the piston is on the left
+  //!        and the right end is a wall
+  void solve_vertex( std::size_t v, double dt )
+  {
+    if ( v == 0 ) u[v] = 0.5;
+    else if ( v == d.size() ) u[v] = 0;
+    else u[v] += dt * ( d[v-1] - d[v] ) / ( 0.5 * ( m[v-1] + m[v] ) );
+  }
+
+  //! \brief the density follows the volume, and the pressure equals it
+  void update_cell( std::size_t c )
+  { d[c] = m[c] / ( x[c+1] - x[c] ); }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that a piston gives the same result with and without tracking
+///////////////////////////////////////////////////////////////////////////////
+TEST(activity, piston) {
+
+  // a dyadic mesh and time step keep the gas at rest exactly uniform
+  constexpr std::size_t num_cells = 128;
+  constexpr std::size_t num_steps = 64;
+  constexpr double dt = 1. / 1024;
+
+  line_mesh_t mesh( num_cells );
+
+  // with no tolerance, any change disturbs a cell
+  activity_inputs_t ambient;
+  ambient.density = 1;
+  ambient.pressure = 1;
+  ambient.tolerance = 0;
+
+  // every step visits all the entities
+  piston_t full( num_cells );
+  for ( std::size_t n=0; n<num_steps; ++n ) {
+    for ( std::size_t v=0; v<=num_cells; ++v ) full.solve_vertex( v, dt );
+    for ( std::size_t v=0; v<=num_cells; ++v ) full.x[v] += dt * full.u[v];
+    for ( std::size_t c=0; c<num_cells; ++c ) full.update_cell( c );
+  }
+
+  // or only the active ones
+  piston_t tracked( num_cells );
+  auto is_disturbed = [&]( const entity_t & c ) {
+    std::array<double,1> v{ 0.5 * ( tracked.u[c.i] + tracked.u[c.i+1] ) };
+    return ambient.is_disturbed( tracked.d[c.i], tracked.d[c.i], v );
+  };
+
+  activity_tracker_t tracker;
+  tracker.initialize( mesh, mesh.cells(), mesh.vertices(), 1, is_disturbed );
+  for ( std::size_t n=0; n<num_steps; ++n ) {
+    for ( auto v : tracker.vertices() ) tracked.solve_vertex( v, dt );
+    for ( auto v : tracker.all_vertices() ) tracked.x[v] += dt * tracked.u[v];
+    for ( auto c : tracker.cells() ) tracked.update_cell( c );
+    tracker.update( mesh, is_disturbed );
+  }
+
+  // the inactive updates vanish exactly, so the results match bit for bit
+  EXPECT_EQ( full.x, tracked.x );
+  EXPECT_EQ( full.u, tracked.u );
+  EXPECT_EQ( full.d, tracked.d );
+
+  // and the tracking skipped the gas ahead of the wave
+  EXPECT_GT( full.d[0], ambient.density );
+  EXPECT_LT( tracker.active_fraction(), 0.5 );
+
+} // TEST
@@ -0,0 +1,84 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the ensemble inputs and clock.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <algorithm>
+#include <stdexcept>
+
+// user includes
+#include "../ensemble.h"
+
+using namespace apps::common;
+
+//! \brief an equation of state that only keeps its parameters
+struct gas_t {
+  double gamma = 1.4;
+  double cv = 1;
+  void set_gamma( double g ) { gamma = g; }
+  void set_specific_heat_v( double c ) { cv = c; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the members override the base equation of state
+///////////////////////////////////////////////////////////////////////////////
+TEST(ensemble, eos) {
+
+  ensemble_inputs_t inputs;
+  inputs.members.resize( 2 );
+  inputs.members[1].gas_constant = 1.67;
+
+  auto eos = inputs.eos( gas_t{} );
+  ASSERT_EQ( eos.size(), max_ensemble_members );
+  EXPECT_EQ( eos[0].gamma, 1.4 );
+  EXPECT_EQ( eos[1].gamma, 1.67 );
+  EXPECT_EQ( eos[1].cv, 1 );
+
+  EXPECT_EQ( ensemble_time_step( "shared" ), ensemble_time_step_t::shared );
+  EXPECT_EQ( ensemble_time_step( "independent" ),
+    ensemble_time_step_t::independent );
+  EXPECT_THROW( ensemble_time_step( "fastest" ), std::exception );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that each member runs on its own clock to the final time
+///////////////////////////////////////////////////////////////////////////////
+TEST(ensemble, clock) {
+
+  ensemble_clock_t clock( 2, 1 );
+  member_array_t<double> steps;
+  steps.fill( 0 );
+
+  // the second member takes steps four times as large
+  size_t num_steps = 0;
+  while ( !clock.is_finished() ) {
+    steps[0] = std::min( 0.3, clock.remaining(0) );
+    steps[1] = std::min( 1.2, clock.remaining(1) );
+    if ( clock.is_finished(1) ) steps[1] = 0;
+    clock.advance( steps );
+    ++num_steps;
+  }
+
+  // the last steps land on the final time exactly
+  EXPECT_EQ( num_steps, 4 );
+  EXPECT_EQ( clock.time(0), 1 );
+  EXPECT_EQ( clock.time(1), 1 );
+  EXPECT_EQ( clock.remaining(0), 0 );
+
+  // a member that is not finished has to advance
+  ensemble_clock_t stalled( 2, 1 );
+  steps[0] = 0.5;
+  steps[1] = 0;
+  EXPECT_THROW( stalled.advance( steps ), std::exception );
+
+} // TEST
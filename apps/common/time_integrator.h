@@ -0,0 +1,76 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief The strong stability preserving Runge-Kutta schemes.
+///
+/// Every scheme is written in the low-storage form
+/// \f[
+///   u^{(i)} = a_i u^n + (1-a_i) \left( u^{(i-1)} + \Delta t L(u^{(i-1)}) \right)
+/// \f]
+/// so only the current state and the state at the start of the step have to
+/// be stored.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <string>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The available time integrators.
+///////////////////////////////////////////////////////////////////////////////
+enum class time_integrator_t
+{
+  forward_euler,
+  ssp_rk2,
+  ssp_rk3
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Convert a time integrator name to its enum.
+//! \param [in] name  One of "forward_euler", "ssp_rk2" or "ssp_rk3".
+///////////////////////////////////////////////////////////////////////////////
+inline time_integrator_t time_integrator( const std::string & name )
+{
+  if ( name == "forward_euler" )
+    return time_integrator_t::forward_euler;
+  else if ( name == "ssp_rk2" )
+    return time_integrator_t::ssp_rk2;
+  else if ( name == "ssp_rk3" )
+    return time_integrator_t::ssp_rk3;
+  else
+    THROW_RUNTIME_ERROR( "Unknown time integrator \"" << name << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The weights of the state at the start of the step, one per stage.
+//!
+//! The first stage is always a forward Euler step, so its weight is zero.
+//! \param [in] type  The time integrator.
+///////////////////////////////////////////////////////////////////////////////
+inline const std::vector<double> & ssp_stages( time_integrator_t type )
+{
+  static const std::vector<double> euler = { 0. };
+  static const std::vector<double> rk2 = { 0., 1./2. };
+  static const std::vector<double> rk3 = { 0., 3./4., 1./3. };
+  switch ( type ) {
+    case time_integrator_t::ssp_rk2:
+      return rk2;
+    case time_integrator_t::ssp_rk3:
+      return rk3;
+    default:
+      return euler;
+  }
+}
+
+} // namespace
+} // namespace
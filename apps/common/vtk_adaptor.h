@@ -0,0 +1,217 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+/// \file
+/// \brief A persistent VTK view of the mesh and the solver fields.
+///
+/// The unstructured grid topology is built once.  The cell fields are copied
+/// into VTK arrays that the grid owns and reuses from call to call, so the
+/// grid stays valid after the task that filled it has returned and the
+/// runtime is free to move the solver storage.  Moving meshes also need to
+/// refresh the points.
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <flecsale-config.h>
+#include <ristra/assertions/errors.h>
+
+#ifdef FLECSALE_ENABLE_VTK
+#  include <vtkAOSDataArrayTemplate.h>
+#  include <vtkCellData.h>
+#  include <vtkCellType.h>
+#  include <vtkDoubleArray.h>
+#  include <vtkFieldData.h>
+#  include <vtkPoints.h>
+#  include <vtkSmartPointer.h>
+#  include <vtkUnstructuredGrid.h>
+#  include <vtkXMLUnstructuredGridWriter.h>
+#endif
+
+// system includes
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace apps {
+namespace common {
+
+#ifdef FLECSALE_ENABLE_VTK
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A persistent VTK unstructured grid with copies of the solver fields.
+//! \tparam T  The real type.
+//! \tparam D  The number of dimensions.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, std::size_t D >
+class vtk_adaptor_u {
+
+public:
+
+  //! the VTK array type of the cell fields
+  using array_t = vtkAOSDataArrayTemplate<T>;
+
+  //! \brief Create an empty grid.
+  vtk_adaptor_u() :
+    grid_( vtkSmartPointer<vtkUnstructuredGrid>::New() ),
+    points_( vtkSmartPointer<vtkPoints>::New() )
+  {
+    points_->SetDataTypeToDouble();
+    grid_->SetPoints( points_ );
+  }
+
+  //! \brief Return true once the topology has been built.
+  bool has_topology() const
+  { return has_topology_; }
+
+  //! \brief Build the points and the owned cells.
+  //! \param [in] mesh  The mesh to convert.
+  template< typename M >
+  void build_topology( const M & mesh )
+  {
+    update_points( mesh );
+
+    std::vector<vtkIdType> ids, faces;
+    grid_->Allocate( mesh.num_cells() );
+
+    for ( auto c : mesh.cells(flecsi::owned) ) {
+
+      ids.clear();
+      for ( auto v : mesh.vertices(c) ) ids.emplace_back( v.id() );
+
+      if ( D < 3 ) {
+        grid_->InsertNextCell( VTK_POLYGON, ids.size(), ids.data() );
+        continue;
+      }
+
+      // polyhedra are described by their faces
+      faces.clear();
+      vtkIdType num_faces = 0;
+      for ( auto f : mesh.faces(c) ) {
+        auto start = faces.size();
+        faces.emplace_back( 0 );
+        for ( auto v : mesh.vertices(f) ) faces.emplace_back( v.id() );
+        faces[start] = faces.size() - start - 1;
+        ++num_faces;
+      }
+      grid_->InsertNextCell(
+        VTK_POLYHEDRON, ids.size(), ids.data(), num_faces, faces.data()
+      );
+
+    }
+
+    has_topology_ = true;
+  }
+
+  //! \brief Copy the vertex coordinates into the points.
+  //! \param [in] mesh  The mesh to convert.
+  template< typename M >
+  void update_points( const M & mesh )
+  {
+    points_->SetNumberOfPoints( mesh.num_vertices() );
+    for ( auto v : mesh.vertices() ) {
+      double x[3] = {0, 0, 0};
+      const auto & coord = v->coordinates();
+      for ( std::size_t d=0; d<D; ++d ) x[d] = coord[d];
+      points_->SetPoint( v.id(), x );
+    }
+    points_->Modified();
+  }
+
+  //! \brief Copy a cell field into the grid.
+  //!
+  //! The array is created on the first call and refilled after that.
+  //! \param [in] name  The name of the array.
+  //! \param [in] cells  The owned cells.
+  //! \param [in] get  Return a reference to the value of a cell, either a T
+  //!                  or a packed array of T.
+  template< typename R, typename G >
+  void add_cell_field( const std::string & name, R && cells, G && get )
+  {
+    using value_t = std::decay_t< decltype( get( *std::begin(cells) ) ) >;
+    static_assert( sizeof(value_t) % sizeof(T) == 0,
+      "values must be packed arrays of the component type" );
+    constexpr auto components = sizeof(value_t) / sizeof(T);
+
+    auto & arr = arrays_[name];
+    if ( !arr ) {
+      arr = vtkSmartPointer<array_t>::New();
+      arr->SetName( name.c_str() );
+      arr->SetNumberOfComponents( components );
+      grid_->GetCellData()->AddArray( arr );
+    }
+
+    arr->SetNumberOfTuples( cells.size() );
+    auto data = arr->GetPointer( 0 );
+    for ( auto && c : cells ) {
+      std::memcpy( data, std::addressof( get(c) ), sizeof(value_t) );
+      data += components;
+    }
+    arr->Modified();
+  }
+
+  //! \brief Attach the solution time to the grid.
+  void set_time( double time )
+  {
+    if ( !time_ ) {
+      time_ = vtkSmartPointer<vtkDoubleArray>::New();
+      time_->SetName( "TimeValue" );
+      time_->SetNumberOfTuples( 1 );
+      grid_->GetFieldData()->AddArray( time_ );
+    }
+    time_->SetValue( 0, time );
+    time_->Modified();
+  }
+
+  //! \brief Return the grid.
+  vtkUnstructuredGrid * grid()
+  { return grid_.GetPointer(); }
+
+  //! \brief Write the grid to a .vtu file.
+  //! \param [in] filename  The name of the file to write.
+  void write( const std::string & filename )
+  {
+    auto writer = vtkSmartPointer<vtkXMLUnstructuredGridWriter>::New();
+    writer->SetFileName( filename.c_str() );
+    writer->SetInputData( grid_ );
+    writer->SetDataModeToAppended();
+    if ( !writer->Write() )
+      THROW_RUNTIME_ERROR( "Could not write \"" << filename << "\"" );
+  }
+
+private:
+
+  //! the grid
+  vtkSmartPointer<vtkUnstructuredGrid> grid_;
+  //! the points of the grid
+  vtkSmartPointer<vtkPoints> points_;
+  //! true once the topology has been built
+  bool has_topology_ = false;
+  //! the cell fields, by name
+  std::map< std::string, vtkSmartPointer<array_t> > arrays_;
+  //! the solution time
+  vtkSmartPointer<vtkDoubleArray> time_;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The VTK adaptor of this process.
+//!
+//! It lives for the whole run so the topology is only built once.
+///////////////////////////////////////////////////////////////////////////////
+template< typename T, std::size_t D >
+vtk_adaptor_u<T,D> & vtk_adaptor()
+{
+  static vtk_adaptor_u<T,D> adaptor;
+  return adaptor;
+}
+
+#endif // FLECSALE_ENABLE_VTK
+
+} // namespace
+} // namespace
@@ -41,6 +41,43 @@ eos_t inputs_t::eos =
     /* gamma */ 1.4, /* cv */ 1.0
   );
 
+// the diagnostics are off by default
+diagnostics_inputs_t inputs_t::diagnostics = {};
+
+// the fields are written to exodus files by default
+field_output_inputs_t inputs_t::field_output = {};
+
+// there is no python analysis by default
+analysis_inputs_t inputs_t::analysis = {};
+
+// the face states are first order by default
+reconstruction_inputs_t inputs_t::reconstruction = {};
+
+// take single forward euler steps by default
+time_integrator_t inputs_t::time_integrator =
+  time_integrator_t::forward_euler;
+
+// every cell takes the global time step by default
+local_time_stepping_inputs_t inputs_t::local_time_stepping = {};
+
+// the solution is marched in time by default
+steady_state_inputs_t inputs_t::steady_state = {};
+
+// the ghosts are exchanged before every flux evaluation by default
+bool inputs_t::overlap_halo_exchange = false;
+
+// every state field is exchanged on its own by default
+bool inputs_t::aggregate_halo_exchange = false;
+
+// every cell gathers the fluxes of its faces by default
+flux_accumulation_t inputs_t::flux_accumulation = flux_accumulation_t::gather;
+
+// the fields use regular pages by default
+bool inputs_t::huge_pages = false;
+
+// a single run, with no ensemble, by default
+ensemble_inputs_t inputs_t::ensemble = {};
+
 // this is a function to set the initial conditions
 inputs_t::ics_return_t inputs_t::initial_conditions(
   const mesh_t & mesh, size_t local_id, const real_t & )
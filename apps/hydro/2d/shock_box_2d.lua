@@ -8,6 +8,13 @@ hydro = {
   final_time = 0.2,
   max_steps = 20,
   CFL = 1./2.,
+  -- conservation checks and probe histories
+  diagnostics = {
+    frequency = 5,
+    format = "csv",
+    shock = { origin = {0,0}, pressure = 0.5 },
+    probes = { {-0.25,-0.25}, {0.25,0.25} }
+  },
   -- the equation of state
   eos = {
     type = "ideal_gas",
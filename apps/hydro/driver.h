@@ -20,21 +20,25 @@
 
 
 // system includes
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 namespace apps {
 namespace hydro {
   
 // create some field data.  Fields are registered as struct of arrays.
-// this allows us to access the data in different patterns.
+// this allows us to access the data in different patterns.  The bulk fields
+// use the stored types, which are single precision in mixed precision builds.
 flecsi_register_field(
   mesh_t, 
   hydro,  
   density,   
-  mesh_t::real_t, 
+  stored_real_t, 
   dense, 
   1, 
   mesh_t::index_spaces_t::cells
@@ -44,7 +48,7 @@ flecsi_register_field(
   mesh_t, 
   hydro, 
   velocity,
-  mesh_t::vector_t,
+  stored_vector_t,
   dense,
   1,
   mesh_t::index_spaces_t::cells
@@ -54,7 +58,7 @@ flecsi_register_field(
   mesh_t, 
   hydro,
   internal_energy,
-  mesh_t::real_t,
+  stored_real_t,
   dense,
   1,
   mesh_t::index_spaces_t::cells
@@ -64,7 +68,7 @@ flecsi_register_field(
   mesh_t, 
   hydro, 
   pressure,
-  mesh_t::real_t, 
+  stored_real_t, 
   dense, 
   1, 
   mesh_t::index_spaces_t::cells
@@ -74,7 +78,7 @@ flecsi_register_field(
   mesh_t,
   hydro,
   temperature,
-  mesh_t::real_t,
+  stored_real_t,
   dense,
   1,
   mesh_t::index_spaces_t::cells
@@ -84,63 +88,266 @@ flecsi_register_field(
   mesh_t,
   hydro,
   sound_speed,
-  mesh_t::real_t,
+  stored_real_t,
   dense,
   1,
   mesh_t::index_spaces_t::cells
 );
 
+// the conserved quantities (mass, momentum and total energy) are stored
+// alongside the primitives so updates are a plain accumulation, and mass and
+// energy are only changed by the fluxes.  The primitives are kept too.  With
+// them, the flux of a face gathers the stored density, velocity, pressure
+// and sound speed of its two cells and makes no EOS call, and each cell
+// makes one EOS call per update.  With only the conserved quantities, every
+// face would rebuild the pressure and sound speed of both its cells, two
+// EOS calls per face, or about twice the number of cells in 2d and three
+// times in 3d, for every flux evaluation.
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  conserved, 
+  flux_data_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+// the conserved quantities at the start of the step, only used by the
+// multi-stage time integrators
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  conserved_old, 
+  flux_data_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+// the local time stepping class of each cell, and the time integrated
+// fluxes accumulated since its last update
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  time_class, 
+  time_class_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  flux_sum, 
+  flux_data_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+// the state the fluxes read packed into one record, only used when the
+// halo exchange is aggregated
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  halo_state, 
+  halo_state_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+// the density residual of each cell, only used in steady state mode
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  residual, 
+  real_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+// the limited gradients of the reconstructed variables, only used by the
+// second order scheme
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  gradient, 
+  stored_gradient_data_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+// the state, conserved quantities and face fluxes of every ensemble member,
+// only used when an ensemble runs
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  ensemble_state, 
+  ensemble_state_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  ensemble_conserved, 
+  ensemble_flux_data_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::cells
+);
+
+flecsi_register_field(
+  mesh_t, 
+  hydro, 
+  ensemble_flux, 
+  stored_ensemble_flux_data_t, 
+  dense, 
+  1,
+  mesh_t::index_spaces_t::faces
+);
+
 // Here I am regestering a struct as the stored data
 // type since I will only ever be accesissing all the data at once.
 flecsi_register_field(
   mesh_t, 
   hydro, 
   flux, 
-  flux_data_t, 
+  stored_flux_data_t, 
   dense, 
   1,
   mesh_t::index_spaces_t::faces
 );
 
 ///////////////////////////////////////////////////////////////////////////////
-//! \brief A sample test of the hydro solver
+//! \brief Evaluate the global diagnostics and probes.
+//!
+//! Every rank must call this since it launches the reductions.  Only the
+//! rank that owns a writer appends the row.
+//!
+//! \param [in] mesh  the mesh client handle
+//! \param [in] writer  the history file, null on all but one rank
+//! \param [in] step  the current step
+//! \param [in] time  the current solution time
+//! \param [in] d,v,e,p  the density, velocity, energy and pressure handles
 ///////////////////////////////////////////////////////////////////////////////
-int driver(int argc, char** argv) 
-{
+template< typename M, typename D, typename V, typename E, typename P >
+void evaluate_diagnostics(
+  M & mesh,
+  apps::common::diagnostics_writer_t * writer,
+  size_t step,
+  real_t time,
+  D & d, V & v, E & e, P & p
+) {
+  
+  constexpr auto num_dims = mesh_t::num_dimensions;
+  const auto & inputs = inputs_t::diagnostics;
+  const auto & origin = inputs.shock_origin;
+  const auto & shock_pressure = inputs.shock_pressure;
 
-  // get the context
-  auto & context = flecsi::execution::context_t::instance();
-  auto rank = context.color();
+  // every reduction of a stage is launched before any of them is waited
+  // on, so an output step takes a few round trips, not one per quantity
+  auto launch_min = [&]( diagnostic_t quantity ) {
+    return flecsi_execute_reduction_task( evaluate_diagnostic, apps::hydro,
+      index, min, double, mesh, quantity, size_t{0}, origin, shock_pressure,
+      sum_request_t{}, d, v, e, p );
+  };
+  auto launch_max = [&]( diagnostic_t quantity, size_t i = 0,
+                         const sum_request_t & request = {} ) {
+    return flecsi_execute_reduction_task( evaluate_diagnostic, apps::hydro,
+      index, max, double, mesh, quantity, i, origin, shock_pressure,
+      request, d, v, e, p );
+  };
+  auto launch_sum = [&]( diagnostic_t quantity, size_t i,
+                         const sum_request_t & request ) {
+    return flecsi_execute_reduction_task( evaluate_diagnostic, apps::hydro,
+      index, sum, double, mesh, quantity, i, origin, shock_pressure,
+      request, d, v, e, p );
+  };
 
-  //===========================================================================
-  // Mesh Setup
-  //===========================================================================
+  // the extrema and the probe owners take one reduction each
+  auto min_density = launch_min( diagnostic_t::min_density );
+  auto max_density = launch_max( diagnostic_t::max_density );
+  auto min_pressure = launch_min( diagnostic_t::min_pressure );
+  auto max_pressure = launch_max( diagnostic_t::max_pressure );
+  auto shock_radius = launch_max( diagnostic_t::shock_radius );
 
-  // get the client handle
-  auto mesh = flecsi_get_client_handle(mesh_t, meshes, mesh0);
+  auto launch_distance = [&]( const vector_t & x ) {
+    return flecsi_execute_reduction_task( sample_probe, apps::hydro, index,
+      min, double, mesh, probe_t::distance, size_t{0}, x, real_t{0},
+      d, v, p );
+  };
+  std::vector< decltype( launch_distance( origin ) ) > distances;
+  for ( const auto & x : inputs.probes )
+    distances.emplace_back( launch_distance( x ) );
 
-  // make sure geometry is up to date
-  auto f = flecsi_execute_task(
-	  update_geometry,
-	  apps::hydro,
-	  index,
-	  mesh
-	  );
-  f.wait(); // DONT GO FORWARD UNTIL DONE!
+  // the integrals share the stages of their sums
+  std::vector< std::pair<diagnostic_t, size_t> > integrals;
+  integrals.emplace_back( diagnostic_t::mass, 0 );
+  for ( size_t dim=0; dim<num_dims; ++dim )
+    integrals.emplace_back( diagnostic_t::momentum, dim );
+  integrals.emplace_back( diagnostic_t::total_energy, 0 );
 
-  // get the input file
-  auto args = apps::common::process_arguments( argc, argv );
-  auto input_file_name =
-    args.count("f") ? args.at("f") : std::string();
+  auto totals = apps::common::global_sums( integrals.size(),
+    [&]( size_t j, const sum_request_t & request ) {
+      return launch_max( integrals[j].first, integrals[j].second, request );
+    },
+    [&]( size_t j, const sum_request_t & request ) {
+      return launch_sum( integrals[j].first, integrals[j].second, request );
+    } );
 
-  // override any inputs if need be
-  if ( !input_file_name.empty() ) {
-    std::cout << "Using input file \"" << input_file_name << "\"."
-              << std::endl;
-    inputs_t::load( input_file_name );
+  std::vector<double> row{ static_cast<double>(step), time };
+  row.insert( row.end(), totals.begin(), totals.end() );
+  row.emplace_back( min_density.get() );
+  row.emplace_back( max_density.get() );
+  row.emplace_back( min_pressure.get() );
+  row.emplace_back( max_pressure.get() );
+  row.emplace_back( shock_radius.get() );
+
+  // the owner of each probe is the rank with the nearest cell, and the
+  // samples of all the probes are launched together
+  auto launch_sample = [&]( const vector_t & x, real_t dist,
+                            probe_t quantity, size_t i = 0 ) {
+    return flecsi_execute_reduction_task( sample_probe, apps::hydro, index,
+      max, double, mesh, quantity, i, x, dist, d, v, p );
+  };
+  std::vector< decltype( launch_sample( origin, 0, probe_t::density ) ) >
+    samples;
+  for ( size_t n=0; n<inputs.probes.size(); ++n ) {
+    const auto & x = inputs.probes[n];
+    real_t dist = distances[n].get();
+    samples.emplace_back( launch_sample( x, dist, probe_t::density ) );
+    samples.emplace_back( launch_sample( x, dist, probe_t::pressure ) );
+    for ( size_t dim=0; dim<num_dims; ++dim )
+      samples.emplace_back( launch_sample( x, dist, probe_t::velocity, dim ) );
   }
+  for ( auto & s : samples ) row.emplace_back( s.get() );
 
-  // cout << mesh;
+  if ( writer ) writer->write( row );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Solve one case on a mesh that is set up.
+//!
+//! \param [in] mesh  the mesh client handle
+//! \param [in,out] f  the future of the last task
+//! \param [in] rank  the rank of this process
+//! \param [in] input_file_name  the lua input file, may be empty
+///////////////////////////////////////////////////////////////////////////////
+template< typename M, typename FUTURE >
+int solve(
+  M & mesh,
+  FUTURE & f,
+  size_t rank,
+  const std::string & input_file_name
+) {
 
   //===========================================================================
   // Some typedefs
@@ -158,23 +365,39 @@ int driver(int argc, char** argv)
   // Access what we need
   //===========================================================================
   
-  auto d  = flecsi_get_handle(mesh, hydro,  density,   real_t, dense, 0);
-  //auto d0 = flecsi_get_handle(mesh, hydro,  density,   real_t, dense, 1);
-  auto v  = flecsi_get_handle(mesh, hydro, velocity, vector_t, dense, 0);
-  //auto v0 = flecsi_get_handle(mesh, hydro, velocity, vector_t, dense, 1);
-  auto e  = flecsi_get_handle(mesh, hydro, internal_energy, real_t, dense, 0);
-  //auto e0 = flecsi_get_handle(mesh, hydro, internal_energy, real_t, dense, 1);
+  auto d  = flecsi_get_handle(mesh, hydro,  density,   stored_real_t, dense, 0);
+  //auto d0 = flecsi_get_handle(mesh, hydro,  density,   stored_real_t, dense, 1);
+  auto v  = flecsi_get_handle(mesh, hydro, velocity, stored_vector_t, dense, 0);
+  //auto v0 = flecsi_get_handle(mesh, hydro, velocity, stored_vector_t, dense, 1);
+  auto e  = flecsi_get_handle(mesh, hydro, internal_energy, stored_real_t, dense, 0);
+  //auto e0 = flecsi_get_handle(mesh, hydro, internal_energy, stored_real_t, dense, 1);
+
+  auto p  = flecsi_get_handle(mesh, hydro,        pressure,   stored_real_t, dense, 0);
+  auto T  = flecsi_get_handle(mesh, hydro,     temperature, stored_real_t, dense, 0);
+  auto a  = flecsi_get_handle(mesh, hydro,     sound_speed, stored_real_t, dense, 0);
+
+  auto q  = flecsi_get_handle(mesh, hydro,       conserved, flux_data_t, dense, 0);
+  auto q0 = flecsi_get_handle(mesh, hydro,   conserved_old, flux_data_t, dense, 0);
+  auto K  = flecsi_get_handle(mesh, hydro,      time_class, time_class_t, dense, 0);
+  auto Q  = flecsi_get_handle(mesh, hydro,        flux_sum, flux_data_t, dense, 0);
 
-  auto p  = flecsi_get_handle(mesh, hydro,        pressure,   real_t, dense, 0);
-  auto T  = flecsi_get_handle(mesh, hydro,     temperature, real_t, dense, 0);
-  auto a  = flecsi_get_handle(mesh, hydro,     sound_speed, real_t, dense, 0);
+  auto R  = flecsi_get_handle(mesh, hydro,        residual, real_t, dense, 0);
+  auto H  = flecsi_get_handle(mesh, hydro,      halo_state, halo_state_t, dense, 0);
 
-  auto F = flecsi_get_handle(mesh, hydro, flux, flux_data_t, dense, 0);
+  auto G = flecsi_get_handle(mesh, hydro, gradient, stored_gradient_data_t, dense, 0);
+
+  auto F = flecsi_get_handle(mesh, hydro, flux, stored_flux_data_t, dense, 0);
 
   //===========================================================================
   // Initial conditions
   //===========================================================================
  
+  // report where the threads run, and spread the field pages over the
+  // sockets before the initial conditions write to them
+  flecsi_execute_task( report_thread_bindings, apps::hydro, index, mesh );
+  flecsi_execute_task( first_touch_fields, apps::hydro, index, mesh,
+    inputs_t::huge_pages, d, v, e, p, T, a, q, q0, K, Q, R, H, G, F );
+
   // the solution time starts at zero
   real_t soln_time{0};  
   size_t time_cnt{0}; 
@@ -191,7 +414,7 @@ int driver(int argc, char** argv)
 		  inputs_t::eos,
 		  soln_time,
 		  filename_char,
-		  d, v, e, p, T, a);
+		  d, v, e, p, T, a, q);
   } else {
 	  f = flecsi_execute_task(
 		  initial_conditions,
@@ -200,9 +423,33 @@ int driver(int argc, char** argv)
 		  mesh,
 		  inputs_t::eos,
 		  soln_time,
-		  d, v, e, p, T, a);
+		  d, v, e, p, T, a, q);
   }
 
+  // the diagnostics history is only written by the first rank
+  std::unique_ptr<apps::common::diagnostics_writer_t> diagnostics_file;
+  auto has_diagnostics = (inputs_t::diagnostics.frequency > 0);
+  if ( has_diagnostics && rank == 0 ) {
+    auto ext = inputs_t::diagnostics.binary ? ".bin" : ".csv";
+    diagnostics_file = std::make_unique<apps::common::diagnostics_writer_t>(
+      inputs_t::prefix + "-diagnostics" + ext,
+      apps::common::diagnostics_columns( 
+        mesh_t::num_dimensions, inputs_t::diagnostics.probes.size() ),
+      inputs_t::diagnostics.binary
+    );
+  }
+
+  if ( has_diagnostics )
+    evaluate_diagnostics(
+      mesh, diagnostics_file.get(), time_cnt, soln_time, d, v, e, p );
+
+#ifdef FLECSALE_ENABLE_PYTHON
+  // run the in situ analysis on the initial conditions
+  if ( inputs_t::analysis.frequency > 0 )
+    flecsi_execute_task( python_analysis, apps::hydro, index, mesh,
+      time_cnt, soln_time, d, v, p );
+#endif
+
   #ifdef HAVE_CATALYST
     auto insitu = io::catalyst::adaptor_t(catalyst_scripts);
     std::cout << "Catalyst on!" << std::endl;
@@ -233,6 +480,56 @@ int driver(int argc, char** argv)
     f.wait();
   }
 #endif
+
+  // the updates skip the temperature, so it is only computed when something
+  // is about to read it
+  bool temperature_stale = false;
+  auto materialize_temperature = [&]() {
+    if ( !temperature_stale ) return;
+    flecsi_execute_task( update_temperature, apps::hydro, index, mesh,
+      inputs_t::eos, d, v, e, p, T, a );
+    temperature_stale = false;
+  };
+
+  // the compressed and vtu fields do not go through exodus
+  const auto & field_format = inputs_t::field_output.format;
+  auto has_field_output =
+    (inputs_t::output_freq > 0 && field_format != output_format_t::exodus);
+
+  auto write_solution = [&]() {
+    materialize_temperature();
+#ifdef FLECSALE_ENABLE_VTK
+    if ( field_format == output_format_t::vtu ) {
+      flecsi_execute_task(
+        write_vtu,
+        apps::hydro,
+        index,
+        mesh,
+        prefix_char,
+        time_cnt,
+        soln_time,
+        d, v, e, p, T, a
+      );
+      return;
+    }
+#endif
+    // the last aggregated output has to land before the next one
+    if ( inputs_t::field_output.aggregation.enabled() )
+      flecsi_execute_task( wait_fields, apps::hydro, index, mesh );
+    flecsi_execute_task(
+      write_fields,
+      apps::hydro,
+      index,
+      mesh,
+      prefix_char,
+      time_cnt,
+      soln_time,
+      d, v, e, p, T, a
+    );
+  };
+
+  if (has_field_output) write_solution();
+
   auto runtime = Legion::Runtime::get_runtime();
   auto ctx = Legion::Runtime::get_context();
 
@@ -247,46 +544,258 @@ int driver(int argc, char** argv)
   // start a clock
   auto tstart = ristra::utils::get_wall_time();
 
+  // local time stepping only subcycles first order forward euler steps
+  const auto & lts = inputs_t::local_time_stepping;
+  if ( lts.is_enabled() && (
+       inputs_t::time_integrator != time_integrator_t::forward_euler ||
+       inputs_t::reconstruction.is_second_order() ) )
+    THROW_RUNTIME_ERROR( "Local time stepping only supports first order "
+      "fluxes with the forward euler time integrator" );
+
+  // the steady state mode takes one local pseudo time step per iteration
+  const auto & steady = inputs_t::steady_state;
+  if ( steady.enabled && ( lts.is_enabled() ||
+       inputs_t::time_integrator != time_integrator_t::forward_euler ) )
+    THROW_RUNTIME_ERROR( "The steady state mode only supports the forward "
+      "euler time integrator without local time stepping" );
+  double initial_residual = 0;
+  bool converged = false;
+
+  // the packed exchange and the overlapped one are alternatives
+  if ( inputs_t::overlap_halo_exchange && inputs_t::aggregate_halo_exchange )
+    THROW_RUNTIME_ERROR( "The halo exchange can either be overlapped or "
+      "aggregated, but not both" );
+
+  // the interior and halo faces only have to be found once
+  if ( inputs_t::overlap_halo_exchange )
+    flecsi_execute_task( build_halo_split, apps::hydro, index, mesh );
+
+  // the faces are colored once for the scattered update
+  auto flux_accumulation = inputs_t::flux_accumulation;
+  if ( flux_accumulation != flux_accumulation_t::gather )
+    flecsi_execute_task( build_face_coloring, apps::hydro, index, mesh );
+
+  // time both sums on the initial fluxes and keep the faster one
+  if ( flux_accumulation == flux_accumulation_t::automatic ) {
+    flecsi_execute_task( evaluate_fluxes, apps::hydro, index, mesh,
+        d, v, e, p, T, a, q, F );
+    auto time_accumulation = [&]( flux_accumulation_t method ) -> double {
+      return flecsi_execute_reduction_task( time_flux_accumulation,
+        apps::hydro, index, max, double, mesh, method, size_t{10}, F ).get();
+    };
+    auto gather_time = time_accumulation( flux_accumulation_t::gather );
+    auto scatter_time = time_accumulation( flux_accumulation_t::scatter );
+    flux_accumulation = scatter_time < gather_time ?
+      flux_accumulation_t::scatter : flux_accumulation_t::gather;
+    if ( rank == 0 )
+      cout << "Summing the fluxes with a "
+           << ( flux_accumulation == flux_accumulation_t::scatter ?
+                "scatter" : "gather" )
+           << " (gather " << std::scientific << std::setprecision(2)
+           << gather_time << "s, scatter " << scatter_time << "s)."
+           << std::endl;
+  }
+
   //===========================================================================
   // Residual Evaluation
   //===========================================================================
 
   for ( 
     size_t num_steps = 0;
-    (num_steps < inputs_t::max_steps && soln_time < inputs_t::final_time); 
+    (num_steps < inputs_t::max_steps && soln_time < inputs_t::final_time &&
+     !converged); 
     ++num_steps 
   ) {   
-runtime->begin_trace(ctx, 42);
+    // the reclassification steps launch different tasks, and the steady
+    // state mode waits on its residual, so they can not be traced
+    auto is_traced = !lts.is_enabled() && !steady.enabled;
+    if ( is_traced ) runtime->begin_trace(ctx, 42);
+
+    // the physical time covered by this step, the pseudo time steps of the
+    // steady state mode do not advance it
+    real_t time_step = 0;
+
     //-------------------------------------------------------------------------
-    // compute the time step
+    // local time stepping, each class of cells subcycles within the step
 
-    // we dont need the time step yet
-    auto global_future_time_step = flecsi_execute_reduction_task(
-      evaluate_time_step, apps::hydro, index, min, double, mesh, d, v, e, p, T,
-			a, inputs_t::CFL, inputs_t::final_time - soln_time
-    );
+    if ( lts.is_enabled() ) {
+
+      // rebin the cells every so often
+      if ( lts.is_due( num_steps ) ) {
+        auto dt_min = flecsi_execute_reduction_task(
+          evaluate_time_step, apps::hydro, index, min, double, mesh,
+          d, v, e, p, T, a, inputs_t::CFL, inputs_t::final_time - soln_time
+        );
+        flecsi_execute_task( classify_cells, apps::hydro, index, mesh,
+          dt_min, lts.levels, inputs_t::CFL, d, v, e, p, T, a, K );
+      }
+
+      auto dt0 = flecsi_execute_reduction_task(
+        evaluate_base_time_step, apps::hydro, index, min, double, mesh, K,
+        d, v, e, p, T, a, inputs_t::CFL,
+        (inputs_t::final_time - soln_time) / lts.num_ticks()
+      );
+
+      for ( size_t tick = 0; tick < lts.num_ticks(); ++tick ) {
+        flecsi_execute_task( evaluate_class_fluxes, apps::hydro, index, mesh,
+          dt0, tick, K, d, v, e, p, T, a, q, F );
+        f = flecsi_execute_task( apply_class_update, apps::hydro, index, mesh,
+          inputs_t::eos, tick, K, F, d, v, e, p, T, a, q, Q );
+      }
+      temperature_stale = true;
+      time_step = dt0.get() * lts.num_ticks();
+
+    }
 
     //-------------------------------------------------------------------------
-    // try a timestep
+    // steady state, each cell takes its own pseudo time step
 
-    // compute the fluxes
-    flecsi_execute_task( evaluate_fluxes, apps::hydro, index, mesh,
-        d, v, e, p, T, a, F );
- 
-    //auto time_step = global_future_time_step.get();
+    else if ( steady.enabled ) {
 
-    // Loop over each cell, scattering the fluxes to the cell
-    f = flecsi_execute_task( 
-      apply_update, apps::hydro, index, mesh, inputs_t::eos,
-      global_future_time_step, F, d, v, e, p, T, a
-    );
+      // the face states are not advanced in pseudo time, so there is no
+      // global time step to reduce
+      const auto & recon = inputs_t::reconstruction;
+
+      if ( recon.is_second_order() ) {
+        flecsi_execute_task( evaluate_gradients, apps::hydro, index, mesh,
+            recon, d, v, e, p, T, a, G );
+        flecsi_execute_task( evaluate_steady_reconstructed_fluxes, apps::hydro,
+            index, mesh, inputs_t::eos, d, v, e, p, T, a, G, F );
+      }
+      else {
+        flecsi_execute_task( evaluate_fluxes, apps::hydro, index, mesh,
+            d, v, e, p, T, a, q, F );
+      }
+
+      f = flecsi_execute_task( apply_local_update, apps::hydro, index, mesh,
+        inputs_t::eos, inputs_t::CFL, F, d, v, e, p, T, a, q, R );
+      temperature_stale = true;
 
-runtime->end_trace(ctx, 42);
+      // the linf norm is a maximum, the others are sums
+      auto norm = steady.norm;
+      auto reduce_max = [&]( const sum_request_t & request ) -> double {
+        return flecsi_execute_reduction_task( evaluate_residual_norm,
+          apps::hydro, index, max, double, mesh, norm, request, R ).get();
+      };
+      auto reduce_sum = [&]( const sum_request_t & request ) -> double {
+        return flecsi_execute_reduction_task( evaluate_residual_norm,
+          apps::hydro, index, sum, double, mesh, norm, request, R ).get();
+      };
+      auto reduced = ( norm == residual_norm_t::linf ) ?
+        reduce_max( sum_request_t{} ) :
+        apps::common::global_sum( reduce_max, reduce_sum );
+      auto residual = apps::common::finish_residual_norm( norm, reduced );
+
+      if ( num_steps == 0 ) initial_residual = residual;
+      converged = steady.is_converged( residual, initial_residual );
+
+      if ( rank == 0 && ( steady.is_due( num_steps ) || converged ) ) {
+        auto ss = cout.precision();
+        cout.setf( std::ios::scientific );
+        cout.precision(6);
+        cout << "|  Iteration:" << std::setw(10) << num_steps
+             << "  |  Residual:" << std::setw(14) << residual
+             << "  |  Relative:" << std::setw(14)
+             << ( initial_residual > 0 ? residual / initial_residual : 0 )
+             << "  |" << std::endl;
+        cout.unsetf( std::ios::scientific );
+        cout.precision(ss);
+      }
+
+    }
+
+    else {
+
+      //-----------------------------------------------------------------------
+      // compute the time step
+
+      // we dont need the time step yet
+      auto global_future_time_step = flecsi_execute_reduction_task(
+        evaluate_time_step, apps::hydro, index, min, double, mesh,
+        d, v, e, p, T, a, inputs_t::CFL, inputs_t::final_time - soln_time
+      );
+
+      //-----------------------------------------------------------------------
+      // try a timestep
+
+      // the multi-stage schemes need the state at the start of the step
+      const auto & stages = apps::common::ssp_stages( inputs_t::time_integrator );
+      if ( stages.size() > 1 )
+        flecsi_execute_task( save_state, apps::hydro, index, mesh, q, q0 );
+
+      // the half step predictor is only consistent with forward euler
+      auto recon = inputs_t::reconstruction;
+      if ( stages.size() > 1 ) recon.predictor = false;
+
+      for ( const auto & old_weight : stages ) {
+
+        // compute the fluxes, either from the cell values or from states
+        // reconstructed at the faces
+        if ( recon.is_second_order() ) {
+          flecsi_execute_task( evaluate_gradients, apps::hydro, index, mesh,
+              recon, d, v, e, p, T, a, G );
+          flecsi_execute_task( evaluate_reconstructed_fluxes, apps::hydro, index,
+              mesh, inputs_t::eos, recon, global_future_time_step,
+              d, v, e, p, T, a, G, F );
+        }
+        // only the packed state is exchanged
+        else if ( inputs_t::aggregate_halo_exchange ) {
+          flecsi_execute_task( pack_halo_state, apps::hydro, index, mesh,
+              d, v, e, p, a, H );
+          flecsi_execute_task( evaluate_packed_fluxes, apps::hydro, index,
+              mesh, H, F );
+        }
+        // the interior faces do not wait for the ghosts, the update that
+        // follows still waits for the halo faces
+        else if ( inputs_t::overlap_halo_exchange ) {
+          flecsi_execute_task( evaluate_interior_fluxes, apps::hydro, index,
+              mesh, d, v, e, p, T, a, q, F );
+          flecsi_execute_task( evaluate_halo_fluxes, apps::hydro, index,
+              mesh, d, v, e, p, T, a, q, F );
+        }
+        else {
+          flecsi_execute_task( evaluate_fluxes, apps::hydro, index, mesh,
+              d, v, e, p, T, a, q, F );
+        }
+
+        // Loop over each cell, scattering the fluxes to the cell.  Every
+        // stage uses the time step of the state at the start of the step.
+        if ( old_weight == 0 &&
+                  flux_accumulation == flux_accumulation_t::scatter )
+          f = flecsi_execute_task( 
+            apply_scattered_update, apps::hydro, index, mesh, inputs_t::eos,
+            global_future_time_step, F, d, v, e, p, T, a, q
+          );
+        else if ( old_weight == 0 )
+          f = flecsi_execute_task( 
+            apply_update, apps::hydro, index, mesh, inputs_t::eos,
+            global_future_time_step, F, d, v, e, p, T, a, q
+          );
+        else
+          f = flecsi_execute_task( 
+            apply_stage_update, apps::hydro, index, mesh, inputs_t::eos,
+            global_future_time_step, static_cast<real_t>(old_weight),
+            F, d, v, e, p, T, a, q, q0
+          );
+        temperature_stale = true;
+
+      } // stages
+
+      // the next step is clipped to the final time, so it waits anyway
+      time_step = global_future_time_step.get();
+
+    } // local time stepping
+
+    if ( is_traced ) runtime->end_trace(ctx, 42);
     //-------------------------------------------------------------------------
     // Post-process
 
-    // update time
-    //soln_time += time_step;
+    // update time, a step that does not advance it would repeat until
+    // max_steps
+    if ( !steady.enabled && !( time_step > 0 ) )
+      THROW_RUNTIME_ERROR( "The time step " << time_step
+        << " does not advance the solution time " << soln_time );
+    soln_time += time_step;
     time_cnt++;
 
     // output the time step
@@ -305,9 +814,30 @@ runtime->end_trace(ctx, 42);
     }
 #endif
 
+    // stream the diagnostics
+    if ( inputs_t::diagnostics.is_due( time_cnt ) )
+      evaluate_diagnostics(
+        mesh, diagnostics_file.get(), time_cnt, soln_time, d, v, e, p );
+
+#ifdef FLECSALE_ENABLE_PYTHON
+    // run the in situ analysis
+    if ( inputs_t::analysis.is_due( time_cnt ) )
+      flecsi_execute_task( python_analysis, apps::hydro, index, mesh,
+        time_cnt, soln_time, d, v, p );
+#endif
+
 #ifdef HAVE_CATALYST
     if (!catalyst_scripts.empty()) {
+#ifdef FLECSALE_ENABLE_VTK
+      // the grid is built once and holds its own copy of the fields
+      materialize_temperature();
+      flecsi_execute_task( update_vtk, apps::hydro, index, mesh,
+        soln_time, d, v, e, p, T, a );
+      auto vtk_grid =
+        apps::common::vtk_adaptor<stored_real_t, mesh_t::num_dimensions>().grid();
+#else
       auto vtk_grid = mesh::to_vtk( mesh );
+#endif
       insitu.process( 
         vtk_grid, soln_time, num_steps, (num_steps==inputs_t::max_steps-1)
       );
@@ -323,6 +853,7 @@ runtime->end_trace(ctx, 42);
         )  
       ) 
     {
+      materialize_temperature();
       flecsi_execute_task(
         output,
 	 			apps::hydro,
@@ -337,11 +868,28 @@ runtime->end_trace(ctx, 42);
     }
 
 #endif
+
+    // now output the compressed or vtu fields
+    if ( has_field_output && 
+        (time_cnt % inputs_t::output_freq == 0 || 
+         num_steps==inputs_t::max_steps-1 ||
+         std::abs(soln_time-inputs_t::final_time) < epsilon
+        )  
+      ) 
+      write_solution();
+
   }
 
   //===========================================================================
   // Post-process
   //===========================================================================
+
+  // complete the last output, and free the communicators of the writer
+  // groups before MPI shuts down
+  if ( field_format == output_format_t::compressed && has_field_output &&
+       inputs_t::field_output.aggregation.enabled() )
+    flecsi_execute_task( finish_fields, apps::hydro, index, mesh );
+
   f.wait();    
   auto tdelta = ristra::utils::get_wall_time() - tstart;
 
@@ -351,6 +899,10 @@ runtime->end_trace(ctx, 42);
          << std::scientific << std::setprecision(2) << soln_time
          << " after " << time_cnt << " steps." << std::endl;
 
+    if ( steady.enabled )
+      cout << "The residual " << ( converged ? "dropped" : "did not drop" )
+           << " by " << steady.orders << " orders of magnitude." << std::endl;
+
     
     std::cout << "Elapsed wall time is " << std::setprecision(4) << std::fixed 
               << tdelta << "s." << std::endl;
@@ -371,5 +923,296 @@ runtime->end_trace(ctx, 42);
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Solve every ensemble member together on a mesh that is set up.
+//!
+//! The state of all the members lives in the ensemble fields, and each step
+//! evaluates and applies the fluxes of all of them in one face loop and one
+//! cell loop.  The output and diagnostics copy one member at a time into the
+//! state fields, and write it under a prefix of its own.
+//!
+//! Only first order forward euler steps are supported.  The fluxes are
+//! always gathered, and the ensemble state is always exchanged as one packed
+//! field, so the halo exchange and flux accumulation inputs do not apply.
+//!
+//! \param [in] mesh  the mesh client handle
+//! \param [in,out] f  the future of the last task
+//! \param [in] rank  the rank of this process
+//! \param [in] input_file_name  the lua input file, may be empty
+///////////////////////////////////////////////////////////////////////////////
+template< typename M, typename FUTURE >
+int solve_ensemble(
+  M & mesh,
+  FUTURE & f,
+  size_t rank,
+  const std::string & input_file_name
+) {
+
+  //===========================================================================
+  // Some typedefs
+  //===========================================================================
+
+  using size_t = typename mesh_t::size_t;
+  using real_t = typename mesh_t::real_t;
+
+  const auto & ensemble = inputs_t::ensemble;
+  auto num_members = ensemble.size();
+  auto eos = ensemble.eos( inputs_t::eos );
+  auto is_shared = ( ensemble.time_step == ensemble_time_step_t::shared );
+
+  // the members only take first order forward euler steps
+  if ( inputs_t::local_time_stepping.is_enabled() ||
+       inputs_t::steady_state.enabled ||
+       inputs_t::time_integrator != time_integrator_t::forward_euler ||
+       inputs_t::reconstruction.is_second_order() )
+    THROW_RUNTIME_ERROR( "An ensemble only supports first order fluxes with "
+      "the forward euler time integrator" );
+
+  if ( inputs_t::analysis.frequency > 0 )
+    THROW_RUNTIME_ERROR( "The in situ analysis does not support ensembles" );
+
+  //===========================================================================
+  // Access what we need
+  //===========================================================================
+
+  auto W  = flecsi_get_handle(mesh, hydro, ensemble_state, ensemble_state_t, dense, 0);
+  auto q  = flecsi_get_handle(mesh, hydro, ensemble_conserved, ensemble_flux_data_t, dense, 0);
+  auto F  = flecsi_get_handle(mesh, hydro, ensemble_flux, stored_ensemble_flux_data_t, dense, 0);
+
+  // one member at a time is copied here for output
+  auto d  = flecsi_get_handle(mesh, hydro,  density,   stored_real_t, dense, 0);
+  auto v  = flecsi_get_handle(mesh, hydro, velocity, stored_vector_t, dense, 0);
+  auto e  = flecsi_get_handle(mesh, hydro, internal_energy, stored_real_t, dense, 0);
+  auto p  = flecsi_get_handle(mesh, hydro,        pressure,   stored_real_t, dense, 0);
+  auto T  = flecsi_get_handle(mesh, hydro,     temperature, stored_real_t, dense, 0);
+  auto a  = flecsi_get_handle(mesh, hydro,     sound_speed, stored_real_t, dense, 0);
+
+  //===========================================================================
+  // Initial conditions
+  //===========================================================================
+
+  flecsi_execute_task( report_thread_bindings, apps::hydro, index, mesh );
+  flecsi_execute_task( first_touch_ensemble_fields, apps::hydro, index, mesh,
+    inputs_t::huge_pages, W, q, F );
+
+  auto filename_char = flecsi_sp::utils::to_char_array(input_file_name);
+  f = flecsi_execute_task( ensemble_initial_conditions, apps::hydro, index,
+    mesh, eos, num_members, real_t{0}, filename_char, W, q );
+
+  // every member starts at time zero
+  apps::common::ensemble_clock_t clock( num_members, inputs_t::final_time );
+  size_t time_cnt{0};
+
+  // each member writes under its own prefix
+  std::vector<std::string> prefixes;
+  for ( size_t m = 0; m < num_members; ++m )
+    prefixes.emplace_back(
+      apps::common::member_prefix( inputs_t::prefix, m, num_members ) );
+
+  // the diagnostics histories are only written by the first rank
+  std::vector< std::unique_ptr<apps::common::diagnostics_writer_t> >
+    diagnostics_files( num_members );
+  auto has_diagnostics = (inputs_t::diagnostics.frequency > 0);
+  if ( has_diagnostics && rank == 0 ) {
+    auto ext = inputs_t::diagnostics.binary ? ".bin" : ".csv";
+    for ( size_t m = 0; m < num_members; ++m )
+      diagnostics_files[m] =
+        std::make_unique<apps::common::diagnostics_writer_t>(
+          prefixes[m] + "-diagnostics" + ext,
+          apps::common::diagnostics_columns( 
+            mesh_t::num_dimensions, inputs_t::diagnostics.probes.size() ),
+          inputs_t::diagnostics.binary
+        );
+  }
+
+  // the compressed and vtu fields do not go through exodus
+  const auto & field_format = inputs_t::field_output.format;
+  auto has_field_output =
+    (inputs_t::output_freq > 0 && field_format != output_format_t::exodus);
+
+  auto write_member = [&]( size_t m ) {
+    auto prefix_char = flecsi_sp::utils::to_char_array( prefixes[m] );
+#ifdef FLECSALE_ENABLE_VTK
+    if ( field_format == output_format_t::vtu ) {
+      flecsi_execute_task( write_vtu, apps::hydro, index, mesh, prefix_char,
+        time_cnt, clock.time(m), d, v, e, p, T, a );
+      return;
+    }
+#endif
+    // the last aggregated output has to land before the next one
+    if ( inputs_t::field_output.aggregation.enabled() )
+      flecsi_execute_task( wait_fields, apps::hydro, index, mesh );
+    flecsi_execute_task( write_fields, apps::hydro, index, mesh, prefix_char,
+      time_cnt, clock.time(m), d, v, e, p, T, a );
+  };
+
+  // copy out each member in turn for the output and diagnostics
+  auto process_members = [&]( bool write, bool diagnose ) {
+    for ( size_t m = 0; m < num_members; ++m ) {
+      flecsi_execute_task( extract_member, apps::hydro, index, mesh,
+        eos[m], m, W, d, v, e, p, T, a );
+      if ( diagnose )
+        evaluate_diagnostics( mesh, diagnostics_files[m].get(), time_cnt,
+          clock.time(m), d, v, e, p );
+      if ( write ) write_member( m );
+    }
+  };
+
+  if ( has_field_output || has_diagnostics )
+    process_members( has_field_output, has_diagnostics );
+
+  f.wait();
+  // start a clock
+  auto tstart = ristra::utils::get_wall_time();
+
+  //===========================================================================
+  // Residual Evaluation
+  //===========================================================================
+
+  // with a shared time step one reduction covers every member, otherwise
+  // each member that is not finished gets its own
+  auto launch_time_step = [&]( size_t first, size_t last, real_t max_dt ) {
+    return flecsi_execute_reduction_task( evaluate_ensemble_time_step,
+      apps::hydro, index, min, double, mesh, first, last, W, inputs_t::CFL,
+      max_dt );
+  };
+  using time_step_future_t = decltype( launch_time_step( 0, 0, 0 ) );
+
+  for ( 
+    size_t num_steps = 0;
+    (num_steps < inputs_t::max_steps && !clock.is_finished()); 
+    ++num_steps 
+  ) {   
+
+    std::vector<time_step_future_t> time_steps;
+    if ( is_shared )
+      time_steps.emplace_back(
+        launch_time_step( 0, num_members, clock.remaining(0) ) );
+    else
+      for ( size_t m = 0; m < num_members; ++m )
+        if ( !clock.is_finished(m) )
+          time_steps.emplace_back(
+            launch_time_step( m, m+1, clock.remaining(m) ) );
+
+    // the fluxes do not need the time steps, so they are launched before
+    // waiting on them
+    flecsi_execute_task( evaluate_ensemble_fluxes, apps::hydro, index, mesh,
+      num_members, W, F );
+
+    // a finished member takes a zero step
+    member_array_t<real_t> delta_t;
+    delta_t.fill( 0 );
+    if ( is_shared )
+      delta_t.fill( time_steps.front().get() );
+    else
+      for ( size_t m = 0, i = 0; m < num_members; ++m )
+        if ( !clock.is_finished(m) ) delta_t[m] = time_steps[i++].get();
+
+    f = flecsi_execute_task( apply_ensemble_update, apps::hydro, index, mesh,
+      eos, num_members, delta_t, F, W, q );
+
+    //-------------------------------------------------------------------------
+    // Post-process
+
+    clock.advance( delta_t );
+    time_cnt++;
+
+    auto is_output = has_field_output && 
+      (time_cnt % inputs_t::output_freq == 0 || 
+       num_steps==inputs_t::max_steps-1 ||
+       clock.is_finished());
+    auto is_diagnosed = inputs_t::diagnostics.is_due( time_cnt );
+    if ( is_output || is_diagnosed )
+      process_members( is_output, is_diagnosed );
+
+  }
+
+  //===========================================================================
+  // Post-process
+  //===========================================================================
+
+  // complete the last output, and free the communicators of the writer
+  // groups before MPI shuts down
+  if ( field_format == output_format_t::compressed && has_field_output &&
+       inputs_t::field_output.aggregation.enabled() )
+    flecsi_execute_task( finish_fields, apps::hydro, index, mesh );
+
+  f.wait();    
+  auto tdelta = ristra::utils::get_wall_time() - tstart;
+
+  if ( rank == 0 ) {
+
+    cout << "Advanced " << num_members << " ensemble members with "
+         << ( is_shared ? "a shared" : "independent" ) << " time step"
+         << ( is_shared ? "" : "s" ) << " for " << time_cnt << " steps."
+         << std::endl;
+
+    for ( size_t m = 0; m < num_members; ++m )
+      cout << "Final solution time of member " << m+1 << " is " 
+           << std::scientific << std::setprecision(2) << clock.time(m)
+           << "." << std::endl;
+
+    std::cout << "Elapsed wall time is " << std::setprecision(4) << std::fixed 
+              << tdelta << "s." << std::endl;
+
+  }
+
+  // success if you reached here
+  return 0;
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief A sample test of the hydro solver
+///////////////////////////////////////////////////////////////////////////////
+int driver(int argc, char** argv) 
+{
+
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  //===========================================================================
+  // Mesh Setup
+  //===========================================================================
+
+  // get the client handle
+  auto mesh = flecsi_get_client_handle(mesh_t, meshes, mesh0);
+
+  // make sure geometry is up to date
+  auto f = flecsi_execute_task(
+	  update_geometry,
+	  apps::hydro,
+	  index,
+	  mesh
+	  );
+  f.wait(); // DONT GO FORWARD UNTIL DONE!
+
+  // get the input file
+  auto args = apps::common::process_arguments( argc, argv );
+  auto input_file_name =
+    args.count("f") ? args.at("f") : std::string();
+
+  // override any inputs if need be
+  if ( !input_file_name.empty() ) {
+    std::cout << "Using input file \"" << input_file_name << "\"."
+              << std::endl;
+    inputs_t::load( input_file_name );
+  }
+
+  // cout << mesh;
+
+  //===========================================================================
+  // Solve
+  //===========================================================================
+
+  // the members of an ensemble all share the mesh set up above
+  if ( inputs_t::ensemble.is_enabled() )
+    return solve_ensemble( mesh, f, rank, input_file_name );
+
+  return solve( mesh, f, rank, input_file_name );
+
+}
+
 } // namespace
 } // namespace
@@ -12,10 +12,13 @@
 #include <ristra/utils/string_utils.h>
 #include <ristra/embedded/embed_lua.h>
 #include "types.h"
+#include "../common/lua_pool.h"
 
 // system includes
+#include <algorithm>
 #include <iomanip>
 #include <string>
+#include <vector>
 
 namespace apps {
 namespace hydro {
@@ -69,6 +72,44 @@ public:
   //! \brief the equation of state
   static eos_t eos;
 
+  //! \brief the diagnostics and probes
+  static diagnostics_inputs_t diagnostics;
+
+  //! \brief the field output format and compression
+  static field_output_inputs_t field_output;
+
+  //! \brief the in situ python analysis
+  static analysis_inputs_t analysis;
+
+  //! \brief the reconstruction of the face states
+  static reconstruction_inputs_t reconstruction;
+
+  //! \brief the time integrator
+  static time_integrator_t time_integrator;
+
+  //! \brief the local time stepping
+  static local_time_stepping_inputs_t local_time_stepping;
+
+  //! \brief the steady state mode
+  static steady_state_inputs_t steady_state;
+
+  //! \brief if true, the first order fluxes of the interior faces are
+  //!        evaluated during the ghost exchange
+  static bool overlap_halo_exchange;
+
+  //! \brief if true, the state the fluxes read is exchanged as one field
+  static bool aggregate_halo_exchange;
+
+  //! \brief how the face fluxes are summed into the cells
+  static flux_accumulation_t flux_accumulation;
+
+  //! \brief if true, the fields are backed by huge pages where possible
+  static bool huge_pages;
+
+  //! \brief the ensemble members advanced together on the same mesh, and
+  //!        how they pick their time steps, empty for one run
+  static ensemble_inputs_t ensemble;
+
   //! \brief this is a lambda function to set the initial conditions
   //! the ics function type
   //! \{
@@ -128,6 +169,68 @@ public:
       THROW_IMPLEMENTED_ERROR("Unknown eos type \""<<eos_type<<"\"");
     }
 
+    // the diagnostics are optional
+    auto diag_input = hydro_input["diagnostics"];
+    if ( !diag_input.empty() )
+      apps::common::load_diagnostics( diag_input, diagnostics );
+
+    // the field output settings are optional
+    auto output_input = hydro_input["field_output"];
+    if ( !output_input.empty() )
+      apps::common::load_field_output( output_input, field_output );
+
+    // the python analysis is optional
+    auto analysis_input = hydro_input["analysis"];
+    if ( !analysis_input.empty() )
+      apps::common::load_analysis( analysis_input, analysis );
+
+    // the time integrator is optional, and forward euler by default
+    auto integrator_input = hydro_input["time_integrator"];
+    if ( !integrator_input.empty() )
+      time_integrator = apps::common::time_integrator(
+        integrator_input.as<std::string>() );
+
+    // local time stepping is optional, and off by default
+    auto lts_input = hydro_input["local_time_stepping"];
+    if ( !lts_input.empty() )
+      apps::common::load_local_time_stepping( lts_input, local_time_stepping );
+
+    // the steady state mode is optional, and off by default
+    auto steady_input = hydro_input["steady_state"];
+    if ( !steady_input.empty() )
+      apps::common::load_steady_state( steady_input, steady_state );
+
+    // overlapping the ghost exchange is optional, and off by default
+    auto overlap_input = hydro_input["overlap_halo_exchange"];
+    if ( !overlap_input.empty() )
+      overlap_halo_exchange = overlap_input.as<bool>();
+
+    // aggregating the ghost exchange is optional, and off by default
+    auto aggregate_input = hydro_input["aggregate_halo_exchange"];
+    if ( !aggregate_input.empty() )
+      aggregate_halo_exchange = aggregate_input.as<bool>();
+
+    // the flux accumulation is optional, and a gather by default
+    auto accumulation_input = hydro_input["flux_accumulation"];
+    if ( !accumulation_input.empty() )
+      flux_accumulation = apps::common::flux_accumulation(
+        accumulation_input.as<std::string>() );
+
+    // huge pages are optional, and off by default
+    auto huge_pages_input = hydro_input["huge_pages"];
+    if ( !huge_pages_input.empty() )
+      huge_pages = huge_pages_input.as<bool>();
+
+    // the ensemble is optional, and there is a single run by default
+    auto ensemble_input = hydro_input["ensemble"];
+    if ( !ensemble_input.empty() )
+      apps::common::load_ensemble( ensemble_input, ensemble );
+
+    // the reconstruction is optional, and first order by default
+    auto recon_input = hydro_input["reconstruction"];
+    if ( !recon_input.empty() )
+      apps::common::load_reconstruction( recon_input, reconstruction );
+
 #else
 
     THROW_IMPLEMENTED_ERROR(
@@ -138,28 +241,85 @@ public:
   }
 
   //===========================================================================
-  //! \brief Get an iniail conditions function from file
+  //! \brief Load an initial conditions file into one lua state per thread.
+  //!
+  //! This must be called outside of a parallel region, before the
+  //! functions below.
   //! \param [in] file  The name of the lua file to load.
   //===========================================================================
-  static auto get_initial_conditions( const std::string & file ) {
+  static void load_initial_conditions( const std::string & file ) {
 
 #ifdef FLECSALE_ENABLE_LUA
-    // setup the python interpreter
-    auto lua_state = ristra::embedded::lua_t();
-    // load the test file
-    lua_state.loadfile( file );
+    apps::common::lua_pool().load( file );
+#else
+    THROW_IMPLEMENTED_ERROR(
+      "You need to link with lua in order to use lua functionality."
+    );
+#endif // HAVE_LUA
+
+  }
+
+  //===========================================================================
+  //! \brief The number of cells per call of the batched initial conditions.
+  //!
+  //! The batched function is used if the hydro table has one, for example
+  //! \code
+  //!   ics_batch_size = 4096,  -- optional, the cells per call
+  //!   ics_batch = function (xs, t)
+  //!     local d, v, p = {}, {}, {}
+  //!     for i = 1, #xs/2 do
+  //!       local x, y = xs[2*i-1], xs[2*i]
+  //!       d[i], p[i] = 1.0, 1.0
+  //!       v[2*i-1], v[2*i] = 0, 0
+  //!     end
+  //!     return d, v, p
+  //!   end
+  //! \endcode
+  //! The coordinates and velocities are flat lists of all components.
+  //!
+  //! \return the batch size, or zero to call "ics" for every cell
+  //===========================================================================
+  static size_t initial_conditions_batch_size() {
+
+#ifdef FLECSALE_ENABLE_LUA
+    auto & lua_state = apps::common::lua_pool().state();
+    auto hydro_input = lua_try_access( lua_state, "hydro" );
+    if ( hydro_input["ics_batch"].empty() ) return 0;
+    auto size_input = hydro_input["ics_batch_size"];
+    size_t batch_size =
+      size_input.empty() ? 1024 : size_input.as<size_t>();
+    return std::max<size_t>( batch_size, 1 );
+#else
+    return 0;
+#endif // HAVE_LUA
+
+  }
+
+  //===========================================================================
+  //! \brief Get the initial conditions function of the calling thread.
+  //!
+  //! See load_initial_conditions.  The lua function gets the ensemble
+  //! member, counted from one, after the time.
+  //!
+  //! \param [in] member  The ensemble member, counted from zero.
+  //===========================================================================
+  static auto get_initial_conditions( size_t member = 0 ) {
+
+#ifdef FLECSALE_ENABLE_LUA
+    // the state of this thread already has the file loaded
+    auto & lua_state = apps::common::lua_pool().state();
 
     // get the hydro table
     auto hydro_input = lua_try_access( lua_state, "hydro" );
 
     // set the ics function
     auto ics_func = lua_try_access( hydro_input, "ics" );
-    auto ics = [ics_func]( const vector_t & x, const real_t & t )
+    auto ics = [ics_func, member]( const vector_t & x, const real_t & t )
       {
         real_t d, p;
         vector_t v(0);
         std::tie(d, v, p) =
-          ics_func(x, t).as<real_t, vector_t, real_t>();
+          ics_func(x, t, member+1).as<real_t, vector_t, real_t>();
         return std::make_tuple( d, std::move(v), p );
       };
 
@@ -181,6 +341,54 @@ public:
 
     return ics;
 
+#endif // HAVE_LUA
+
+  }
+
+  //===========================================================================
+  //! \brief Get the batched initial conditions function of the calling
+  //!        thread.
+  //!
+  //! See initial_conditions_batch_size.  The lua function gets the
+  //! ensemble member, counted from one, after the time.  It is called
+  //! inside a parallel region, so the caller checks the number of values
+  //! it returns instead of it throwing.
+  //!
+  //! \param [in] member  The ensemble member, counted from zero.
+  //===========================================================================
+  static auto get_batch_initial_conditions( size_t member = 0 ) {
+
+    using reals_t = std::vector<real_t>;
+
+#ifdef FLECSALE_ENABLE_LUA
+    auto & lua_state = apps::common::lua_pool().state();
+    auto hydro_input = lua_try_access( lua_state, "hydro" );
+
+    // one call crosses into lua for the whole batch
+    auto ics_func = lua_try_access( hydro_input, "ics_batch" );
+    auto ics = [ics_func, member]( const reals_t & xs, const real_t & t )
+      {
+        reals_t d, v, p;
+        std::tie(d, v, p) =
+          ics_func(xs, t, member+1).as<reals_t, reals_t, reals_t>();
+        return std::make_tuple( std::move(d), std::move(v), std::move(p) );
+      };
+
+    return ics;
+#else
+
+    THROW_IMPLEMENTED_ERROR(
+      "You need to link with lua in order to use lua functionality."
+    );
+
+    // empty function to appease compilers
+    auto ics = []( const reals_t & xs, const real_t & t )
+    {
+        return std::make_tuple( reals_t(), reals_t(), reals_t() );
+    };
+
+    return ics;
+
 #endif // HAVE_LUA
 
   }
@@ -11,15 +11,26 @@
 
 // hydro includes
 #include "types.h"
+#include "../common/numa.h"
+#include "../common/python_hook.h"
+#include "../common/vtk_adaptor.h"
 
 // flecsi includes
+#include <flecsale/io/field_file.h>
 #include <flecsi-sp/io/io_exodus.h>
 #include <flecsi/execution/context.h>
 #include <flecsi/execution/execution.h>
 #include <ristra/utils/string_utils.h>
+#include <ristra/utils/time_utils.h>
 
 // system includes
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 namespace apps {
 namespace hydro {
@@ -36,9 +47,78 @@ void update_geometry(
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Report where the threads of this rank run.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void report_thread_bindings( client_handle_r<mesh_t> mesh )
+{
+  auto & context = flecsi::execution::context_t::instance();
+  apps::common::print_thread_bindings( std::cout, context.color(),
+    apps::common::thread_bindings() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Touch every field in parallel before it is first written.
+//!
+//! The initial conditions already write the state in parallel, but not the
+//! other fields, and a batched lua call writes a batch from one thread.
+//! Touching every field beforehand, with the loops of the solver tasks,
+//! places the pages on the sockets of the threads that update them.  This
+//! only holds for the loops with the same static schedule; a dynamic or
+//! work stealing loop moves entities between threads, and those threads
+//! read some of their pages from another socket.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] huge_pages  if true, ask for huge pages first
+////////////////////////////////////////////////////////////////////////////////
+void first_touch_fields(
+  client_handle_r<mesh_t>  mesh,
+  bool huge_pages,
+  dense_handle_w<stored_real_t> d,
+  dense_handle_w<stored_vector_t> v,
+  dense_handle_w<stored_real_t> e,
+  dense_handle_w<stored_real_t> p,
+  dense_handle_w<stored_real_t> T,
+  dense_handle_w<stored_real_t> a,
+  dense_handle_w<flux_data_t> q,
+  dense_handle_w<flux_data_t> q0,
+  dense_handle_w<time_class_t> K,
+  dense_handle_w<flux_data_t> Q,
+  dense_handle_w<real_t> R,
+  dense_handle_w<halo_state_t> H,
+  dense_handle_w<stored_gradient_data_t> G,
+  dense_handle_w<stored_flux_data_t> F
+) {
+
+  using apps::common::first_touch;
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  first_touch( cell_list, d, huge_pages );
+  first_touch( cell_list, v, huge_pages );
+  first_touch( cell_list, e, huge_pages );
+  first_touch( cell_list, p, huge_pages );
+  first_touch( cell_list, T, huge_pages );
+  first_touch( cell_list, a, huge_pages );
+  first_touch( cell_list, q, huge_pages );
+  first_touch( cell_list, q0, huge_pages );
+  first_touch( cell_list, K, huge_pages );
+  first_touch( cell_list, Q, huge_pages );
+  first_touch( cell_list, R, huge_pages );
+  first_touch( cell_list, H, huge_pages );
+  first_touch( cell_list, G, huge_pages );
+
+  first_touch( mesh.faces( flecsi::owned ), F, huge_pages );
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task for setting initial conditions
 //!
+//! The cells are set in parallel, so inputs_t::initial_conditions has to be
+//! thread safe.
+//!
 //! \param [in,out] mesh the mesh object
 //! \param [in]     ics  the initial conditions to set
 //! \return 0 for success
@@ -47,31 +127,123 @@ void initial_conditions(
   client_handle_r<mesh_t>  mesh,
   eos_t eos,
   real_t soln_time,
-  dense_handle_w<real_t> d,
-  dense_handle_w<vector_t> v,
-  dense_handle_w<real_t> e,
-  dense_handle_w<real_t> p,
-  dense_handle_w<real_t> T,
-  dense_handle_w<real_t> a
+  dense_handle_w<stored_real_t> d,
+  dense_handle_w<stored_vector_t> v,
+  dense_handle_w<stored_real_t> e,
+  dense_handle_w<stored_real_t> p,
+  dense_handle_w<stored_real_t> T,
+  dense_handle_w<stored_real_t> a,
+  dense_handle_w<flux_data_t> q
 ) {
 
-  for ( auto c : mesh.cells( flecsi::owned ) ) {
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit ) {
+    const auto & c = cell_list[cit];
     auto lid = c.id();
-    std::tie( d(c), v(c), p(c) ) = inputs_t::initial_conditions(
-      mesh, lid, soln_time );
-    eqns_t::update_state_from_pressure(
-      pack( c, d, v, p, e, T, a ),
-      eos
-    );
+    auto packed = pack( c, d, v, p, e, T, a );
+    auto u = apps::common::compute_state<real_t>( packed );
+    std::tie( eqns_t::density(u), eqns_t::velocity(u), eqns_t::pressure(u) ) =
+      inputs_t::initial_conditions( mesh, lid, soln_time );
+    eqns_t::update_state_from_pressure( u, eos );
+    q(c) = eqns_t::conserved( u );
+    apps::common::commit_state( packed, u );
   }
 
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task for setting initial conditions
+//! \brief Evaluate the lua initial conditions of one member in every cell.
+//!
+//! The cells are set in parallel, each thread calling the lua function
+//! through its own interpreter, which has to be loaded already, see
+//! inputs_t::load_initial_conditions.  If the file defines a batched
+//! function, it is called once per batch of cells, see
+//! inputs_t::initial_conditions_batch_size.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] soln_time  the solution time
+//! \param [in] member  the ensemble member, passed on to lua
+//! \param [in] set_state  called with each cell and its density, velocity
+//!                        and pressure
+////////////////////////////////////////////////////////////////////////////////
+template< typename M, typename S >
+void evaluate_initial_conditions(
+  const M & mesh, real_t soln_time, size_t member, S && set_state
+) {
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+  auto batch_size = inputs_t::initial_conditions_batch_size();
+
+  // one call per cell
+  if ( batch_size == 0 ) {
+    #pragma omp parallel
+    {
+      auto ics = inputs_t::get_initial_conditions( member );
+      #pragma omp for
+      for ( counter_t cit = 0; cit < num_cells; ++cit ) {
+        const auto & c = cell_list[cit];
+        set_state( c, ics( c->centroid(), soln_time ) );
+      }
+    }
+  }
+
+  // one call per batch of cells
+  else {
+    counter_t batch = batch_size;
+    counter_t num_batches = ( num_cells + batch - 1 ) / batch;
+    // nothing may throw out of the parallel region, so a bad batch is only
+    // flagged there and reported after it
+    bool bad_batch = false;
+    #pragma omp parallel
+    {
+      constexpr auto num_dims = mesh_t::num_dimensions;
+      auto ics = inputs_t::get_batch_initial_conditions( member );
+      std::vector<real_t> xs;
+      #pragma omp for
+      for ( counter_t b = 0; b < num_batches; ++b ) {
+        auto begin = b * batch;
+        auto end = std::min<counter_t>( begin + batch, num_cells );
+        xs.clear();
+        for ( auto cit = begin; cit < end; ++cit ) {
+          const auto & x = cell_list[cit]->centroid();
+          for ( int dim = 0; dim < num_dims; ++dim ) xs.emplace_back( x[dim] );
+        }
+        auto states = ics( xs, soln_time );
+        const auto & vs = std::get<1>(states);
+        if ( std::get<0>(states).size() != end - begin ||
+             vs.size() != xs.size() ||
+             std::get<2>(states).size() != end - begin ) {
+          #pragma omp atomic write
+          bad_batch = true;
+          continue;
+        }
+        for ( auto cit = begin; cit < end; ++cit ) {
+          auto i = cit - begin;
+          vector_t vel(0);
+          for ( int dim = 0; dim < num_dims; ++dim )
+            vel[dim] = vs[ i*num_dims + dim ];
+          set_state( cell_list[cit], std::forward_as_tuple(
+            std::get<0>(states)[i], vel, std::get<2>(states)[i] ) );
+        }
+      }
+    }
+    if ( bad_batch )
+      THROW_RUNTIME_ERROR( "The batched initial conditions must return one "
+        "density, " << mesh_t::num_dimensions << " velocity components and "
+        "one pressure per cell" );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task for setting initial conditions from a lua file
+//!
+//! See evaluate_initial_conditions.
 //!
 //! \param [in,out] mesh the mesh object
-//! \param [in]     ics  the initial conditions to set
+//! \param [in]     filename  the lua file with the initial conditions
 //! \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
 void initial_conditions_from_file(
@@ -79,27 +251,56 @@ void initial_conditions_from_file(
   eos_t eos,
   real_t soln_time,
   char_array_t filename,
-  dense_handle_w<real_t> d,
-  dense_handle_w<vector_t> v,
-  dense_handle_w<real_t> e,
-  dense_handle_w<real_t> p,
-  dense_handle_w<real_t> T,
-  dense_handle_w<real_t> a
-) {
-	auto ics = inputs_t::get_initial_conditions(filename.str());
-
-	// This doesn't work with lua input
-	//#pragma omp parallel for
-	for ( auto c : mesh.cells( flecsi::owned ) ) {
-		std::tie( d(c), v(c), p(c) ) = ics( c->centroid(), soln_time );
-		eqns_t::update_state_from_pressure(
-			pack( c, d, v, p, e, T, a ),
-			eos
-			);
-	}
+  dense_handle_w<stored_real_t> d,
+  dense_handle_w<stored_vector_t> v,
+  dense_handle_w<stored_real_t> e,
+  dense_handle_w<stored_real_t> p,
+  dense_handle_w<stored_real_t> T,
+  dense_handle_w<stored_real_t> a,
+  dense_handle_w<flux_data_t> q
+) {
+  // every thread gets its own lua state, lua is not thread safe
+  inputs_t::load_initial_conditions( filename.str() );
+
+  evaluate_initial_conditions( mesh, soln_time, 0,
+    [&]( const auto & c, const auto & state ) {
+      auto packed = pack( c, d, v, p, e, T, a );
+      auto u = apps::common::compute_state<real_t>( packed );
+      std::tie( eqns_t::density(u), eqns_t::velocity(u), 
+        eqns_t::pressure(u) ) = state;
+      eqns_t::update_state_from_pressure( u, eos );
+      q(c) = eqns_t::conserved( u );
+      apps::common::commit_state( packed, u );
+    } );
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the inverse of the stable time step of one cell.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] c  the cell
+//! \param [in] u  the cell state
+//! \return the largest wave speed over length scale, without the CFL
+////////////////////////////////////////////////////////////////////////////////
+template< typename M, typename C, typename U >
+real_t inverse_time_step( const M & mesh, const C & c, const U & u )
+{
+  real_t dt_inv(0);
+
+  // loop over each face
+  for ( auto f : mesh.faces(c) ) {
+    // estimate the length scale normal to the face
+    auto delta_x = c->volume() / f->area();
+    // compute the inverse of the time scale
+    auto dti = eqns_t::fastest_wavespeed( u, f->normal() ) / delta_x;
+    // check for the maximum value
+    dt_inv = std::max( dti, dt_inv );
+  } // edge
+
+  return dt_inv;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task to compute the time step size.
 //!
@@ -109,36 +310,27 @@ void initial_conditions_from_file(
 ////////////////////////////////////////////////////////////////////////////////
 real_t evaluate_time_step(
   client_handle_r<mesh_t> mesh,
-  dense_handle_r<real_t> d,
-  dense_handle_r<vector_t> v,
-  dense_handle_r<real_t> e,
-  dense_handle_r<real_t> p,
-  dense_handle_r<real_t> T,
-  dense_handle_r<real_t> a,
+  dense_handle_r_owned<stored_real_t> d,
+  dense_handle_r_owned<stored_vector_t> v,
+  dense_handle_r_owned<stored_real_t> e,
+  dense_handle_r_owned<stored_real_t> p,
+  dense_handle_r_owned<stored_real_t> T,
+  dense_handle_r_owned<stored_real_t> a,
   real_t CFL,
   real_t max_dt
 ) {
  
   // Loop over each cell, computing the minimum time step,
   // which is also the maximum 1/dt
-  real_t dt_inv(0);
-
-  for ( auto c : mesh.cells( flecsi::owned ) ) {
-
-    // get the solution state
-    auto u = pack( c, d, v, p, e, T, a );
-
-    // loop over each face
-    for ( auto f : mesh.faces(c) ) {
-      // estimate the length scale normal to the face
-      auto delta_x = c->volume() / f->area();
-      // compute the inverse of the time scale
-      auto dti = eqns_t::fastest_wavespeed( u, f->normal() ) / delta_x;
-      // check for the maximum value
-      dt_inv = std::max( dti, dt_inv );
-    } // edge
-
-  } // cell
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto dt_inv = flecsale::utils::reproducible_max<real_t>( cell_list.size(),
+    [&]( size_t i ) {
+      // get the solution state
+      const auto & c = cell_list[i];
+      auto packed = pack( c, d, v, p, e, T, a );
+      auto u = apps::common::compute_state<real_t>( packed );
+      return inverse_time_step( mesh, c, u );
+    } );
 
   if ( dt_inv <= 0 ) 
     THROW_RUNTIME_ERROR( "infinite delta t" );
@@ -152,6 +344,168 @@ real_t evaluate_time_step(
   return time_step;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the limited gradients of the reconstructed variables.
+//!
+//! The gradients are least-squares fits to the neighboring cell values.
+//! Each variable is then limited so that the values it reconstructs at the
+//! faces stay within the range of the neighbors.
+//!
+//! \param [in] mesh  the mesh object
+//! \param [in] recon  the reconstruction inputs
+//! \param [out] grad  the limited gradients
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_gradients( 
+  client_handle_r<mesh_t> mesh,
+  reconstruction_inputs_t recon,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_w<stored_gradient_data_t> grad
+) {
+
+  constexpr auto num_dims = mesh_t::num_dimensions;
+  constexpr auto num_vars = eqns_t::primitives::number();
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel
+  {
+
+    // the solver scratch space is reused by each thread
+    flecsale::eqns::least_squares_u<real_t, num_dims> ls;
+
+    #pragma omp for
+    for ( counter_t cit = 0; cit < num_cells; ++cit )
+    {
+
+      const auto & c = cell_list[cit];
+      const auto & xc = c->centroid();
+
+      auto packed = pack( c, d, v, p, e, T, a );
+      auto u = apps::common::compute_state<real_t>( packed );
+      auto w = eqns_t::primitive( u );
+
+      // fit the gradients to the neighbors, and track the range of values
+      ls.clear();
+      primitive_data_t dw_min( 0 ), dw_max( 0 );
+
+      for ( auto f : mesh.faces(c) ) {
+        auto cells = mesh.cells(f);
+        if ( cells.size() < 2 ) continue;
+        auto n = ( cells[0] == c ) ? cells[1] : cells[0];
+
+        auto packed_n = pack( n, d, v, p, e, T, a );
+        auto un = apps::common::compute_state<real_t>( packed_n );
+        primitive_data_t dw = eqns_t::primitive( un ) - w;
+
+        const auto & xn = n->centroid();
+        vector_t dx;
+        for ( int i=0; i<num_dims; ++i ) dx[i] = xn[i] - xc[i];
+
+        for ( int k=0; k<num_vars; ++k ) {
+          dw_min[k] = std::min( dw_min[k], dw[k] );
+          dw_max[k] = std::max( dw_max[k], dw[k] );
+        }
+        ls.add( dx, dw );
+      }
+
+      gradient_data_t gw;
+      ls.solve( gw );
+
+      // limit each variable using its worst face
+      if ( recon.limiter != reconstruction_inputs_t::limiter_t::none ) {
+
+        auto h = std::pow( c->volume(), static_cast<real_t>(1) / num_dims );
+        auto eps2 = std::pow( recon.venkatakrishnan_k * h, 3 );
+
+        primitive_data_t phi( 1 );
+        for ( auto f : mesh.faces(c) ) {
+          const auto & xf = f->centroid();
+          for ( int k=0; k<num_vars; ++k ) {
+            real_t delta( 0 );
+            for ( int i=0; i<num_dims; ++i ) delta += gw[k][i] * (xf[i] - xc[i]);
+            phi[k] = std::min( phi[k], flecsale::eqns::limit<real_t>(
+              recon.limiter, delta, dw_min[k], dw_max[k], eps2 ) );
+          }
+        }
+
+        for ( int k=0; k<num_vars; ++k )
+          for ( int i=0; i<num_dims; ++i ) gw[k][i] *= phi[k];
+
+      } // limiter
+
+      grad(c) = apps::common::precision_cast<stored_gradient_data_t>( gw );
+
+    } // for
+
+  } // parallel
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the flux through one face, scaled by its area.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] f  the face
+//! \param [in] state  returns the state of a cell in the compute precision
+//! \return the face flux, always in full precision
+////////////////////////////////////////////////////////////////////////////////
+template< typename M, typename F, typename S >
+flux_data_t evaluate_face_flux( const M & mesh, const F & f, S && state )
+{
+    
+  // get the cell neighbors
+  const auto & cells = mesh.cells(f);
+  auto num_cells = cells.size();
+
+  // get the left state
+  auto w_left = state( cells[0] );
+  
+  // compute the face flux
+  flux_data_t face_flux;
+  //
+  // interior cell
+  if ( num_cells == 2 ) {
+    auto w_right = state( cells[1] );
+    face_flux = flux_function<eqns_t>( w_left, w_right, f->normal() );
+  } 
+  // boundary cell
+  else {
+    face_flux = boundary_flux<eqns_t>( w_left, f->normal() );
+  }
+ 
+  // scale the flux by the face area
+  face_flux *= f->area();
+  return face_flux;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the flux through one face from the state fields.
+//!
+//! The stored conserved quantities save rebuilding them from the
+//! primitives.
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename M, typename F, typename D, typename V, typename E, typename P,
+  typename TT, typename A, typename Q
+>
+flux_data_t evaluate_face_flux( 
+  const M & mesh, const F & f, D & d, V & v, E & e, P & p, TT & T, A & a,
+  Q & q
+) {
+  // the computed state refers to the field storage, not to the packed tuple
+  return evaluate_face_flux( mesh, f, [&]( const auto & c ) {
+    auto packed = pack( c, d, v, p, e, T, a, q );
+    return apps::common::compute_state<real_t>( packed );
+  } );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task to evaluate fluxes at each face.
 //!
@@ -160,15 +514,208 @@ real_t evaluate_time_step(
 ////////////////////////////////////////////////////////////////////////////////
 void evaluate_fluxes( 
   client_handle_r<mesh_t> mesh,
-  dense_handle_r<real_t> d,
-  dense_handle_r<vector_t> v,
-  dense_handle_r<real_t> e,
-  dense_handle_r<real_t> p,
-  dense_handle_r<real_t> T,
-  dense_handle_r<real_t> a,
-  dense_handle_w<flux_data_t> flux
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_r<flux_data_t> q,
+  dense_handle_w<stored_flux_data_t> flux
+) {
+
+  const auto & face_list = mesh.faces( flecsi::owned );
+  auto num_faces = face_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  {
+    const auto & f = face_list[fit];
+    flux(f) = apps::common::precision_cast<stored_flux_data_t>(
+      evaluate_face_flux( mesh, f, d, v, e, p, T, a, q ) );
+  } // for
+  //----------------------------------------------------------------------------
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes of the faces that only touch owned cells.
+//!
+//! The state is accessed without its ghosts, so this runs while the ghost
+//! exchange is in flight.  See apps::common::halo_split_t.
+//!
+//! \param [in] mesh the mesh object
+//! \param [out] flux  the fluxes of the interior faces
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_interior_fluxes( 
+  client_handle_r<mesh_t> mesh,
+  dense_handle_r_owned<stored_real_t> d,
+  dense_handle_r_owned<stored_vector_t> v,
+  dense_handle_r_owned<stored_real_t> e,
+  dense_handle_r_owned<stored_real_t> p,
+  dense_handle_r_owned<stored_real_t> T,
+  dense_handle_r_owned<stored_real_t> a,
+  dense_handle_r_owned<flux_data_t> q,
+  dense_handle_w<stored_flux_data_t> flux
+) {
+
+  const auto & face_list = mesh.faces();
+  const auto & ids = apps::common::halo_split().faces( region_t::interior );
+  auto num_faces = ids.size();
+
+  #pragma omp parallel for
+  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  {
+    const auto & f = face_list[ ids[fit] ];
+    flux(f) = apps::common::precision_cast<stored_flux_data_t>(
+      evaluate_face_flux( mesh, f, d, v, e, p, T, a, q ) );
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes of the owned faces that touch a ghost cell.
+//!
+//! The fluxes are read-write, since a write-only access would discard the
+//! interior fluxes computed by evaluate_interior_fluxes.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in,out] flux  the fluxes, only the halo faces are written
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_halo_fluxes( 
+  client_handle_r<mesh_t> mesh,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_r<flux_data_t> q,
+  dense_handle_rw<stored_flux_data_t> flux
+) {
+
+  const auto & face_list = mesh.faces();
+  const auto & ids = apps::common::halo_split().faces( region_t::halo );
+  auto num_faces = ids.size();
+
+  #pragma omp parallel for
+  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  {
+    const auto & f = face_list[ ids[fit] ];
+    flux(f) = apps::common::precision_cast<stored_flux_data_t>(
+      evaluate_face_flux( mesh, f, d, v, e, p, T, a, q ) );
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Pack the state the fluxes read into the halo state field.
+//!
+//! Only the owned cells are written, the ghosts are filled in by a single
+//! exchange of the packed field before evaluate_packed_fluxes.
+//!
+//! \param [in] mesh the mesh object
+//! \param [out] halo  the packed state
+////////////////////////////////////////////////////////////////////////////////
+void pack_halo_state( 
+  client_handle_r<mesh_t> mesh,
+  dense_handle_r_owned<stored_real_t> d,
+  dense_handle_r_owned<stored_vector_t> v,
+  dense_handle_r_owned<stored_real_t> e,
+  dense_handle_r_owned<stored_real_t> p,
+  dense_handle_r_owned<stored_real_t> a,
+  dense_handle_w<halo_state_t> halo
+) {
+  for ( auto c : mesh.cells( flecsi::owned ) )
+    halo(c) = halo_state_t{ d(c), v(c), p(c), e(c), a(c) };
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes at each face from the packed halo state.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] halo  the packed state, including the ghosts
+//! \param [out] flux  the face fluxes
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_packed_fluxes( 
+  client_handle_r<mesh_t> mesh,
+  dense_handle_r<halo_state_t> halo,
+  dense_handle_w<stored_flux_data_t> flux
+) {
+
+  const auto & face_list = mesh.faces( flecsi::owned );
+  auto num_faces = face_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  {
+    const auto & f = face_list[fit];
+    flux(f) = apps::common::precision_cast<stored_flux_data_t>(
+      evaluate_face_flux( mesh, f, 
+        [&]( const auto & c ) { return unpack_halo_state( halo(c) ); } )
+    );
+  } // for
+
+}
+
+template<typename T>
+using handle_t =
+  flecsi::execution::flecsi_future<T, flecsi::execution::launch_type_t::single>;
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Reconstruct the state on both sides of each face, and evaluate
+//!        the face fluxes.
+//!
+//! The cell values are extrapolated to the face centroid with the limited
+//! gradients, and then advanced by half_dt with the predictor.  Faces where
+//! the reconstruction produces a negative density or pressure fall back to
+//! the cell values.
+//!
+//! \param [in] mesh  the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] half_dt  the predictor time step, zero to skip it
+//! \param [in] grad  the limited gradients
+//! \param [out] flux  the face fluxes
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename M, typename D, typename V, typename E, typename P, typename TT,
+  typename A, typename G, typename F
+>
+void reconstruct_face_fluxes( 
+  const M & mesh, const eos_t & eos, real_t half_dt,
+  D & d, V & v, E & e, P & p, TT & T, A & a, G & grad, F & flux
 ) {
 
+  constexpr auto num_dims = mesh_t::num_dimensions;
+  constexpr auto num_vars = eqns_t::primitives::number();
+  using index = eqns_t::primitives::index;
+
+  // reconstruct the state of a cell at a face
+  auto face_state = [&]( const auto & c, const auto & xf )
+  {
+    auto packed = pack( c, d, v, p, e, T, a );
+    auto u = apps::common::compute_state<real_t>( packed );
+    const auto & g = 
+      apps::common::precision_cast<gradient_data_t>( grad(c) );
+
+    auto w = eqns_t::primitive( u );
+    auto wf = w;
+    const auto & xc = c->centroid();
+    for ( int k=0; k<num_vars; ++k )
+      for ( int i=0; i<num_dims; ++i ) wf[k] += g[k][i] * (xf[i] - xc[i]);
+
+    if ( half_dt > 0 ) {
+      auto dwdt = eqns_t::primitive_rate( u, g );
+      for ( int k=0; k<num_vars; ++k ) wf[k] += half_dt * dwdt[k];
+    }
+
+    if ( wf[index::density] <= 0 || wf[index::pressure] <= 0 ) wf = w;
+
+    eqns_t::state_data_t uf;
+    eqns_t::update_state_from_primitive( uf, wf, eos );
+    return uf;
+  };
+
   const auto & face_list = mesh.faces( flecsi::owned );
   auto num_faces = face_list.size();
 
@@ -177,108 +724,1313 @@ void evaluate_fluxes(
   {
 
     const auto & f = face_list[fit];
+    const auto & xf = f->centroid();
     
     // get the cell neighbors
     const auto & cells = mesh.cells(f);
     auto num_cells = cells.size();
 
-    // get the left state
-    auto w_left = pack( cells[0], d, v, p, e, T, a );
+    auto w_left = face_state( cells[0], xf );
     
     // compute the face flux
+    flux_data_t face_flux;
     //
     // interior cell
     if ( num_cells == 2 ) {
-      auto w_right = pack( cells[1], d, v, p, e, T, a );
-      flux(f) = flux_function<eqns_t>( w_left, w_right, f->normal() );
+      auto w_right = face_state( cells[1], xf );
+      face_flux = flux_function<eqns_t>( w_left, w_right, f->normal() );
     } 
     // boundary cell
     else {
-      flux(f) = boundary_flux<eqns_t>( w_left, f->normal() );
+      face_flux = boundary_flux<eqns_t>( w_left, f->normal() );
     }
    
     // scale the flux by the face area
-    flux(f) *= f->area();
+    face_flux *= f->area();
+    flux(f) = apps::common::precision_cast<stored_flux_data_t>( face_flux );
 
   } // for
   //----------------------------------------------------------------------------
 
 }
 
-template<typename T>
-using handle_t =
-  flecsi::execution::flecsi_future<T, flecsi::execution::launch_type_t::single>;
-
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task to update the solution in each cell.
+//! \brief Evaluate the fluxes at each face from reconstructed states.
 //!
-//! \param [in,out] mesh the mesh object
-//! \return 0 for success
+//! With the predictor on, the face states are advanced by half a time step,
+//! which makes the forward Euler update second order in time
+//! (MUSCL-Hancock).
+//!
+//! \param [in] mesh  the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] recon  the reconstruction inputs
+//! \param [in] future_delta_t  the time step, only used by the predictor
+//! \param [in] grad  the limited gradients
+//! \param [out] flux  the face fluxes
 ////////////////////////////////////////////////////////////////////////////////
-void apply_update( 
+void evaluate_reconstructed_fluxes( 
   client_handle_r<mesh_t> mesh,
   eos_t eos,
+  reconstruction_inputs_t recon,
   handle_t<real_t> future_delta_t,
-  dense_handle_r<flux_data_t> flux,
-  dense_handle_rw<real_t> d,
-  dense_handle_rw<vector_t> v,
-  dense_handle_rw<real_t> e,
-  dense_handle_rw<real_t> p,
-  dense_handle_rw<real_t> T,
-  dense_handle_rw<real_t> a
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_r<stored_gradient_data_t> grad,
+  dense_handle_w<stored_flux_data_t> flux
 ) {
+  real_t half_dt = recon.predictor ? 0.5 * future_delta_t : 0;
+  reconstruct_face_fluxes( mesh, eos, half_dt, d, v, e, p, T, a, grad, flux );
+}
 
-  //----------------------------------------------------------------------------
-  // Loop over each cell, scattering the fluxes to the cell
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes at each face from reconstructed states, without
+//!        the predictor.
+//!
+//! The steady state mode takes a local pseudo time step in each cell, so
+//! there is no time step to advance the face states by.
+//!
+//! \param [in] mesh  the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] grad  the limited gradients
+//! \param [out] flux  the face fluxes
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_steady_reconstructed_fluxes( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_r<stored_gradient_data_t> grad,
+  dense_handle_w<stored_flux_data_t> flux
+) {
+  reconstruct_face_fluxes( mesh, eos, 0, d, v, e, p, T, a, grad, flux );
+}
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Sum the fluxes through the faces of a cell.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] c  the cell
+//! \param [in] flux  the face fluxes
+//! \return the net flux into the cell, always in full precision
+////////////////////////////////////////////////////////////////////////////////
+template< typename M, typename C, typename F >
+flux_data_t gather_fluxes( const M & mesh, const C & c, const F & flux )
+{
+  // initialize the update
+  flux_data_t delta_u( 0 );
+
+  // loop over each connected edge
+  for ( auto f : mesh.faces(c) ) {
+    
+    // get the cell neighbors
+    auto neigh = mesh.cells(f);
 
-  //auto delta_t = static_cast<real_t>( time_step );
-  real_t delta_t = future_delta_t;
-  const auto & cell_list = mesh.cells( flecsi::owned );
-  auto num_cells = cell_list.size();
+    // add the contribution to this cell only
+    const auto & face_flux = 
+      apps::common::precision_cast<flux_data_t>( flux(f) );
+    if ( neigh[0] == c )
+      delta_u -= face_flux;
+    else
+      delta_u += face_flux;
 
-  #pragma omp parallel for
-  for ( counter_t cit = 0; cit < num_cells; ++cit )
-  {
+  } // edge
 
-    const auto & c = cell_list[cit];
+  return delta_u;
+}
 
-    // initialize the update
-    flux_data_t delta_u( 0 );
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Return the net flux buffer of this rank.
+//!
+//! It is kept for the whole run, so the scattered update does not allocate
+//! every step.
+////////////////////////////////////////////////////////////////////////////////
+std::vector<flux_data_t> & net_flux_buffer()
+{
+  static std::vector<flux_data_t> buffer;
+  return buffer;
+}
 
-    // loop over each connected edge
-    for ( auto f : mesh.faces(c) ) {
-      
-      // get the cell neighbors
-      auto neigh = mesh.cells(f);
-      auto num_neigh = neigh.size();
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Add the fluxes through the faces to their cells.
+//!
+//! The colors are processed in turn, and the faces of one color in
+//! parallel, since they never share a cell.  See
+//! apps::common::face_coloring_t.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] flux  the face fluxes
+//! \param [out] net_flux  the net flux into each local cell, only the owned
+//!                         cells are complete
+////////////////////////////////////////////////////////////////////////////////
+template< typename M, typename F >
+void scatter_fluxes( 
+  const M & mesh, const F & flux, std::vector<flux_data_t> & net_flux
+) {
+  const auto & coloring = apps::common::face_coloring();
+  const auto & face_list = mesh.faces();
 
-      // add the contribution to this cell only
-      if ( neigh[0] == c )
-        delta_u -= flux(f);
-      else
-        delta_u += flux(f);
+  // the buffer only grows on the first call, and is zeroed in parallel
+  auto num_cells = mesh.cells().size();
+  net_flux.resize( num_cells );
+  #pragma omp parallel for
+  for ( counter_t i = 0; i < num_cells; ++i ) net_flux[i] = flux_data_t(0);
 
-    } // edge
+  for ( size_t color = 0; color < coloring.num_colors(); ++color ) {
 
-    // now compute the final update
-    delta_u *= delta_t/c->volume();
+    const auto & items = coloring.items( color );
+    auto num_faces = items.size();
 
-    // apply the update
-    auto u = pack(c, d, v, p, e, T, a);
-    eqns_t::update_state_from_flux( u, delta_u );
+    #pragma omp parallel for
+    for ( counter_t fit = 0; fit < num_faces; ++fit )
+    {
+      const auto & f = face_list[ coloring.face( items[fit] ) ];
+      auto neigh = mesh.cells(f);
+      // read the flux once for both cells
+      const auto & face_flux = 
+        apps::common::precision_cast<flux_data_t>( flux(f) );
+      net_flux[ neigh[0].id() ] -= face_flux;
+      if ( neigh.size() > 1 )
+        net_flux[ neigh[1].id() ] += face_flux;
+    } // for
+
+  } // color
+}
 
-    // update the rest of the quantities
-    eqns_t::update_state_from_energy( u, eos );
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution in one cell from its net flux.
+//!
+//! \param [in] eos  the equation of state
+//! \param [in] delta_t  the time step
+//! \param [in] c  the cell
+//! \param [in] delta_u  the net flux into the cell
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename C, typename D, typename V, typename E, typename P, typename TT,
+  typename A, typename Q
+>
+void apply_net_flux( 
+  const eos_t & eos, real_t delta_t, const C & c, flux_data_t delta_u,
+  D & d, V & v, E & e, P & p, TT & T, A & a, Q & q
+) {
+
+  // now compute the final update
+  delta_u *= delta_t/c->volume();
+
+  // apply the update, this accumulates into the conserved quantities and
+  // converts back to the primitives in one go
+  auto packed = pack(c, d, v, p, e, T, a, q);
+  auto u = apps::common::compute_state<real_t>( packed );
+  eqns_t::update_state_from_flux( u, delta_u );
+
+  // update the rest of the quantities, the temperature is only computed
+  // when it is consumed
+  eqns_t::update_flow_state_from_energy( u, eos );
+
+  // check the solution quantities
+  if ( eqns_t::internal_energy(u) < 0 || eqns_t::density(u) < 0 ) 
+    THROW_RUNTIME_ERROR( "Negative density or internal energy encountered!" );
+
+  apps::common::commit_state( packed, u );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution in one cell.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] delta_t  the time step
+//! \param [in] c  the cell
+//! \param [in] flux  the face fluxes
+////////////////////////////////////////////////////////////////////////////////
+template< 
+  typename M, typename C, typename F, typename D, typename V, typename E,
+  typename P, typename TT, typename A, typename Q
+>
+void update_cell( 
+  const M & mesh, const eos_t & eos, real_t delta_t, const C & c,
+  const F & flux, D & d, V & v, E & e, P & p, TT & T, A & a, Q & q
+) {
+  apply_net_flux( eos, delta_t, c, gather_fluxes( mesh, c, flux ),
+    d, v, e, p, T, a, q );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The main task to update the solution in each cell.
+//!
+//! Only the owned cells are updated, so the state is accessed without its
+//! ghosts.  The ghosts are only exchanged for the tasks that read them, which
+//! with the aggregated exchange is just the packed halo state.  The same goes
+//! for the other update tasks.
+//!
+//! \param [in,out] mesh the mesh object
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void apply_update( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  handle_t<real_t> future_delta_t,
+  dense_handle_r<stored_flux_data_t> flux,
+  dense_handle_rw_owned<stored_real_t> d,
+  dense_handle_rw_owned<stored_vector_t> v,
+  dense_handle_rw_owned<stored_real_t> e,
+  dense_handle_rw_owned<stored_real_t> p,
+  dense_handle_r_owned<stored_real_t> T,
+  dense_handle_rw_owned<stored_real_t> a,
+  dense_handle_rw_owned<flux_data_t> q
+) {
+
+  //----------------------------------------------------------------------------
+  // Loop over each cell, scattering the fluxes to the cell
+
+
+  //auto delta_t = static_cast<real_t>( time_step );
+  real_t delta_t = future_delta_t;
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  {
+    const auto & c = cell_list[cit];
+    update_cell( mesh, eos, delta_t, c, flux, d, v, e, p, T, a, q );
+  } // for
+  //----------------------------------------------------------------------------
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution in each cell, scattering the face fluxes.
+//!
+//! This is the same update as apply_update, but every face flux is read
+//! once.  The face coloring has to be built first, see build_face_coloring.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] future_delta_t  the time step
+////////////////////////////////////////////////////////////////////////////////
+void apply_scattered_update( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  handle_t<real_t> future_delta_t,
+  dense_handle_r<stored_flux_data_t> flux,
+  dense_handle_rw_owned<stored_real_t> d,
+  dense_handle_rw_owned<stored_vector_t> v,
+  dense_handle_rw_owned<stored_real_t> e,
+  dense_handle_rw_owned<stored_real_t> p,
+  dense_handle_r_owned<stored_real_t> T,
+  dense_handle_rw_owned<stored_real_t> a,
+  dense_handle_rw_owned<flux_data_t> q
+) {
+
+  real_t delta_t = future_delta_t;
+
+  auto & net_flux = net_flux_buffer();
+  scatter_fluxes( mesh, flux, net_flux );
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  {
+    const auto & c = cell_list[cit];
+    apply_net_flux( eos, delta_t, c, net_flux[c.id()], d, v, e, p, T, a, q );
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Color the faces around the owned cells.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void build_face_coloring( client_handle_r<mesh_t> mesh )
+{
+  apps::common::face_coloring().build( mesh, mesh.cells( flecsi::owned ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Time the summation of the face fluxes into the cells.
+//!
+//! Only the net fluxes are computed, the solution is left alone.  Use a
+//! max-reduction to get the time of the slowest rank.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] method  either a gather or a scatter
+//! \param [in] repeats  the number of times the sum is repeated
+//! \param [in] flux  the face fluxes
+//! \return the wall time in seconds
+////////////////////////////////////////////////////////////////////////////////
+real_t time_flux_accumulation( 
+  client_handle_r<mesh_t> mesh,
+  flux_accumulation_t method,
+  size_t repeats,
+  dense_handle_r<stored_flux_data_t> flux
+) {
+
+  auto & net_flux = net_flux_buffer();
+  net_flux.resize( mesh.cells().size() );
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  auto tstart = ristra::utils::get_wall_time();
+
+  for ( size_t i = 0; i < repeats; ++i ) {
+    if ( method == flux_accumulation_t::scatter ) {
+      scatter_fluxes( mesh, flux, net_flux );
+    }
+    else {
+      #pragma omp parallel for
+      for ( counter_t cit = 0; cit < num_cells; ++cit )
+      {
+        const auto & c = cell_list[cit];
+        net_flux[c.id()] = gather_fluxes( mesh, c, flux );
+      } // for
+    }
+  }
+
+  return ristra::utils::get_wall_time() - tstart;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Split the owned faces into their interior and halo parts.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void build_halo_split( client_handle_r<mesh_t> mesh )
+{
+  apps::common::halo_split().build( 
+    mesh, mesh.cells( flecsi::owned ), mesh.faces( flecsi::owned ) );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Save the conserved state at the start of a multi-stage step.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] q  the conserved quantities
+//! \param [out] q0  the saved conserved quantities
+////////////////////////////////////////////////////////////////////////////////
+void save_state( 
+  client_handle_r<mesh_t> mesh,
+  dense_handle_r_owned<flux_data_t> q,
+  dense_handle_w<flux_data_t> q0
+) {
+  for ( auto c : mesh.cells( flecsi::owned ) ) q0(c) = q(c);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution with one of the later stages of an SSP
+//!        Runge-Kutta scheme.
+//!
+//! The new state is \f$ a u^n + (1-a) ( u + \Delta t L(u) ) \f$, where u is
+//! the current stage and \f$ u^n \f$ the saved state.  The first stage is
+//! a plain apply_update.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] future_delta_t  the time step
+//! \param [in] old_weight  the weight a of the saved state
+//! \param [in] q0  the conserved quantities at the start of the step
+////////////////////////////////////////////////////////////////////////////////
+void apply_stage_update( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  handle_t<real_t> future_delta_t,
+  real_t old_weight,
+  dense_handle_r<stored_flux_data_t> flux,
+  dense_handle_rw_owned<stored_real_t> d,
+  dense_handle_rw_owned<stored_vector_t> v,
+  dense_handle_rw_owned<stored_real_t> e,
+  dense_handle_rw_owned<stored_real_t> p,
+  dense_handle_r_owned<stored_real_t> T,
+  dense_handle_rw_owned<stored_real_t> a,
+  dense_handle_rw_owned<flux_data_t> q,
+  dense_handle_r_owned<flux_data_t> q0
+) {
+
+  real_t delta_t = future_delta_t;
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  {
+
+    const auto & c = cell_list[cit];
+
+    // the forward euler part of the update
+    auto delta_u = gather_fluxes( mesh, c, flux );
+    delta_u *= (1 - old_weight) * delta_t / c->volume();
+
+    // and the pull back towards the saved state
+    flux_data_t delta_q = q0(c) - q(c);
+    delta_q *= old_weight;
+    delta_u += delta_q;
+
+    // apply the update, the same way apply_update does
+    auto packed = pack(c, d, v, p, e, T, a, q);
+    auto u = apps::common::compute_state<real_t>( packed );
+    eqns_t::update_state_from_flux( u, delta_u );
+    eqns_t::update_flow_state_from_energy( u, eos );
 
     // check the solution quantities
     if ( eqns_t::internal_energy(u) < 0 || eqns_t::density(u) < 0 ) 
       THROW_RUNTIME_ERROR( "Negative density or internal energy encountered!" );
 
+    apps::common::commit_state( packed, u );
+
   } // for
-  //----------------------------------------------------------------------------
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Bin the cells into local time stepping classes.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] future_dt_min  the smallest stable time step of all cells
+//! \param [in] levels  the coarsest class allowed
+//! \param [in] CFL  the CFL number
+//! \param [out] klass  the time class of each cell
+////////////////////////////////////////////////////////////////////////////////
+void classify_cells( 
+  client_handle_r<mesh_t> mesh,
+  handle_t<real_t> future_dt_min,
+  size_t levels,
+  real_t CFL,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_w<time_class_t> klass
+) {
+
+  real_t dt_min = future_dt_min;
+
+  for ( auto c : mesh.cells( flecsi::owned ) ) {
+    auto packed = pack( c, d, v, p, e, T, a );
+    auto u = apps::common::compute_state<real_t>( packed );
+    auto dt = CFL / inverse_time_step( mesh, c, u );
+    klass(c) = apps::common::time_class( dt, dt_min, levels );
+  }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the base time step of a local time stepping step.
+//!
+//! Each cell of class k must be stable with 2^k times the base step.  The
+//! classes may be a few steps old, so this is checked for every cell.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] klass  the time class of each cell
+//! \param [in] CFL  the CFL number
+//! \param [in] max_dt  the largest base step allowed
+//! \return the base time step
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_base_time_step(
+  client_handle_r<mesh_t> mesh,
+  dense_handle_r<time_class_t> klass,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  real_t CFL,
+  real_t max_dt
+) {
+
+  // the largest inverse of the base step
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto dt_inv = flecsale::utils::reproducible_max<real_t>( cell_list.size(),
+    [&]( size_t i ) {
+      const auto & c = cell_list[i];
+      auto packed = pack( c, d, v, p, e, T, a );
+      auto u = apps::common::compute_state<real_t>( packed );
+      auto ticks = apps::common::class_ticks( klass(c) );
+      return ticks * inverse_time_step( mesh, c, u );
+    } );
+
+  if ( dt_inv <= 0 ) 
+    THROW_RUNTIME_ERROR( "infinite delta t" );
+
+  return std::min( CFL / dt_inv, max_dt );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes of the faces that start a step at this tick.
+//!
+//! A face steps with the finer class of its two cells.  The stored flux is
+//! already multiplied by the face time step, and it is zero for faces that
+//! are idle during this tick.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] future_dt0  the base time step
+//! \param [in] tick  the current tick within the step
+//! \param [in] klass  the time class of each cell
+//! \param [out] flux  the time integrated face fluxes
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_class_fluxes( 
+  client_handle_r<mesh_t> mesh,
+  handle_t<real_t> future_dt0,
+  size_t tick,
+  dense_handle_r<time_class_t> klass,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a,
+  dense_handle_r<flux_data_t> q,
+  dense_handle_w<stored_flux_data_t> flux
+) {
+
+  real_t dt0 = future_dt0;
+
+  const auto & face_list = mesh.faces( flecsi::owned );
+  auto num_faces = face_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  {
+
+    const auto & f = face_list[fit];
+    
+    // get the cell neighbors
+    const auto & cells = mesh.cells(f);
+    auto num_cells = cells.size();
+
+    // the face steps with its finer cell
+    auto k = klass( cells[0] );
+    if ( num_cells == 2 ) k = std::min( k, klass( cells[1] ) );
+
+    if ( !apps::common::starts_step( tick, k ) ) {
+      flux(f) = 0;
+      continue;
+    }
+
+    auto packed_left = pack( cells[0], d, v, p, e, T, a, q );
+    auto w_left = apps::common::compute_state<real_t>( packed_left );
+    
+    // compute the face flux
+    flux_data_t face_flux;
+    //
+    // interior cell
+    if ( num_cells == 2 ) {
+      auto packed_right = pack( cells[1], d, v, p, e, T, a, q );
+      auto w_right = apps::common::compute_state<real_t>( packed_right );
+      face_flux = flux_function<eqns_t>( w_left, w_right, f->normal() );
+    } 
+    // boundary cell
+    else {
+      face_flux = boundary_flux<eqns_t>( w_left, f->normal() );
+    }
+   
+    // scale the flux by the face area and its time step
+    face_flux *= f->area() * dt0 * apps::common::class_ticks( k );
+    flux(f) = apps::common::precision_cast<stored_flux_data_t>( face_flux );
+
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Accumulate the face fluxes, and update the cells that finish a
+//!        step at this tick.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] tick  the current tick within the step
+//! \param [in] klass  the time class of each cell
+//! \param [in] flux  the time integrated face fluxes
+//! \param [in,out] flux_sum  the fluxes accumulated since the last update
+////////////////////////////////////////////////////////////////////////////////
+void apply_class_update( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  size_t tick,
+  dense_handle_r<time_class_t> klass,
+  dense_handle_r<stored_flux_data_t> flux,
+  dense_handle_rw<stored_real_t> d,
+  dense_handle_rw<stored_vector_t> v,
+  dense_handle_rw<stored_real_t> e,
+  dense_handle_rw<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_rw<stored_real_t> a,
+  dense_handle_rw<flux_data_t> q,
+  dense_handle_rw<flux_data_t> flux_sum
+) {
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  {
+
+    const auto & c = cell_list[cit];
+
+    // faces of finer neighbors contribute at every one of their steps
+    if ( tick == 0 ) flux_sum(c) = 0;
+    flux_sum(c) += gather_fluxes( mesh, c, flux );
+    if ( !apps::common::ends_step( tick, klass(c) ) ) continue;
+
+    // the accumulated flux already carries the time steps
+    flux_data_t delta_u = flux_sum(c);
+    delta_u *= 1 / c->volume();
+    flux_sum(c) = 0;
+
+    // apply the update, the same way apply_update does
+    auto packed = pack(c, d, v, p, e, T, a, q);
+    auto u = apps::common::compute_state<real_t>( packed );
+    eqns_t::update_state_from_flux( u, delta_u );
+    eqns_t::update_flow_state_from_energy( u, eos );
+
+    // check the solution quantities
+    if ( eqns_t::internal_energy(u) < 0 || eqns_t::density(u) < 0 ) 
+      THROW_RUNTIME_ERROR( "Negative density or internal energy encountered!" );
+
+    apps::common::commit_state( packed, u );
+
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution with a local pseudo time step in each cell.
+//!
+//! Each cell advances with the largest step its own CFL limit allows, so
+//! the update is only meaningful at steady state.  The density residual,
+//! the net mass flux per unit volume, is stored for the convergence check.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state
+//! \param [in] CFL  the CFL number
+//! \param [out] residual  the density residual of each cell
+////////////////////////////////////////////////////////////////////////////////
+void apply_local_update( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  real_t CFL,
+  dense_handle_r<stored_flux_data_t> flux,
+  dense_handle_rw<stored_real_t> d,
+  dense_handle_rw<stored_vector_t> v,
+  dense_handle_rw<stored_real_t> e,
+  dense_handle_rw<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_rw<stored_real_t> a,
+  dense_handle_rw<flux_data_t> q,
+  dense_handle_w<real_t> residual
+) {
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  {
+
+    const auto & c = cell_list[cit];
+
+    auto packed = pack(c, d, v, p, e, T, a, q);
+    auto u = apps::common::compute_state<real_t>( packed );
+
+    // the pseudo time step comes from the state before the update
+    auto dt_inv = inverse_time_step( mesh, c, u );
+    if ( dt_inv <= 0 ) 
+      THROW_RUNTIME_ERROR( "infinite delta t" );
+
+    auto delta_u = gather_fluxes( mesh, c, flux );
+    delta_u *= 1 / c->volume();
+    residual(c) = delta_u[ eqns_t::equations::index::mass ];
+    delta_u *= CFL / dt_inv;
+
+    eqns_t::update_state_from_flux( u, delta_u );
+    eqns_t::update_flow_state_from_energy( u, eos );
+
+    // check the solution quantities
+    if ( eqns_t::internal_energy(u) < 0 || eqns_t::density(u) < 0 ) 
+      THROW_RUNTIME_ERROR( "Negative density or internal energy encountered!" );
+
+    apps::common::commit_state( packed, u );
+
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Reduce the residual of the owned cells to one norm.
+//!
+//! The l1 and l2 norms have to be reduced with a sum and the linf norm with
+//! a max, and the l2 norm still needs a square root, see
+//! apps::common::finish_residual_norm.
+//!
+//! The sums are evaluated in stages, see apps::common::global_sum.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] norm  the norm to evaluate
+//! \param [in] request  the stage of the sum, ignored for the linf norm
+//! \param [in] residual  the cell residuals
+//! \return the contribution of this rank
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_residual_norm( 
+  client_handle_r<mesh_t> mesh,
+  residual_norm_t norm,
+  sum_request_t request,
+  dense_handle_r<real_t> residual
+) {
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto contribution = [&]( size_t i ) {
+    const auto & c = cell_list[i];
+    return apps::common::residual_norm_contribution<real_t>(
+      norm, residual(c), c->volume() );
+  };
+
+  if ( norm == residual_norm_t::linf )
+    return std::max<real_t>( 0,
+      flecsale::utils::reproducible_max<real_t>( cell_list.size(), contribution ) );
+  else
+    return apps::common::local_sum( request, cell_list.size(), contribution );
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Touch the ensemble fields in parallel before they are first
+//!        written.
+//!
+//! See first_touch_fields.  A single run never maps the ensemble fields, so
+//! it does not allocate them.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] huge_pages  if true, ask for huge pages first
+////////////////////////////////////////////////////////////////////////////////
+void first_touch_ensemble_fields(
+  client_handle_r<mesh_t>  mesh,
+  bool huge_pages,
+  dense_handle_w<ensemble_state_t> W,
+  dense_handle_w<ensemble_flux_data_t> q,
+  dense_handle_w<stored_ensemble_flux_data_t> F
+) {
+
+  using apps::common::first_touch;
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  first_touch( cell_list, W, huge_pages );
+  first_touch( cell_list, q, huge_pages );
+
+  first_touch( mesh.faces( flecsi::owned ), F, huge_pages );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Set the initial conditions of every ensemble member.
+//!
+//! Without a file, every member gets inputs_t::initial_conditions.  With
+//! one, the lua function gets the member as its last argument, see
+//! evaluate_initial_conditions.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] eos  the equation of state of each member
+//! \param [in] num_members  the number of members
+//! \param [in] soln_time  the solution time
+//! \param [in] filename  the lua file with the initial conditions, may be
+//!                       empty
+////////////////////////////////////////////////////////////////////////////////
+void ensemble_initial_conditions(
+  client_handle_r<mesh_t>  mesh,
+  ensemble_eos_t eos,
+  size_t num_members,
+  real_t soln_time,
+  char_array_t filename,
+  dense_handle_w<ensemble_state_t> W,
+  dense_handle_w<ensemble_flux_data_t> q
+) {
+
+  auto set_state = [&]( const auto & c, size_t m, const auto & state ) {
+    // the temperature is not stored
+    stored_real_t T(0);
+    auto packed = pack_member( W(c), m, T );
+    auto u = apps::common::compute_state<real_t>( packed );
+    std::tie( eqns_t::density(u), eqns_t::velocity(u), eqns_t::pressure(u) ) =
+      state;
+    eqns_t::update_state_from_pressure( u, eos[m] );
+    q(c)[m] = eqns_t::conserved( u );
+    apps::common::commit_state( packed, u );
+  };
+
+  auto file = filename.str();
+
+  if ( file.empty() ) {
+    const auto & cell_list = mesh.cells( flecsi::owned );
+    auto num_cells = cell_list.size();
+    #pragma omp parallel for
+    for ( counter_t cit = 0; cit < num_cells; ++cit ) {
+      const auto & c = cell_list[cit];
+      auto state = inputs_t::initial_conditions( mesh, c.id(), soln_time );
+      for ( size_t m = 0; m < num_members; ++m ) set_state( c, m, state );
+    }
+    return;
+  }
+
+  // every thread gets its own lua state, lua is not thread safe
+  inputs_t::load_initial_conditions( file );
+
+  for ( size_t m = 0; m < num_members; ++m )
+    evaluate_initial_conditions( mesh, soln_time, m,
+      [&]( const auto & c, const auto & state ) { set_state( c, m, state ); } );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the time step of a range of ensemble members.
+//!
+//! With a shared time step, the range holds every member.  Otherwise there
+//! is one reduction per member, and they are all launched before any of
+//! them is waited on.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] first,last  the range of members
+//! \param [in] W  the ensemble state
+//! \param [in] CFL  the CFL number
+//! \param [in] max_dt  the largest step the members may take
+//! \return the smallest stable time step of the members
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_ensemble_time_step(
+  client_handle_r<mesh_t> mesh,
+  size_t first,
+  size_t last,
+  dense_handle_r_owned<ensemble_state_t> W,
+  real_t CFL,
+  real_t max_dt
+) {
+
+  // the faces of each cell are visited once for all the members
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto dt_inv = flecsale::utils::reproducible_max<real_t>( cell_list.size(),
+    [&]( size_t i ) {
+      const auto & c = cell_list[i];
+      const auto & w = W(c);
+      real_t cell_dt_inv(0);
+      for ( auto f : mesh.faces(c) ) {
+        auto delta_x = c->volume() / f->area();
+        const auto & norm = f->normal();
+        for ( auto m = first; m < last; ++m ) {
+          auto dti = eqns_t::fastest_wavespeed( 
+            unpack_member_state( w, m ), norm ) / delta_x;
+          cell_dt_inv = std::max( dti, cell_dt_inv );
+        }
+      }
+      return cell_dt_inv;
+    } );
+
+  if ( dt_inv <= 0 ) 
+    THROW_RUNTIME_ERROR( "infinite delta t" );
+
+  real_t time_step = CFL / dt_inv;
+  return std::min( time_step, max_dt );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the fluxes of every ensemble member at each face.
+//!
+//! The cells, normal and area of a face are gathered once, and the flux of
+//! every member follows in an inner loop over the members.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] num_members  the number of members
+//! \param [in] W  the ensemble state, including the ghosts
+//! \param [out] flux  the face fluxes of every member
+////////////////////////////////////////////////////////////////////////////////
+void evaluate_ensemble_fluxes( 
+  client_handle_r<mesh_t> mesh,
+  size_t num_members,
+  dense_handle_r<ensemble_state_t> W,
+  dense_handle_w<stored_ensemble_flux_data_t> flux
+) {
+
+  using apps::common::precision_cast;
+
+  const auto & face_list = mesh.faces( flecsi::owned );
+  auto num_faces = face_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t fit = 0; fit < num_faces; ++fit )
+  {
+    const auto & f = face_list[fit];
+    const auto & cells = mesh.cells(f);
+    const auto & norm = f->normal();
+    auto area = f->area();
+
+    const auto & w_left = W( cells[0] );
+    auto & face_flux = flux(f);
+
+    // interior face
+    if ( cells.size() == 2 ) {
+      const auto & w_right = W( cells[1] );
+      #pragma omp simd
+      for ( size_t m = 0; m < num_members; ++m ) {
+        auto member_flux = flux_function<eqns_t>( 
+          unpack_member_state( w_left, m ), unpack_member_state( w_right, m ),
+          norm );
+        member_flux *= area;
+        face_flux[m] = precision_cast<stored_flux_data_t>( member_flux );
+      }
+    }
+    // boundary face
+    else {
+      #pragma omp simd
+      for ( size_t m = 0; m < num_members; ++m ) {
+        auto u = unpack_member_state( w_left, m );
+        auto member_flux = boundary_flux<eqns_t>( u, norm );
+        member_flux *= area;
+        face_flux[m] = precision_cast<stored_flux_data_t>( member_flux );
+      }
+    }
+  } // for
+
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the solution of every ensemble member in each cell.
+//!
+//! The faces of a cell are gathered once, and their fluxes summed for every
+//! member.  A member that has reached the final time gets a zero time step
+//! and keeps its state.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state of each member
+//! \param [in] num_members  the number of members
+//! \param [in] delta_t  the time step of each member
+//! \param [in] flux  the face fluxes of every member
+//! \param [in,out] W  the ensemble state
+//! \param [in,out] q  the conserved quantities of every member
+////////////////////////////////////////////////////////////////////////////////
+void apply_ensemble_update( 
+  client_handle_r<mesh_t> mesh,
+  ensemble_eos_t eos,
+  size_t num_members,
+  member_array_t<real_t> delta_t,
+  dense_handle_r<stored_ensemble_flux_data_t> flux,
+  dense_handle_rw_owned<ensemble_state_t> W,
+  dense_handle_rw_owned<ensemble_flux_data_t> q
+) {
+
+  using apps::common::precision_cast;
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit )
+  {
+    const auto & c = cell_list[cit];
+
+    // sum the fluxes of all the members
+    ensemble_flux_data_t delta_u;
+    for ( size_t m = 0; m < num_members; ++m ) delta_u[m] = flux_data_t(0);
+
+    for ( auto f : mesh.faces(c) ) {
+      auto neigh = mesh.cells(f);
+      const auto & face_flux = flux(f);
+      if ( neigh[0] == c )
+        for ( size_t m = 0; m < num_members; ++m )
+          delta_u[m] -= precision_cast<flux_data_t>( face_flux[m] );
+      else
+        for ( size_t m = 0; m < num_members; ++m )
+          delta_u[m] += precision_cast<flux_data_t>( face_flux[m] );
+    } // face
+
+    // and apply them
+    auto & w = W(c);
+    auto & qc = q(c);
+    for ( size_t m = 0; m < num_members; ++m ) {
+      delta_u[m] *= delta_t[m] / c->volume();
+      stored_real_t T(0);
+      auto packed = pack_member( w, m, T, qc[m] );
+      auto u = apps::common::compute_state<real_t>( packed );
+      eqns_t::update_state_from_flux( u, delta_u[m] );
+      eqns_t::update_flow_state_from_energy( u, eos[m] );
+      if ( eqns_t::internal_energy(u) < 0 || eqns_t::density(u) < 0 ) 
+        THROW_RUNTIME_ERROR( "Negative density or internal energy "
+          "encountered in ensemble member " << m+1 << "!" );
+      apps::common::commit_state( packed, u );
+    }
+  } // for
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Copy the state of one ensemble member into the state fields.
+//!
+//! The output, diagnostics and probes read the state fields, so they are
+//! shared by all the members.  The temperature is computed here.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] eos  the equation of state of the member
+//! \param [in] member  the member
+//! \param [in] W  the ensemble state
+////////////////////////////////////////////////////////////////////////////////
+void extract_member( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  size_t member,
+  dense_handle_r_owned<ensemble_state_t> W,
+  dense_handle_w<stored_real_t> d,
+  dense_handle_w<stored_vector_t> v,
+  dense_handle_w<stored_real_t> e,
+  dense_handle_w<stored_real_t> p,
+  dense_handle_w<stored_real_t> T,
+  dense_handle_w<stored_real_t> a
+) {
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit ) {
+    const auto & c = cell_list[cit];
+    auto packed = pack( c, d, v, p, e, T, a );
+    auto u = apps::common::compute_state<real_t>( packed );
+    auto w = unpack_member_state( W(c), member );
+    eqns_t::density(u) = eqns_t::density(w);
+    eqns_t::velocity(u) = eqns_t::velocity(w);
+    eqns_t::pressure(u) = eqns_t::pressure(w);
+    eqns_t::internal_energy(u) = eqns_t::internal_energy(w);
+    eqns_t::sound_speed(u) = eqns_t::sound_speed(w);
+    eqns_t::update_temperature( u, eos );
+    apps::common::commit_state( packed, u );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the temperature before it is consumed.
+//!
+//! The update only refreshes the quantities needed to advance the solution,
+//! so this has to be called before anything reads the temperature.
+//!
+//! \param [in,out] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void update_temperature( 
+  client_handle_r<mesh_t> mesh,
+  eos_t eos,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_w<stored_real_t> T,
+  dense_handle_r<stored_real_t> a
+) {
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  #pragma omp parallel for
+  for ( counter_t cit = 0; cit < num_cells; ++cit ) {
+    const auto & c = cell_list[cit];
+    auto packed = pack( c, d, v, p, e, T, a );
+    auto u = apps::common::compute_state<real_t>( packed );
+    eqns_t::update_temperature( u, eos );
+    apps::common::commit_state( packed, u );
+  }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the local contribution to a global diagnostic.
+//!
+//! The caller is responsible for reducing the result with the operator
+//! that matches the quantity (sum, min or max).  The sums are evaluated in
+//! stages so they do not depend on the number of ranks, see
+//! apps::common::global_sum.
+//!
+//! \param [in] mesh       the mesh object
+//! \param [in] quantity   the quantity to compute
+//! \param [in] component  the vector component for vector quantities
+//! \param [in] origin     the origin used to measure the shock radius
+//! \param [in] shock_pressure  the pressure that marks a shocked cell
+//! \param [in] request    the stage of a sum
+//! \return the local value of the quantity
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_diagnostic(
+  client_handle_r<mesh_t> mesh,
+  diagnostic_t quantity,
+  size_t component,
+  vector_t origin,
+  real_t shock_pressure,
+  sum_request_t request,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p
+) {
+
+  using flecsale::utils::reproducible_max;
+  using flecsale::utils::reproducible_min;
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  // the integrals are sums over the cells
+  auto integrand = [&]( size_t i ) -> real_t {
+    const auto & c = cell_list[i];
+    const auto & vol = c->volume();
+    switch (quantity) {
+      case diagnostic_t::mass:
+        return d(c) * vol;
+      case diagnostic_t::momentum:
+        return d(c) * v(c)[component] * vol;
+      default:
+        return d(c) * vol *
+          ( e(c) + 0.5 * ristra::math::dot_product( v(c), v(c) ) );
+    }
+  };
+
+  switch (quantity) {
+    case diagnostic_t::mass:
+    case diagnostic_t::momentum:
+    case diagnostic_t::total_energy:
+      return apps::common::local_sum( request, num_cells, integrand );
+    case diagnostic_t::min_density:
+      return reproducible_min<real_t>( num_cells,
+        [&]( size_t i ) { return d( cell_list[i] ); } );
+    case diagnostic_t::max_density:
+      return reproducible_max<real_t>( num_cells,
+        [&]( size_t i ) { return d( cell_list[i] ); } );
+    case diagnostic_t::min_pressure:
+      return reproducible_min<real_t>( num_cells,
+        [&]( size_t i ) { return p( cell_list[i] ); } );
+    case diagnostic_t::max_pressure:
+      return reproducible_max<real_t>( num_cells,
+        [&]( size_t i ) { return p( cell_list[i] ); } );
+    case diagnostic_t::shock_radius:
+      return std::max<real_t>( 0, reproducible_max<real_t>( num_cells,
+        [&]( size_t i ) -> real_t {
+          const auto & c = cell_list[i];
+          if ( p(c) <= shock_pressure ) return 0;
+          return ristra::math::magnitude( c->centroid() - origin );
+        } ) );
+    default:
+      return apps::common::diagnostic_identity<real_t>( quantity );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Sample a field at a probe location.
+//!
+//! A probe is attached to the owned cell with the nearest centroid.  When
+//! asked for the distance, the distance to that cell is returned so that a
+//! min-reduction finds the owning rank.  When asked for a value, only the
+//! rank whose nearest cell matches the global distance returns the value, all
+//! other ranks return the lowest real so that a max-reduction selects it.
+//!
+//! \param [in] mesh       the mesh object
+//! \param [in] quantity   the quantity to sample
+//! \param [in] component  the vector component for vector quantities
+//! \param [in] x          the probe location
+//! \param [in] distance   the global distance to the nearest cell
+//! \return the sampled value
+////////////////////////////////////////////////////////////////////////////////
+real_t sample_probe(
+  client_handle_r<mesh_t> mesh,
+  probe_t quantity,
+  size_t component,
+  vector_t x,
+  real_t distance,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> p
+) {
+
+  // a rank without cells is never the nearest, and returns the identity
+  // of both reductions
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  if ( cell_list.size() == 0 )
+    return quantity == probe_t::distance ?
+      std::numeric_limits<real_t>::max() :
+      std::numeric_limits<real_t>::lowest();
+
+  // find the nearest owned cell
+  auto min_dist = std::numeric_limits<real_t>::max();
+  auto nearest = cell_list.front();
+
+  for ( auto c : cell_list ) {
+    auto dist = ristra::math::magnitude( c->centroid() - x );
+    if ( dist < min_dist ) {
+      min_dist = dist;
+      nearest = c;
+    }
+  }
+
+  if ( quantity == probe_t::distance )
+    return min_dist;
+
+  // another rank owns this probe
+  if ( min_dist > distance )
+    return std::numeric_limits<real_t>::lowest();
+
+  switch (quantity) {
+    case probe_t::density:
+      return d(nearest);
+    case probe_t::pressure:
+      return p(nearest);
+    case probe_t::velocity:
+      return v(nearest)[component];
+    default:
+      return std::numeric_limits<real_t>::lowest();
+  }
+
+}
+
+#ifdef FLECSALE_ENABLE_PYTHON
+////////////////////////////////////////////////////////////////////////////////
+/// \brief hand the solution to the python analysis
+///
+/// The owned values are exposed as read-only numpy arrays over the solver
+/// storage, so nothing is copied unless the storage is not strided.
+////////////////////////////////////////////////////////////////////////////////
+void python_analysis( 
+  client_handle_r<mesh_t> mesh, 
+  size_t iteration,
+  real_t time,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> p
+) {
+  clog(info) << "PYTHON ANALYSIS TASK" << std::endl;
+
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+  auto size = context.colors();
+
+  auto & hook = apps::common::python_hook( inputs_t::analysis );
+
+  auto cells = mesh.cells(flecsi::owned);
+  auto verts = mesh.vertices(flecsi::owned);
+
+  hook.add_field<stored_real_t>( "density", cells,
+    [&](auto c) -> decltype(auto) { return d(c); } );
+  hook.add_field<stored_real_t>( "velocity", cells,
+    [&](auto c) -> decltype(auto) { return v(c); } );
+  hook.add_field<stored_real_t>( "pressure", cells,
+    [&](auto c) -> decltype(auto) { return p(c); } );
+  hook.add_field<real_t>( "centroid", cells,
+    [](auto c) -> decltype(auto) { return c->centroid(); } );
+  hook.add_field<real_t>( "coordinates", verts,
+    [](auto vt) -> decltype(auto) { return vt->coordinates(); } );
+
+  hook.call( iteration, time, rank, size );
+}
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief output the solution
@@ -289,12 +2041,12 @@ void output(
 	char_array_t postfix,
 	size_t iteration,
 	real_t time,
-  dense_handle_r<real_t> d,
-  dense_handle_r<vector_t> v,
-  dense_handle_r<real_t> e,
-  dense_handle_r<real_t> p,
-  dense_handle_r<real_t> T,
-  dense_handle_r<real_t> a
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a
 ) {
   clog(info) << "OUTPUT MESH TASK" << std::endl;
  
@@ -316,6 +2068,185 @@ void output(
   );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// \brief output the solution as compressed fields
+///
+/// Only the owned cells are written, and each field is compressed with the
+/// settings chosen for it in the input file.  When the output is aggregated,
+/// the fields are only posted to this rank's writer, and the solver goes on
+/// while they are sent.  wait_fields completes them, and the writer writes
+/// the file then.  The writers talk over MPI, so this runs as an MPI task,
+/// one point per rank and all of them at once.
+////////////////////////////////////////////////////////////////////////////////
+void write_fields( 
+  client_handle_r<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t iteration,
+  real_t time,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a
+) {
+  clog(info) << "WRITE FIELDS TASK" << std::endl;
+ 
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  constexpr auto num_dims = mesh_t::num_dimensions;
+  const auto & settings = inputs_t::field_output;
+
+  // gather the owned values of each field and compress them
+  flecsale::io::field_records_t records;
+  std::vector<real_t> values;
+
+  auto write_scalar = [&]( const std::string & name, const auto & f ) {
+    values.clear();
+    for ( auto c : mesh.cells(flecsi::owned) ) values.emplace_back( f(c) );
+    records.write( name, values.data(), values.size(), 1, settings.codec(name) );
+  };
+
+  write_scalar( "density", d );
+  write_scalar( "internal_energy", e );
+  write_scalar( "pressure", p );
+  write_scalar( "temperature", T );
+  write_scalar( "sound_speed", a );
+
+  values.clear();
+  for ( auto c : mesh.cells(flecsi::owned) )
+    for ( auto x : v(c) ) values.emplace_back( x );
+  records.write( "velocity", values.data(), values.size(), num_dims,
+    settings.codec("velocity") );
+
+  // one file per rank
+  if ( !settings.aggregation.enabled() ) {
+    auto output_filename = 
+      prefix.str() + "_rank" + apps::common::zero_padded(rank) +
+      "." + apps::common::zero_padded(iteration) + ".flz";
+    flecsale::io::field_file_writer_t file( output_filename, iteration, time );
+    file.write_records( records );
+    return;
+  }
+
+  // or one file per writer, indexed by global id
+  auto & aggregator = apps::common::field_aggregator();
+  if ( !aggregator )
+    aggregator = std::make_unique<flecsale::io::aggregator_t>(
+      MPI_COMM_WORLD, settings.aggregation
+    );
+
+  const auto & cell_lid_to_gid =
+    context.index_map( mesh_t::index_spaces_t::cells );
+  std::vector<std::uint64_t> ids;
+  for ( auto c : mesh.cells(flecsi::owned) )
+    ids.emplace_back( cell_lid_to_gid.at(c.id()) );
+
+  auto output_filename = 
+    prefix.str() + "_writer" + 
+    apps::common::zero_padded(aggregator->writer_rank()) +
+    "." + apps::common::zero_padded(iteration) + ".flz";
+  // the last output was waited on, so nothing else is in flight
+  apps::common::pending_field_write() =
+    aggregator->post( output_filename, iteration, time, ids, records );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief complete the aggregated output posted by write_fields
+////////////////////////////////////////////////////////////////////////////////
+void wait_fields( client_handle_r<mesh_t> mesh ) 
+{
+  apps::common::pending_field_write().wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief complete the last output, and release the writer groups before
+///        MPI shuts down
+////////////////////////////////////////////////////////////////////////////////
+void finish_fields( client_handle_r<mesh_t> mesh ) 
+{
+  apps::common::pending_field_write().wait();
+  auto & aggregator = apps::common::field_aggregator();
+  if ( aggregator ) aggregator.reset();
+}
+
+#ifdef FLECSALE_ENABLE_VTK
+////////////////////////////////////////////////////////////////////////////////
+/// \brief refresh the vtk view of the solution
+///
+/// The topology is only built on the first call.  The cell fields are
+/// copied into the grid every call, so it can be used once the task is done.
+////////////////////////////////////////////////////////////////////////////////
+void update_vtk( 
+  client_handle_r<mesh_t> mesh, 
+  real_t time,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a
+) {
+  auto & adaptor = 
+    apps::common::vtk_adaptor<stored_real_t, mesh_t::num_dimensions>();
+
+  if ( !adaptor.has_topology() )
+    adaptor.build_topology( mesh );
+
+  auto cells = mesh.cells(flecsi::owned);
+
+  adaptor.add_cell_field( "density", cells,
+    [&](auto c) -> decltype(auto) { return d(c); } );
+  adaptor.add_cell_field( "velocity", cells,
+    [&](auto c) -> decltype(auto) { return v(c); } );
+  adaptor.add_cell_field( "internal_energy", cells,
+    [&](auto c) -> decltype(auto) { return e(c); } );
+  adaptor.add_cell_field( "pressure", cells,
+    [&](auto c) -> decltype(auto) { return p(c); } );
+  adaptor.add_cell_field( "temperature", cells,
+    [&](auto c) -> decltype(auto) { return T(c); } );
+  adaptor.add_cell_field( "sound_speed", cells,
+    [&](auto c) -> decltype(auto) { return a(c); } );
+
+  adaptor.set_time( time );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief output the solution to a vtk unstructured grid file
+////////////////////////////////////////////////////////////////////////////////
+void write_vtu( 
+  client_handle_r<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t iteration,
+  real_t time,
+  dense_handle_r<stored_real_t> d,
+  dense_handle_r<stored_vector_t> v,
+  dense_handle_r<stored_real_t> e,
+  dense_handle_r<stored_real_t> p,
+  dense_handle_r<stored_real_t> T,
+  dense_handle_r<stored_real_t> a
+) {
+  clog(info) << "WRITE VTU TASK" << std::endl;
+ 
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  update_vtk( mesh, time, d, v, e, p, T, a );
+
+  // figure out this ranks file name
+  auto output_filename = 
+    prefix.str() + "_rank" + apps::common::zero_padded(rank) +
+    "." + apps::common::zero_padded(iteration) + ".vtu";
+
+  apps::common::vtk_adaptor<stored_real_t, mesh_t::num_dimensions>().write( 
+    output_filename
+  );
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief output the solution
 ////////////////////////////////////////////////////////////////////////////////
@@ -353,10 +2284,10 @@ void dump(
 	client_handle_r<mesh_t> mesh,
 	size_t iteration,
 	real_t time,
-	dense_handle_r<real_t> d,
-	dense_handle_r<vector_t> v,
-	dense_handle_r<real_t> e,
-	dense_handle_r<real_t> p,
+	dense_handle_r<stored_real_t> d,
+	dense_handle_r<stored_vector_t> v,
+	dense_handle_r<stored_real_t> e,
+	dense_handle_r<stored_real_t> p,
 	char_array_t filename) {
 	// get the context
 	auto & context = flecsi::execution::context_t::instance();
@@ -433,12 +2364,52 @@ void dump(
 ////////////////////////////////////////////////////////////////////////////////
 
 flecsi_register_task(update_geometry, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(report_thread_bindings, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(first_touch_fields, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(initial_conditions, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(initial_conditions_from_file, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(evaluate_time_step, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_gradients, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(evaluate_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_interior_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_halo_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(pack_halo_state, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_packed_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_reconstructed_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_steady_reconstructed_fluxes, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(apply_update, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(apply_scattered_update, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(build_face_coloring, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(time_flux_accumulation, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(build_halo_split, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(save_state, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(apply_stage_update, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(classify_cells, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_base_time_step, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_class_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(apply_class_update, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(apply_local_update, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_residual_norm, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(first_touch_ensemble_fields, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(ensemble_initial_conditions, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_ensemble_time_step, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_ensemble_fluxes, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(apply_ensemble_update, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(extract_member, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(update_temperature, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_diagnostic, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(sample_probe, apps::hydro, loc, index|flecsi::leaf);
+#ifdef FLECSALE_ENABLE_PYTHON
+flecsi_register_task(python_analysis, apps::hydro, loc, index|flecsi::leaf);
+#endif
 flecsi_register_task(output, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(write_fields, apps::hydro, mpi, index);
+flecsi_register_task(wait_fields, apps::hydro, mpi, index);
+flecsi_register_task(finish_fields, apps::hydro, mpi, index);
+#ifdef FLECSALE_ENABLE_VTK
+flecsi_register_task(update_vtk, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(write_vtu, apps::hydro, loc, index|flecsi::leaf);
+#endif
 flecsi_register_task(print, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(dump, apps::hydro, loc, index|flecsi::leaf);
 
@@ -22,6 +22,18 @@
 
 #include <flecsi/data/global_accessor.h>
 
+#include "../common/analysis.h"
+#include "../common/diagnostics.h"
+#include "../common/ensemble.h"
+#include "../common/field_output.h"
+#include "../common/flux_accumulation.h"
+#include "../common/global_sum.h"
+#include "../common/halo_split.h"
+#include "../common/local_time_stepping.h"
+#include "../common/precision.h"
+#include "../common/reconstruction.h"
+#include "../common/steady_state.h"
+#include "../common/time_integrator.h"
 #include "../common/utils.h"
 
 namespace apps {
@@ -38,6 +50,88 @@ using eos_t = flecsale::eos::ideal_gas_t<real_t>;
 using eqns_t = typename flecsale::eqns::euler_eqns_t<real_t, mesh_t::num_dimensions>;
 
 using flux_data_t = eqns_t::flux_data_t;
+using primitive_data_t = eqns_t::primitive_data_t;
+using gradient_data_t = eqns_t::gradient_data_t;
+
+//! the types the bulk fields are stored as, these are single precision in
+//! mixed precision builds while the arithmetic stays in real_t
+//! \{
+using stored_real_t = apps::common::stored_t<real_t>;
+using stored_vector_t = apps::common::stored_t<vector_t>;
+using stored_flux_data_t = apps::common::stored_t<flux_data_t>;
+using stored_gradient_data_t = apps::common::stored_t<gradient_data_t>;
+//! \}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The part of the cell state the flux evaluation reads.
+//!
+//! Packing it into one field means a single ghost exchange per step instead
+//! of one per state field.  The temperature is not needed by the fluxes, so
+//! it is left out.
+////////////////////////////////////////////////////////////////////////////////
+struct halo_state_t {
+  stored_real_t density;
+  stored_vector_t velocity;
+  stored_real_t pressure;
+  stored_real_t internal_energy;
+  stored_real_t sound_speed;
+};
+
+//! \brief Expand a halo state into a full state in the compute precision.
+//! The temperature is set to zero.
+inline eqns_t::state_data_t unpack_halo_state( const halo_state_t & h )
+{
+  using apps::common::precision_cast;
+  return eqns_t::state_data_t(
+    precision_cast<real_t>( h.density ),
+    precision_cast<vector_t>( h.velocity ),
+    precision_cast<real_t>( h.pressure ),
+    precision_cast<real_t>( h.internal_energy ),
+    real_t(0),
+    precision_cast<real_t>( h.sound_speed )
+  );
+}
+
+//! the ensemble types
+//! \{
+template< typename T >
+using member_array_t = apps::common::member_array_t<T>;
+using ensemble_eos_t = member_array_t<eos_t>;
+using ensemble_flux_data_t = member_array_t<flux_data_t>;
+using stored_ensemble_flux_data_t = member_array_t<stored_flux_data_t>;
+//! \}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The state of every ensemble member in one cell.
+//!
+//! The members of each variable are contiguous, so a loop over the members
+//! reads them with unit stride.  Like the halo state, this is the only cell
+//! field the ensemble fluxes read, so the ghosts of all the members arrive
+//! in one exchange.  The temperature is only computed for output.
+////////////////////////////////////////////////////////////////////////////////
+struct ensemble_state_t {
+  member_array_t<stored_real_t> density;
+  member_array_t<stored_vector_t> velocity;
+  member_array_t<stored_real_t> pressure;
+  member_array_t<stored_real_t> internal_energy;
+  member_array_t<stored_real_t> sound_speed;
+};
+
+//! \brief Extract the state of one member in the compute precision.
+//! The temperature is set to zero.
+inline eqns_t::state_data_t unpack_member_state(
+  const ensemble_state_t & w, std::size_t m )
+{
+  using apps::common::precision_cast;
+  return eqns_t::state_data_t(
+    precision_cast<real_t>( w.density[m] ),
+    precision_cast<vector_t>( w.velocity[m] ),
+    precision_cast<real_t>( w.pressure[m] ),
+    precision_cast<real_t>( w.internal_energy[m] ),
+    real_t(0),
+    precision_cast<real_t>( w.sound_speed[m] )
+  );
+}
 
 
 // explicitly use some other stuff
@@ -56,6 +150,18 @@ using dense_handle_rw = flecsi_sp::utils::dense_handle_rw<T>;
 template<typename T>
 using dense_handle_r = flecsi_sp::utils::dense_handle_r<T>;
 
+//! access to the owned entities only, a task that only uses these for the
+//! fields with ghosts does not wait for the ghost exchange
+//! \{
+template<typename T>
+using dense_handle_r_owned =
+  flecsi::dense_accessor<T, flecsi::ro, flecsi::ro, flecsi::na>;
+
+template<typename T>
+using dense_handle_rw_owned =
+  flecsi::dense_accessor<T, flecsi::rw, flecsi::rw, flecsi::na>;
+//! \}
+
 template<typename T>
 using global_handle_w = flecsi::global_accessor_u<T, flecsi::wo>;
 
@@ -95,6 +201,55 @@ enum class mode_t
 //! a trivially copyable character array
 using char_array_t = flecsi_sp::utils::char_array_t;
 
+//! the diagnostics types
+//! \{
+using diagnostic_t = apps::common::diagnostic_t;
+using probe_t = apps::common::probe_t;
+using diagnostics_inputs_t = apps::common::diagnostics_inputs_u<real_t, vector_t>;
+//! \}
+
+//! the field output types
+//! \{
+using output_format_t = apps::common::output_format_t;
+using field_output_inputs_t = apps::common::field_output_inputs_t;
+//! \}
+
+//! the python analysis inputs
+using analysis_inputs_t = apps::common::analysis_inputs_t;
+
+//! the reconstruction inputs
+using reconstruction_inputs_t = apps::common::reconstruction_inputs_t;
+
+//! the time integrator type
+using time_integrator_t = apps::common::time_integrator_t;
+
+//! the local time stepping types
+//! \{
+using time_class_t = apps::common::time_class_t;
+using local_time_stepping_inputs_t = apps::common::local_time_stepping_inputs_t;
+//! \}
+
+//! the part of the owned entities a task works on
+using region_t = apps::common::region_t;
+
+//! the way the face fluxes are summed into the cells
+using flux_accumulation_t = apps::common::flux_accumulation_t;
+
+//! the ensemble inputs
+//! \{
+using ensemble_inputs_t = apps::common::ensemble_inputs_t;
+using ensemble_time_step_t = apps::common::ensemble_time_step_t;
+//! \}
+
+//! a stage of a global sum
+using sum_request_t = apps::common::sum_request_t;
+
+//! the steady state types
+//! \{
+using residual_norm_t = apps::common::residual_norm_t;
+using steady_state_inputs_t = apps::common::steady_state_inputs_t;
+//! \}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief alias the flux function
 //! Change the called function to alter the flux evaluation.
@@ -131,5 +286,21 @@ decltype(auto) pack( T && loc, ARGS&&... args )
     std::forward_as_tuple( std::forward<ARGS>(args)(std::forward<T>(loc))... ); 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Pack the state of one ensemble member into a tuple, like pack()
+//!
+//! \param [in] w  the ensemble state of a cell
+//! \param [in] m  the member
+//! \param [in] T  stands in for the temperature, which is not stored
+//! \param [in] args  appended as they are, such as the conserved quantities
+////////////////////////////////////////////////////////////////////////////////
+template< typename W, typename TT, typename...ARGS >
+decltype(auto) pack_member( W & w, std::size_t m, TT & T, ARGS &... args )
+{ 
+  return 
+    std::forward_as_tuple( w.density[m], w.velocity[m], w.pressure[m],
+      w.internal_energy[m], T, w.sound_speed[m], args... ); 
+}
+
 } // namespace hydro
 } // namespace apps
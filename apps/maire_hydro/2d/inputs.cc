@@ -65,6 +65,29 @@ eos_t inputs_t::eos =
     /* gamma */ 1.4, /* cv */ 1.0 
   ); 
 
+// the diagnostics, measured from the blast origin
+diagnostics_inputs_t inputs_t::diagnostics =
+{ .shock_origin = 0, .shock_pressure = 1.e-4 };
+
+// the fields are written to exodus files by default
+field_output_inputs_t inputs_t::field_output = {};
+
+// there is no python analysis by default
+analysis_inputs_t inputs_t::analysis = {};
+
+// the whole mesh is updated by default
+activity_inputs_t inputs_t::activity = {};
+
+// the balance is checked every 100 steps
+load_balance_inputs_t inputs_t::load_balance = { .frequency = 100 };
+
+// the nodal solve steals work, boundary vertices first
+loop_schedule_inputs_t inputs_t::loop_schedule =
+{ .work_stealing = true, .costly_first = true };
+
+// the fields use regular pages by default
+bool inputs_t::huge_pages = false;
+
 // this is a function to set the initial conditions
 inputs_t::ics_return_t inputs_t::initial_conditions(
 	const mesh_t & mesh, size_t local_id, const real_t &)
@@ -21,8 +21,10 @@
 // system includes
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 namespace apps {
 namespace hydro {
@@ -147,7 +149,7 @@ flecsi_register_field(
   mesh_t,
   hydro,
   corner_normal,
-  mesh_t::vector_t,
+  stored_vector_t,
   dense,
   1,
   mesh_t::index_spaces_t::corners
@@ -157,13 +159,171 @@ flecsi_register_field(
   mesh_t,
   hydro,
   corner_force,
-  mesh_t::vector_t,
+  stored_vector_t,
   dense,
   1,
   mesh_t::index_spaces_t::corners
 );
+
+// the cell state the nodal solve reads, packed so the ghosts are
+// exchanged as one field
+flecsi_register_field(
+  mesh_t,
+  hydro,
+  halo_state,
+  halo_state_t,
+  dense,
+  1,
+  mesh_t::index_spaces_t::cells
+);
   
 
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate the global diagnostics and probes.
+//!
+//! Every rank must call this since it launches the reductions.  Only the
+//! rank that owns a writer appends the row.
+//!
+//! \param [in] mesh  the mesh client handle
+//! \param [in] writer  the history file, null on all but one rank
+//! \param [in] step  the current step
+//! \param [in] time  the current solution time
+//! \param [in] Mc,uc,pc,dc,ec  the cell state handles
+///////////////////////////////////////////////////////////////////////////////
+template< 
+  typename M, typename MC, typename UC, typename PC, typename DC, typename EC
+>
+void evaluate_diagnostics(
+  M & mesh,
+  apps::common::diagnostics_writer_t * writer,
+  size_t step,
+  real_t time,
+  MC & Mc, UC & uc, PC & pc, DC & dc, EC & ec
+) {
+  
+  constexpr auto num_dims = mesh_t::num_dimensions;
+  const auto & inputs = inputs_t::diagnostics;
+  const auto & origin = inputs.shock_origin;
+  const auto & shock_pressure = inputs.shock_pressure;
+
+  // every reduction of a stage is launched before any of them is waited
+  // on, so an output step takes a few round trips, not one per quantity
+  auto launch_min = [&]( diagnostic_t quantity ) {
+    return flecsi_execute_reduction_task( evaluate_diagnostic, apps::hydro,
+      index, min, double, mesh, quantity, size_t{0}, origin, shock_pressure,
+      sum_request_t{}, Mc, uc, pc, dc, ec );
+  };
+  auto launch_max = [&]( diagnostic_t quantity, size_t i = 0,
+                         const sum_request_t & request = {} ) {
+    return flecsi_execute_reduction_task( evaluate_diagnostic, apps::hydro,
+      index, max, double, mesh, quantity, i, origin, shock_pressure,
+      request, Mc, uc, pc, dc, ec );
+  };
+  auto launch_sum = [&]( diagnostic_t quantity, size_t i,
+                         const sum_request_t & request ) {
+    return flecsi_execute_reduction_task( evaluate_diagnostic, apps::hydro,
+      index, sum, double, mesh, quantity, i, origin, shock_pressure,
+      request, Mc, uc, pc, dc, ec );
+  };
+
+  // the extrema and the probe owners take one reduction each
+  auto min_density = launch_min( diagnostic_t::min_density );
+  auto max_density = launch_max( diagnostic_t::max_density );
+  auto min_pressure = launch_min( diagnostic_t::min_pressure );
+  auto max_pressure = launch_max( diagnostic_t::max_pressure );
+  auto shock_radius = launch_max( diagnostic_t::shock_radius );
+
+  auto launch_distance = [&]( const vector_t & x ) {
+    return flecsi_execute_reduction_task( sample_probe, apps::hydro, index,
+      min, double, mesh, probe_t::distance, size_t{0}, x, real_t{0},
+      uc, pc, dc );
+  };
+  std::vector< decltype( launch_distance( origin ) ) > distances;
+  for ( const auto & x : inputs.probes )
+    distances.emplace_back( launch_distance( x ) );
+
+  // the integrals share the stages of their sums
+  std::vector< std::pair<diagnostic_t, size_t> > integrals;
+  integrals.emplace_back( diagnostic_t::mass, 0 );
+  for ( size_t dim=0; dim<num_dims; ++dim )
+    integrals.emplace_back( diagnostic_t::momentum, dim );
+  integrals.emplace_back( diagnostic_t::total_energy, 0 );
+
+  auto totals = apps::common::global_sums( integrals.size(),
+    [&]( size_t j, const sum_request_t & request ) {
+      return launch_max( integrals[j].first, integrals[j].second, request );
+    },
+    [&]( size_t j, const sum_request_t & request ) {
+      return launch_sum( integrals[j].first, integrals[j].second, request );
+    } );
+
+  std::vector<double> row{ static_cast<double>(step), time };
+  row.insert( row.end(), totals.begin(), totals.end() );
+  row.emplace_back( min_density.get() );
+  row.emplace_back( max_density.get() );
+  row.emplace_back( min_pressure.get() );
+  row.emplace_back( max_pressure.get() );
+  row.emplace_back( shock_radius.get() );
+
+  // the owner of each probe is the rank with the nearest cell, and the
+  // samples of all the probes are launched together
+  auto launch_sample = [&]( const vector_t & x, real_t dist,
+                            probe_t quantity, size_t i = 0 ) {
+    return flecsi_execute_reduction_task( sample_probe, apps::hydro, index,
+      max, double, mesh, quantity, i, x, dist, uc, pc, dc );
+  };
+  std::vector< decltype( launch_sample( origin, 0, probe_t::density ) ) >
+    samples;
+  for ( size_t n=0; n<inputs.probes.size(); ++n ) {
+    const auto & x = inputs.probes[n];
+    real_t dist = distances[n].get();
+    samples.emplace_back( launch_sample( x, dist, probe_t::density ) );
+    samples.emplace_back( launch_sample( x, dist, probe_t::pressure ) );
+    for ( size_t dim=0; dim<num_dims; ++dim )
+      samples.emplace_back( launch_sample( x, dist, probe_t::velocity, dim ) );
+  }
+  for ( auto & s : samples ) row.emplace_back( s.get() );
+
+  if ( writer ) writer->write( row );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Check the balance of the estimated work between ranks.
+//!
+//! Every rank must call this since it launches the reductions.  The cells
+//! are partitioned once when the mesh is read, so an imbalance above the
+//! threshold is reported as a request for a repartition.
+//!
+//! \param [in] mesh  the mesh client handle
+//! \param [in] rank  the rank of the caller
+//! \param [in] step  the current step
+//! \return the ratio of the largest to the average cost
+///////////////////////////////////////////////////////////////////////////////
+template< typename M >
+double check_load_balance( M & mesh, size_t rank, size_t step )
+{
+  auto & context = flecsi::execution::context_t::instance();
+  const auto & inputs = inputs_t::load_balance;
+
+  auto max_cost = flecsi_execute_reduction_task( evaluate_cost, apps::hydro,
+    index, max, double, mesh, inputs ).get();
+  auto total_cost = flecsi_execute_reduction_task( evaluate_cost, apps::hydro,
+    index, sum, double, mesh, inputs ).get();
+
+  auto imbalance =
+    apps::common::load_imbalance( max_cost, total_cost, context.colors() );
+
+  if ( rank == 0 ) {
+    cout << "Load imbalance at step " << step << " is "
+         << std::fixed << std::setprecision(3) << imbalance;
+    if ( inputs.needs_repartition( imbalance ) )
+      cout << ", above " << inputs.threshold << ", a repartition is due";
+    cout << "." << std::endl;
+  }
+
+  return imbalance;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //! \brief A sample test of the hydro solver
 ///////////////////////////////////////////////////////////////////////////////
@@ -252,8 +412,9 @@ int driver(int argc, char** argv)
 
   // solver state
   auto dUdt = flecsi_get_handle(mesh, hydro, cell_residual, flux_data_t, dense, 0);
-  auto npc = flecsi_get_handle(mesh, hydro, corner_normal, vector_t, dense, 0);
-  auto Fpc = flecsi_get_handle(mesh, hydro, corner_force, vector_t, dense, 0);
+  auto npc = flecsi_get_handle(mesh, hydro, corner_normal, stored_vector_t, dense, 0);
+  auto Fpc = flecsi_get_handle(mesh, hydro, corner_force, stored_vector_t, dense, 0);
+  auto H = flecsi_get_handle(mesh, hydro, halo_state, halo_state_t, dense, 0);
   
 
   //===========================================================================
@@ -272,6 +433,13 @@ int driver(int argc, char** argv)
   // Initial conditions
   //===========================================================================
 
+  // report where the threads run, and spread the field pages over the
+  // sockets before the serial initial conditions write to them
+  flecsi_execute_task( report_thread_bindings, apps::hydro, index, mesh );
+  flecsi_execute_task( first_touch_fields, apps::hydro, index, mesh,
+    inputs_t::huge_pages, Vc, Mc, uc, pc, dc, ec, Tc, ac, uc0, ec0, dUdt,
+    xn, un, npc, Fpc, H );
+
   // now call the main task to set the ics.  Here we set primitive/physical
   // quanties
   flecsi_execute_task(
@@ -283,7 +451,17 @@ int driver(int argc, char** argv)
     soln_time,
     Vc, Mc, uc, pc, dc, ec, Tc, ac
   );
+  flecsi_execute_task( pack_halo_state, apps::hydro, index, mesh,
+    dc, uc, pc, ac, H );
+
+  // find the regions that are not at rest
+  if ( inputs_t::activity.enabled )
+    flecsi_execute_task( initialize_activity, apps::hydro, index, mesh,
+      inputs_t::activity, H, un, dUdt );
 
+  // check the initial partition
+  if ( inputs_t::load_balance.frequency > 0 )
+    check_load_balance( mesh, rank, time_cnt );
 
   //===========================================================================
   // Pre-processing
@@ -294,21 +472,93 @@ int driver(int argc, char** argv)
 
   // now output the solution
   auto has_output = (inputs_t::output_freq > 0);
-  if (has_output) {
-    flecsi_execute_task(
-      output,
- 			apps::hydro,
- 			index,
- 			mesh,
- 			prefix_char,
- 			postfix_char,
-			time_cnt,
-      soln_time,
- 			dc, uc, ec, pc, Tc, ac
+  const auto & field_format = inputs_t::field_output.format;
+
+  // the updates skip the temperature, so it is only computed when something
+  // is about to read it
+  bool temperature_stale = false;
+  auto materialize_temperature = [&]() {
+    if ( !temperature_stale ) return;
+    flecsi_execute_task( update_temperature, apps::hydro, index, mesh,
+      inputs_t::eos, Vc, Mc, uc, pc, dc, ec, Tc, ac );
+    temperature_stale = false;
+  };
+
+  // the compressed and vtu fields do not go through exodus
+  auto write_solution = [&]() {
+    materialize_temperature();
+    switch ( field_format ) {
+#ifdef FLECSALE_ENABLE_VTK
+    case output_format_t::vtu:
+      flecsi_execute_task(
+        write_vtu,
+        apps::hydro,
+        index,
+        mesh,
+        prefix_char,
+        time_cnt,
+        soln_time,
+        dc, uc, ec, pc, Tc, ac
+      );
+      break;
+#endif
+    case output_format_t::compressed:
+      // the last aggregated output has to land before the next one
+      if ( inputs_t::field_output.aggregation.enabled() )
+        flecsi_execute_task( wait_fields, apps::hydro, index, mesh );
+      flecsi_execute_task(
+        write_fields,
+        apps::hydro,
+        index,
+        mesh,
+        prefix_char,
+        time_cnt,
+        soln_time,
+        dc, uc, ec, pc, Tc, ac
+      );
+      break;
+    default:
+      flecsi_execute_task(
+        output,
+ 			  apps::hydro,
+ 			  index,
+ 			  mesh,
+ 			  prefix_char,
+ 			  postfix_char,
+ 			  time_cnt,
+        soln_time,
+ 			  dc, uc, ec, pc, Tc, ac
+      );
+    }
+  };
+
+  if (has_output) write_solution();
+
+
+
+  // the diagnostics history is only written by the first rank
+  std::unique_ptr<apps::common::diagnostics_writer_t> diagnostics_file;
+  auto has_diagnostics = (inputs_t::diagnostics.frequency > 0);
+  if ( has_diagnostics && rank == 0 ) {
+    auto ext = inputs_t::diagnostics.binary ? ".bin" : ".csv";
+    diagnostics_file = std::make_unique<apps::common::diagnostics_writer_t>(
+      inputs_t::prefix + "-diagnostics" + ext,
+      apps::common::diagnostics_columns( 
+        mesh_t::num_dimensions, inputs_t::diagnostics.probes.size() ),
+      inputs_t::diagnostics.binary
     );
   }
 
+  if ( has_diagnostics )
+    evaluate_diagnostics(
+      mesh, diagnostics_file.get(), time_cnt, soln_time, Mc, uc, pc, dc, ec );
 
+#ifdef FLECSALE_ENABLE_PYTHON
+  // run the in situ analysis on the initial conditions
+  if ( inputs_t::analysis.frequency > 0 )
+    flecsi_execute_task( python_analysis, apps::hydro, index, mesh,
+      time_cnt, soln_time, dc, uc, pc );
+#endif
 
   // dump connectivity
   auto name = flecsi_sp::utils::to_char_array( inputs_t::prefix+".txt" );
@@ -349,7 +599,7 @@ int driver(int argc, char** argv)
 			 estimate_nodal_state,
 			 apps::hydro,
        index,
-			 mesh, uc, un
+			 mesh, inputs_t::loop_schedule, H, un
 		);
 
     // compute the nodal velocity at n=0
@@ -359,8 +609,8 @@ int driver(int argc, char** argv)
       index,
       mesh,
       soln_time,
-      Vc, Mc, uc, pc, dc, ec, Tc, ac,
-      un, npc, Fpc
+      inputs_t::loop_schedule,
+      H, un, npc, Fpc
     );
 
     // compute the fluxes
@@ -433,6 +683,11 @@ int driver(int argc, char** argv)
 			inputs_t::eos,
 			Vc, Mc, uc, pc, dc, ec, Tc, ac 
 		);
+    temperature_stale = true;
+
+    // the nodal solve only reads the ghosts through the packed state
+    flecsi_execute_task( pack_halo_state, apps::hydro, index, mesh,
+      dc, uc, pc, ac, H );
 
     //--------------------------------------------------------------------------
     // Corrector : Evaluate Forces at n=1/2
@@ -445,8 +700,8 @@ int driver(int argc, char** argv)
       index,
       mesh,
       soln_time,
-      Vc, Mc, uc, pc, dc, ec, Tc, ac,
-      un, npc, Fpc
+      inputs_t::loop_schedule,
+      H, un, npc, Fpc
     );
 
     // compute the fluxes
@@ -502,16 +757,43 @@ int driver(int argc, char** argv)
 			inputs_t::eos,
 			Vc, Mc, uc, pc, dc, ec, Tc, ac 
 		);
+    temperature_stale = true;
+
+    // the nodal solve only reads the ghosts through the packed state
+    flecsi_execute_task( pack_halo_state, apps::hydro, index, mesh,
+      dc, uc, pc, ac, H );
 
 
     //--------------------------------------------------------------------------
     // End Time step
     //--------------------------------------------------------------------------
 
+    // grow the active regions with the disturbance
+    if ( inputs_t::activity.enabled )
+      flecsi_execute_task( update_activity, apps::hydro, index, mesh,
+        inputs_t::activity, H );
+
     // update time
     soln_time += time_step;
     time_cnt++;
+
+    // the active region shifts the work between ranks
+    if ( inputs_t::load_balance.is_due( time_cnt ) )
+      check_load_balance( mesh, rank, time_cnt );
   
+    // stream the diagnostics
+    if ( inputs_t::diagnostics.is_due( time_cnt ) )
+      evaluate_diagnostics(
+        mesh, diagnostics_file.get(), time_cnt, soln_time, 
+        Mc, uc, pc, dc, ec );
+
+#ifdef FLECSALE_ENABLE_PYTHON
+    // run the in situ analysis
+    if ( inputs_t::analysis.is_due( time_cnt ) )
+      flecsi_execute_task( python_analysis, apps::hydro, index, mesh,
+        time_cnt, soln_time, dc, uc, pc );
+#endif
+
     // now output the solution
     if ( has_output && 
         (time_cnt % inputs_t::output_freq == 0 || 
@@ -519,19 +801,7 @@ int driver(int argc, char** argv)
          std::abs(soln_time-inputs_t::final_time) < epsilon
         )  
       ) 
-    {
-      flecsi_execute_task(
-        output,
-	 			apps::hydro,
- 				index,
- 				mesh,
-	 			prefix_char,
- 				postfix_char,
- 				time_cnt,
-        soln_time,
- 				dc, uc, ec, pc, Tc, ac
-      );
-    }
+      write_solution();
 
   } // for
 
@@ -539,6 +809,12 @@ int driver(int argc, char** argv)
   // Post-process
   //===========================================================================
 
+  // complete the last output, and free the communicators of the writer
+  // groups before MPI shuts down
+  if ( has_output && field_format == output_format_t::compressed &&
+       inputs_t::field_output.aggregation.enabled() )
+    flecsi_execute_task( finish_fields, apps::hydro, index, mesh );
+
   auto tdelta = ristra::utils::get_wall_time() - tstart;
 
   if ( rank == 0 ) {
@@ -79,6 +79,27 @@ public:
 	//! \brief the equation of state
 	static eos_t eos;
 
+	//! \brief the diagnostics and probes
+	static diagnostics_inputs_t diagnostics;
+
+	//! \brief the field output format and compression
+	static field_output_inputs_t field_output;
+
+	//! \brief the in situ python analysis
+	static analysis_inputs_t analysis;
+
+	//! \brief the ambient state used to skip the regions at rest
+	static activity_inputs_t activity;
+
+	//! \brief the load balance checks
+	static load_balance_inputs_t load_balance;
+
+	//! \brief the schedule of the irregular vertex loops
+	static loop_schedule_inputs_t loop_schedule;
+
+	//! \brief if true, the fields are backed by huge pages where possible
+	static bool huge_pages;
+
 	//! \brief this is a static function to set the initial conditions
 	static ics_return_t initial_conditions(const mesh_t & mesh, size_t local_id,
 	                                       const real_t & t);
@@ -135,6 +156,41 @@ public:
     CFL.volume    = lua_try_access_as( cfl_ics, "volume",    real_t );
     CFL.growth    = lua_try_access_as( cfl_ics, "growth",    real_t );
 
+    // the diagnostics are optional
+    auto diag_input = hydro_input["diagnostics"];
+    if ( !diag_input.empty() )
+      apps::common::load_diagnostics( diag_input, diagnostics );
+
+    // the field output settings are optional
+    auto output_input = hydro_input["field_output"];
+    if ( !output_input.empty() )
+      apps::common::load_field_output( output_input, field_output );
+
+    // the python analysis is optional
+    auto analysis_input = hydro_input["analysis"];
+    if ( !analysis_input.empty() )
+      apps::common::load_analysis( analysis_input, analysis );
+
+    // the activity tracking is optional
+    auto activity_input = hydro_input["activity"];
+    if ( !activity_input.empty() )
+      apps::common::load_activity( activity_input, activity );
+
+    // the load balance checks are optional
+    auto balance_input = hydro_input["load_balance"];
+    if ( !balance_input.empty() )
+      apps::common::load_load_balance( balance_input, load_balance );
+
+    // the loop schedule is optional
+    auto schedule_input = hydro_input["loop_schedule"];
+    if ( !schedule_input.empty() )
+      apps::common::load_loop_schedule( schedule_input, loop_schedule );
+
+    // huge pages are optional, and off by default
+    auto huge_pages_input = hydro_input["huge_pages"];
+    if ( !huge_pages_input.empty() )
+      huge_pages = huge_pages_input.as<bool>();
+
 #else
 
     THROW_IMPLEMENTED_ERROR(
@@ -12,7 +12,11 @@
 // hydro includes
 #include "globals.h"
 #include "types.h"
+#include "../common/numa.h"
+#include "../common/python_hook.h"
+#include "../common/vtk_adaptor.h"
 
+#include <flecsale/io/field_file.h>
 #include <flecsi-sp/io/io_exodus.h>
 #include <flecsale/linalg/qr.h>
 #include <ristra/utils/algorithm.h>
@@ -24,6 +28,8 @@
 
 // system includes
 #include <iomanip>
+#include <limits>
+#include <memory>
 
 namespace apps {
 namespace hydro {
@@ -61,6 +67,76 @@ void update_geometry(client_handle_r<mesh_t> mesh) {
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Report where the threads of this rank run.
+//!
+//! \param [in] mesh the mesh object
+////////////////////////////////////////////////////////////////////////////////
+void report_thread_bindings( client_handle_r<mesh_t> mesh )
+{
+  auto & context = flecsi::execution::context_t::instance();
+  apps::common::print_thread_bindings( std::cout, context.color(),
+    apps::common::thread_bindings() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Touch every field in parallel before it is first written.
+//!
+//! Unlike the hydro app, the initial conditions of this app are still set
+//! in a serial loop.  Touching the fields beforehand places their pages on
+//! the sockets of the threads that update them, instead of on the socket
+//! of the thread setting the initial conditions.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] huge_pages  if true, ask for huge pages first
+////////////////////////////////////////////////////////////////////////////////
+void first_touch_fields(
+  client_handle_r<mesh_t>  mesh,
+  bool huge_pages,
+  dense_handle_w<real_t> V,
+  dense_handle_w<real_t> M,
+  dense_handle_w<vector_t> v,
+  dense_handle_w<real_t> p,
+  dense_handle_w<real_t> d,
+  dense_handle_w<real_t> e,
+  dense_handle_w<real_t> T,
+  dense_handle_w<real_t> a,
+  dense_handle_w<vector_t> v0,
+  dense_handle_w<real_t> e0,
+  dense_handle_w<flux_data_t> dudt,
+  dense_handle_w<vector_t> xn,
+  dense_handle_w<vector_t> un,
+  dense_handle_w<stored_vector_t> npc,
+  dense_handle_w<stored_vector_t> Fpc,
+  dense_handle_w<halo_state_t> H
+) {
+
+  using apps::common::first_touch;
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  first_touch( cell_list, V, huge_pages );
+  first_touch( cell_list, M, huge_pages );
+  first_touch( cell_list, v, huge_pages );
+  first_touch( cell_list, p, huge_pages );
+  first_touch( cell_list, d, huge_pages );
+  first_touch( cell_list, e, huge_pages );
+  first_touch( cell_list, T, huge_pages );
+  first_touch( cell_list, a, huge_pages );
+  first_touch( cell_list, v0, huge_pages );
+  first_touch( cell_list, e0, huge_pages );
+  first_touch( cell_list, dudt, huge_pages );
+  first_touch( cell_list, H, huge_pages );
+
+  const auto & vertex_list = mesh.vertices();
+  first_touch( vertex_list, xn, huge_pages );
+  first_touch( vertex_list, un, huge_pages );
+
+  const auto & corner_list = mesh.corners();
+  first_touch( corner_list, npc, huge_pages );
+  first_touch( corner_list, Fpc, huge_pages );
+
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief The main task for setting initial conditions
 //!
@@ -100,24 +176,178 @@ void initial_conditions(
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Build the lists of active cells and vertices.
+//!
+//! The nodal velocities and residuals of the inactive entities are never
+//! written again, so they are zeroed here.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] activity  the ambient state
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void initialize_activity(
+  client_handle_r<mesh_t>  mesh,
+  activity_inputs_t activity,
+  dense_handle_r<halo_state_t> H,
+  dense_handle_w<vector_t> un,
+  dense_handle_w<flux_data_t> dudt
+) {
+
+  using subset_t = mesh_t::subset_t;
+
+  for ( auto vt : mesh.vertices() ) un(vt) = 0;
+  for ( auto cl : mesh.cells() ) dudt(cl) = 0;
+
+  // the predictor and the corrector each spread a disturbance by one layer
+  apps::common::activity_tracker().initialize(
+    mesh, mesh.cells(flecsi::owned), mesh.vertices(subset_t::overlapping), 2,
+    [&]( auto cl ) {
+      const auto & h = H(cl);
+      return activity.is_disturbed( h.density, h.pressure, h.velocity );
+    }
+  );
+
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-//! \brief The main task for setting initial conditions
+//! \brief Grow the lists of active cells and vertices after a step.
+//!
+//! \param [in,out] mesh the mesh object
+//! \param [in] activity  the ambient state
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void update_activity(
+  client_handle_r<mesh_t>  mesh,
+  activity_inputs_t activity,
+  dense_handle_r<halo_state_t> H
+) {
+
+  apps::common::activity_tracker().update(
+    mesh,
+    [&]( auto cl ) {
+      const auto & h = H(cl);
+      return activity.is_disturbed( h.density, h.pressure, h.velocity );
+    }
+  );
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Estimate the work of this rank for one step.
+//!
+//! The nodal solve dominates and scales with the number of corners around
+//! each vertex.  Boundary vertices cost more since they look up their
+//! conditions and may grow the system with symmetry constraints.  The cell
+//! updates scale with their number of corners.  When the activity tracking
+//! is on, only the active entities count.
+//!
+//! \param [in] mesh the mesh object
+//! \param [in] balance  the load balance inputs
+//! \return the estimated cost
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_cost(
+  client_handle_r<mesh_t>  mesh,
+  load_balance_inputs_t balance
+) {
+
+  using subset_t = mesh_t::subset_t;
+
+  real_t cost = 0;
+
+  auto vertex_cost = [&]( auto vt ) {
+    auto weight = vt->is_boundary() ? balance.boundary_weight : 1;
+    cost += weight * mesh.corners(vt).size();
+  };
+  auto cell_cost = [&]( auto cl ) {
+    cost += mesh.corners(cl).size();
+  };
+
+  const auto & activity = apps::common::activity_tracker();
+  if ( activity.is_enabled() ) {
+    const auto & vs = mesh.vertices();
+    const auto & cs = mesh.cells();
+    for ( auto id : activity.vertices() ) vertex_cost( vs[id] );
+    for ( auto id : activity.cells() ) cell_cost( cs[id] );
+  }
+  else {
+    for ( auto vt : mesh.vertices( subset_t::overlapping ) ) vertex_cost( vt );
+    for ( auto cl : mesh.cells( flecsi::owned ) ) cell_cost( cl );
+  }
+
+  return cost;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Update the derived quantities needed to advance the solution
+//!
+//! The temperature is skipped, see update_temperature.
 //!
 //! \param [in,out] mesh the mesh object
 //! \return 0 for success
 ////////////////////////////////////////////////////////////////////////////////
 void update_state_from_energy( 
+  client_handle_r<mesh_t>  mesh,
+  eos_t eos,
+  dense_handle_r_owned<real_t> V,
+  dense_handle_r_owned<real_t> M,
+  dense_handle_r_owned<vector_t> v,
+  dense_handle_w_owned<real_t> p,
+  dense_handle_r_owned<real_t> d,
+  dense_handle_r_owned<real_t> e,
+  dense_handle_r_owned<real_t> T,
+  dense_handle_w_owned<real_t> a
+) {
+
+  const auto & activity = apps::common::activity_tracker();
+
+  // only the active cells change
+  if ( activity.is_enabled() ) {
+    const auto & cs = mesh.cells();
+    const auto & active = activity.cells();
+    auto num_cells = active.size();
+    #pragma omp parallel for
+    for ( counter_t i=0; i<num_cells; ++i ) {
+      auto c = cs[ active[i] ];
+      auto u = pack(c, V, M, v, p, d, e, T, a);
+      eqns_t::update_flow_state_from_energy( u, eos );
+    }
+    return;
+  }
+
+  auto cs = mesh.cells( flecsi::owned );
+  auto num_cells = cs.size();
+
+  #pragma omp parallel for
+  for ( counter_t i=0; i<num_cells; ++i ) {
+    auto c = cs[i];
+    auto u = pack(c, V, M, v, p, d, e, T, a);
+    eqns_t::update_flow_state_from_energy( u, eos );
+  }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the temperature before it is consumed.
+//!
+//! The updates only refresh the quantities needed to advance the solution,
+//! so this has to be called before anything reads the temperature.
+//!
+//! \param [in,out] mesh the mesh object
+//! \return 0 for success
+////////////////////////////////////////////////////////////////////////////////
+void update_temperature( 
   client_handle_r<mesh_t>  mesh,
   eos_t eos,
   dense_handle_r<real_t> V,
   dense_handle_r<real_t> M,
   dense_handle_r<vector_t> v,
-  dense_handle_w<real_t> p,
+  dense_handle_r<real_t> p,
   dense_handle_r<real_t> d,
   dense_handle_r<real_t> e,
   dense_handle_w<real_t> T,
-  dense_handle_w<real_t> a
+  dense_handle_r<real_t> a
 ) {
 
   auto cs = mesh.cells( flecsi::owned );
@@ -126,8 +356,37 @@ void update_state_from_energy(
   #pragma omp parallel for
   for ( counter_t i=0; i<num_cells; ++i ) {
     auto c = cs[i];
-    auto u = pack(c, V, M, v, p, d, e, T, a);
-    eqns_t::update_state_from_energy( u, eos );
+    eqns_t::update_temperature( pack(c, V, M, v, p, d, e, T, a), eos );
+  }
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Pack the state the nodal solve reads into the halo state field.
+//!
+//! Only the owned cells are written.  The nodal solve reads the ghosts of
+//! this one field, so each half step waits on a single ghost exchange
+//! instead of one per state field.
+//!
+//! \param [in] mesh the mesh object
+//! \param [out] H  the packed state
+////////////////////////////////////////////////////////////////////////////////
+void pack_halo_state( 
+  client_handle_r<mesh_t>  mesh,
+  dense_handle_r_owned<real_t> d,
+  dense_handle_r_owned<vector_t> v,
+  dense_handle_r_owned<real_t> p,
+  dense_handle_r_owned<real_t> a,
+  dense_handle_w_owned<halo_state_t> H
+) {
+
+  auto cs = mesh.cells( flecsi::owned );
+  auto num_cells = cs.size();
+
+  #pragma omp parallel for
+  for ( counter_t i=0; i<num_cells; ++i ) {
+    auto c = cs[i];
+    H(c) = halo_state_t{ d(c), v(c), p(c), a(c) };
   }
 
 }
@@ -143,33 +402,29 @@ double evaluate_time_step(
   client_handle_r<mesh_t> mesh,
   time_constants_t cfl, 
 	real_t previous_time_step,
-	dense_handle_r<real_t> sound_speed,
-	dense_handle_r<flux_data_t> dudt
+	dense_handle_r_owned<real_t> sound_speed,
+	dense_handle_r_owned<flux_data_t> dudt
 ) {
  
   // Loop over each cell, computing the minimum time step,
   // which is also the maximum 1/dt
-  real_t dt_acc_inv(0);
-  real_t dt_vol_inv(0);
+  using flecsale::utils::reproducible_max;
 
   auto cs = mesh.cells( flecsi::owned );
   auto num_cells = cs.size();
 
-  for ( counter_t i=0; i<num_cells; ++i ) {
+  // compute the inverse of the time scale
+  real_t dt_acc_inv = reproducible_max<real_t>( num_cells, [&]( size_t i ) {
     auto c = cs[i];
+    return sound_speed(c) / c->min_length();
+  } );
 
-    // compute the inverse of the time scale
-    auto dti =  sound_speed(c) / c->min_length();
-    // check for the maximum value
-    dt_acc_inv = std::max( dti, dt_acc_inv );
-
-    // now check the volume change
+  // now check the volume change
+  real_t dt_vol_inv = reproducible_max<real_t>( num_cells, [&]( size_t i ) {
+    auto c = cs[i];
     auto dVdt = eqns_t::volumetric_rate_of_change( dudt(c) );
-    dti = std::abs(dVdt) / c->volume();
-    // check for the maximum value
-    dt_vol_inv = std::max( dti, dt_vol_inv );
-
-  } // cell
+    return std::abs(dVdt) / c->volume();
+  } );
 
 
   assert( dt_acc_inv > 0 && "infinite delta t" );
@@ -197,18 +452,36 @@ double evaluate_time_step(
 ////////////////////////////////////////////////////////////////////////////////
 void estimate_nodal_state( 
   client_handle_r<mesh_t>  mesh,
-  dense_handle_r<vector_t> cell_vel,
+  loop_schedule_inputs_t schedule,
+  dense_handle_r<halo_state_t> H,
   dense_handle_w<vector_t> vertex_vel // Hack to avoid communication
 ) {
 
-  using subset_t = mesh_t::subset_t;
-  for ( auto v : mesh.vertices(subset_t::overlapping) )
-  {
+  auto estimate = [&]( auto v ) {
     vertex_vel(v) = 0.;
     const auto & cells = mesh.cells(v);
-    for ( auto c : cells ) vertex_vel(v) += cell_vel(c);
+    for ( auto c : cells ) vertex_vel(v) += H(c).velocity;
     vertex_vel(v) /= cells.size();
-  } // vertex
+  };
+
+  // the cost follows the number of cells, nothing is worth going first
+  constexpr std::size_t chunk_size = 256;
+  auto never = []( auto ) { return false; };
+  auto no_order = schedule;
+  no_order.costly_first = false;
+
+  // the inactive vertices stay at rest
+  const auto & activity = apps::common::activity_tracker();
+  if ( activity.is_enabled() ) {
+    const auto & vs = mesh.vertices();
+    apps::common::irregular_for( no_order, chunk_size, activity.vertices(),
+      never, [&]( auto id ) { estimate( vs[id] ); } );
+    return;
+  }
+
+  using subset_t = mesh_t::subset_t;
+  apps::common::irregular_for( no_order, chunk_size,
+    mesh.vertices(subset_t::overlapping), never, estimate );
 
 }
 
@@ -221,17 +494,11 @@ void estimate_nodal_state(
 void evaluate_nodal_state( 
   client_handle_r<mesh_t>  mesh,
   real_t soln_time,
-  dense_handle_r<real_t> Vc,
-  dense_handle_r<real_t> Mc,
-  dense_handle_r<vector_t> uc,
-  dense_handle_r<real_t> pc,
-  dense_handle_r<real_t> dc,
-  dense_handle_r<real_t> ec,
-  dense_handle_r<real_t> Tc,
-  dense_handle_r<real_t> ac,
+  loop_schedule_inputs_t schedule,
+  dense_handle_r<halo_state_t> H,
   dense_handle_w<vector_t> un,
-  dense_handle_w<vector_t> npc,
-  dense_handle_w<vector_t> Fpc
+  dense_handle_w<stored_vector_t> npc,
+  dense_handle_w<stored_vector_t> Fpc
 ) {
 
   // get the number of dimensions and create a matrix
@@ -244,9 +511,9 @@ void evaluate_nodal_state(
   using subset_t = mesh_t::subset_t;
 
   //----------------------------------------------------------------------------
-  // Loop over each vertex
+  // Solve for the velocity of one vertex
   //----------------------------------------------------------------------------
-  for ( auto vt : mesh.vertices( subset_t::overlapping ) ) {
+  auto solve_vertex = [&]( auto vt ) {
 
     // create the final matrix the point
     matrix_t Mp(0);
@@ -256,8 +523,11 @@ void evaluate_nodal_state(
     auto cnrs = mesh.corners(vt);
     auto num_corners = cnrs.size();
 
-    // create some corner storage
+    // create some corner storage, the forces and normals are accumulated
+    // in real_t and only stored once they are final
     std::vector< matrix_t > Mpc(num_corners, 0);
+    std::vector< vector_t > Fc(num_corners, vector_t(0));
+    std::vector< vector_t > nc(num_corners, vector_t(0));
 
     //--------------------------------------------------------------------------
     // build point matrix
@@ -266,20 +536,16 @@ void evaluate_nodal_state(
       // get the corner
       auto cn = cnrs[j];
 
-      // initialize the corner force
-      Fpc(cn) = 0;
-      npc(cn) = 0;
-
       // corner attaches to one cell and one point
       auto cl = mesh.cells(cn).front();
       // get the cell state (there is only one)
-      auto state = pack(cl, Vc, Mc, uc, pc, dc, ec, Tc, ac);
+      const auto & state = H(cl);
 
       // the corner quantities are approximated as cell ones
-      const auto & pc = eqns_t::pressure( state );
-      const auto & uc = eqns_t::velocity( state );
-      const auto & dc = eqns_t::density( state );
-      const auto & ac = eqns_t::sound_speed( state );
+      const auto & pc = state.pressure;
+      const auto & uc = state.velocity;
+      const auto & dc = state.density;
+      const auto & ac = state.sound_speed;
       // the corner impedance
       auto zc = dc * ac;
 
@@ -295,17 +561,17 @@ void evaluate_nodal_state(
         ristra::math::outer_product( n, n, Mpc[j], zc*l );
         // compute the pressure coefficient
         for ( int d=0; d<num_dims; ++d ) 
-          npc(cn)[d] += l * n[d];
+          nc[j][d] += l * n[d];
       } // wedges
 
       // add to the global matrix
       Mp += Mpc[j];
       // compute a portion of the corner force and 
       // add the pressure and velocity contributions to the system
-      ax_plus_y( Mpc[j], uc, Fpc(cn) );   
+      ax_plus_y( Mpc[j], uc, Fc[j] );   
       for ( int d=0; d<num_dims; ++d ) {
-        Fpc(cn)[d] += pc * npc(cn)[d];
-        rhs[d] += Fpc(cn)[d];
+        Fc[j][d] += pc * nc[j][d];
+        rhs[d] += Fc[j][d];
       }
 
     } // corner
@@ -332,7 +598,7 @@ void evaluate_nodal_state(
       if ( vel_bc != point_tags.end() ) {
 	      auto bc = flecsi_get_global_object(*vel_bc, boundaries, boundary_condition_t);
 	      un(vt) = bc->velocity(vt->coordinates(), soln_time);
-	      continue;
+	      return;
       }
 
       // otherwise, apply the pressure conditions
@@ -442,14 +708,38 @@ void evaluate_nodal_state(
       // now add the vertex component to the force
       matrix_vector( 
         static_cast<real_t>(-1), Mpc[j], un(vt), 
-        static_cast<real_t>(1), Fpc(cn)
+        static_cast<real_t>(1), Fc[j]
       );
 
+      // store the final corner quantities
+      Fpc(cn) = apps::common::precision_cast<stored_vector_t>( Fc[j] );
+      npc(cn) = apps::common::precision_cast<stored_vector_t>( nc[j] );
+
     }
 
-  } // vertex
+  }; // vertex
   //----------------------------------------------------------------------------
 
+  // each vertex only writes its own velocity and corners, so the vertices
+  // can be solved in any order.  The boundary vertices walk their wedges
+  // and may need a QR solve, so they cost several times an interior one.
+  constexpr std::size_t chunk_size = 16;
+
+  // the inactive vertices stay at rest
+  const auto & activity = apps::common::activity_tracker();
+  if ( activity.is_enabled() ) {
+    const auto & vs = mesh.vertices();
+    apps::common::irregular_for( schedule, chunk_size, activity.vertices(),
+      [&]( auto id ) { return vs[id]->is_boundary(); },
+      [&]( auto id ) { solve_vertex( vs[id] ); } );
+  }
+  else {
+    apps::common::irregular_for( schedule, chunk_size,
+      mesh.vertices( subset_t::overlapping ),
+      []( auto vt ) { return vt->is_boundary(); },
+      solve_vertex );
+  }
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -461,30 +751,47 @@ void evaluate_nodal_state(
 void evaluate_residual( 
   client_handle_r<mesh_t>  mesh,
   dense_handle_r<vector_t> uv,
-  dense_handle_r<vector_t> npc,
-  dense_handle_r<vector_t> Fpc,
-  dense_handle_w<flux_data_t> dudt // hack so no communication occurs
+  dense_handle_r<stored_vector_t> npc,
+  dense_handle_r<stored_vector_t> Fpc,
+  dense_handle_w_owned<flux_data_t> dudt
 )
 {
 
   // TASK: loop over each cell and compute the residual
 
-  for ( auto cl : mesh.cells(flecsi::owned) ) {
+  auto compute_residual = [&]( auto cl ) {
     
     // Gather corner forces to compute the cell residual
 
     // local cell residual
-    dudt(cl) = 0;
+    flux_data_t res(0);
 
     // compute subcell forces
     for ( auto cn : mesh.corners(cl) ) {
       // corner attaches to one point and zone
       auto pt = mesh.vertices(cn).front();
       // add contribution
-      eqns_t::compute_update( uv(pt), Fpc(cn), npc(cn), dudt(cl) );
+      eqns_t::compute_update(
+        uv(pt),
+        apps::common::precision_cast<vector_t>( Fpc(cn) ),
+        apps::common::precision_cast<vector_t>( npc(cn) ),
+        res
+      );
     }// corners    
+
+    dudt(cl) = res;
     
-  } // cell
+  }; // cell
+
+  // the residual of an inactive cell stays zero
+  const auto & activity = apps::common::activity_tracker();
+  if ( activity.is_enabled() ) {
+    const auto & cs = mesh.cells();
+    for ( auto id : activity.cells() ) compute_residual( cs[id] );
+  }
+  else {
+    for ( auto cl : mesh.cells(flecsi::owned) ) compute_residual( cl );
+  }
     
 }
 
@@ -499,15 +806,15 @@ void apply_update(
   real_t delta_t,
   dense_handle_r<vector_t> xn,
   dense_handle_r<vector_t> vn,
-  dense_handle_r<flux_data_t> dudt,
-  dense_handle_w<real_t> Vc,
-  dense_handle_r<real_t> Mc,
-  dense_handle_w<vector_t> uc,
-  dense_handle_r<real_t> pc,
-  dense_handle_w<real_t> dc,
-  dense_handle_w<real_t> ec,
-  dense_handle_r<real_t> Tc,
-  dense_handle_r<real_t> ac
+  dense_handle_r_owned<flux_data_t> dudt,
+  dense_handle_w_owned<real_t> Vc,
+  dense_handle_r_owned<real_t> Mc,
+  dense_handle_w_owned<vector_t> uc,
+  dense_handle_r_owned<real_t> pc,
+  dense_handle_w_owned<real_t> dc,
+  dense_handle_w_owned<real_t> ec,
+  dense_handle_r_owned<real_t> Tc,
+  dense_handle_r_owned<real_t> ac
 ) {
 
   //----------------------------------------------------------------------------
@@ -519,13 +826,24 @@ void apply_update(
   constexpr auto num_dims = mesh_t::num_dimensions;
   auto do_step = delta_t > flecsale::config::test_tolerance;
 
+  // only the active entities move or change
+  const auto & activity = apps::common::activity_tracker();
+
+  auto move_vertex = [&]( auto vt ) {
+    const auto & vn_ = vn(vt);
+    const auto & xn_ = xn(vt);
+    for ( int d=0; d<num_dims; ++d )
+      vt->coordinates()[d] = xn_[d] + delta_t * vn_[d];
+  };
+
   if ( do_step ) {
 
-    for ( auto vt : mesh.vertices() ) {
-      const auto & vn_ = vn(vt);
-      const auto & xn_ = xn(vt);
-      for ( int d=0; d<num_dims; ++d )
-        vt->coordinates()[d] = xn_[d] + delta_t * vn_[d];
+    if ( activity.is_enabled() ) {
+      const auto & vs = mesh.vertices();
+      for ( auto id : activity.all_vertices() ) move_vertex( vs[id] );
+    }
+    else {
+      for ( auto vt : mesh.vertices() ) move_vertex( vt );
     }
 
     // now update the geometry
@@ -534,7 +852,7 @@ void apply_update(
   }
 
   // Using the cell residual, update the state
-  for ( auto cl : mesh.cells(flecsi::owned) ) {
+  auto update_cell = [&]( auto cl ) {
 
     // get the cell state
     auto u = pack(cl, Vc, Mc, uc, pc, dc, ec, Tc, ac);
@@ -543,7 +861,15 @@ void apply_update(
     eqns_t::update_state_from_flux( u, dudt(cl), delta_t );
     eqns_t::update_volume( u, cl->volume() );
 
-  } // for
+  };
+
+  if ( activity.is_enabled() ) {
+    const auto & cs = mesh.cells();
+    for ( auto id : activity.cells() ) update_cell( cs[id] );
+  }
+  else {
+    for ( auto cl : mesh.cells(flecsi::owned) ) update_cell( cl );
+  }
 
 }
 
@@ -605,15 +931,15 @@ void restore_coordinates(
 ////////////////////////////////////////////////////////////////////////////////
 void save_solution( 
   client_handle_r<mesh_t>  mesh,
-  dense_handle_r<vector_t> cell_vel,
-	dense_handle_r<real_t> cell_ener,
-	dense_handle_w<vector_t> cell_vel_0, // "r" permissions hack to avoid communication
-	dense_handle_w<real_t> cell_ener_0   // "r" permissions hack to avoid communication
+  dense_handle_r_owned<vector_t> cell_vel,
+	dense_handle_r_owned<real_t> cell_ener,
+	dense_handle_w_owned<vector_t> cell_vel_0,
+	dense_handle_w_owned<real_t> cell_ener_0
 )
 {
 
-  // Loop over cells
-  auto cs = mesh.cells();
+  // Loop over cells, the ghosts are never read from these fields
+  auto cs = mesh.cells( flecsi::owned );
   auto num_cells = cs.size();
 
   #pragma omp parallel for
@@ -633,15 +959,15 @@ void save_solution(
 ////////////////////////////////////////////////////////////////////////////////
 void restore_solution( 
   client_handle_r<mesh_t>  mesh,
-	dense_handle_r<vector_t> cell_vel_0,
-  dense_handle_w<vector_t> cell_vel,
-	dense_handle_r<real_t> cell_ener_0,
-	dense_handle_w<real_t> cell_ener
+	dense_handle_r_owned<vector_t> cell_vel_0,
+  dense_handle_w_owned<vector_t> cell_vel,
+	dense_handle_r_owned<real_t> cell_ener_0,
+	dense_handle_w_owned<real_t> cell_ener
 )
 {
 
   // Loop over cells
-  auto cs = mesh.cells();
+  auto cs = mesh.cells( flecsi::owned );
   auto num_cells = cs.size();
 
   #pragma omp parallel for
@@ -655,6 +981,195 @@ void restore_solution(
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Compute the local contribution to a global diagnostic.
+//!
+//! The caller is responsible for reducing the result with the operator
+//! that matches the quantity (sum, min or max).  The sums are evaluated in
+//! stages so they do not depend on the number of ranks, see
+//! apps::common::global_sum.
+//!
+//! \param [in] mesh       the mesh object
+//! \param [in] quantity   the quantity to compute
+//! \param [in] component  the vector component for vector quantities
+//! \param [in] origin     the origin used to measure the shock radius
+//! \param [in] shock_pressure  the pressure that marks a shocked cell
+//! \param [in] request    the stage of a sum
+//! \return the local value of the quantity
+////////////////////////////////////////////////////////////////////////////////
+real_t evaluate_diagnostic(
+  client_handle_r<mesh_t> mesh,
+  diagnostic_t quantity,
+  size_t component,
+  vector_t origin,
+  real_t shock_pressure,
+  sum_request_t request,
+  dense_handle_r<real_t> Mc,
+  dense_handle_r<vector_t> uc,
+  dense_handle_r<real_t> pc,
+  dense_handle_r<real_t> dc,
+  dense_handle_r<real_t> ec
+) {
+
+  using flecsale::utils::reproducible_max;
+  using flecsale::utils::reproducible_min;
+
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  auto num_cells = cell_list.size();
+
+  // the integrals are sums over the cells
+  auto integrand = [&]( size_t i ) -> real_t {
+    const auto & c = cell_list[i];
+    switch (quantity) {
+      case diagnostic_t::mass:
+        return Mc(c);
+      case diagnostic_t::momentum:
+        return Mc(c) * uc(c)[component];
+      default:
+        return Mc(c) * 
+          ( ec(c) + 0.5 * ristra::math::dot_product( uc(c), uc(c) ) );
+    }
+  };
+
+  switch (quantity) {
+    case diagnostic_t::mass:
+    case diagnostic_t::momentum:
+    case diagnostic_t::total_energy:
+      return apps::common::local_sum( request, num_cells, integrand );
+    case diagnostic_t::min_density:
+      return reproducible_min<real_t>( num_cells,
+        [&]( size_t i ) { return dc( cell_list[i] ); } );
+    case diagnostic_t::max_density:
+      return reproducible_max<real_t>( num_cells,
+        [&]( size_t i ) { return dc( cell_list[i] ); } );
+    case diagnostic_t::min_pressure:
+      return reproducible_min<real_t>( num_cells,
+        [&]( size_t i ) { return pc( cell_list[i] ); } );
+    case diagnostic_t::max_pressure:
+      return reproducible_max<real_t>( num_cells,
+        [&]( size_t i ) { return pc( cell_list[i] ); } );
+    case diagnostic_t::shock_radius:
+      return std::max<real_t>( 0, reproducible_max<real_t>( num_cells,
+        [&]( size_t i ) -> real_t {
+          const auto & c = cell_list[i];
+          if ( pc(c) <= shock_pressure ) return 0;
+          return ristra::math::magnitude( c->centroid() - origin );
+        } ) );
+    default:
+      return apps::common::diagnostic_identity<real_t>( quantity );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Sample a field at a probe location.
+//!
+//! A probe is attached to the owned cell with the nearest centroid.  Since
+//! the mesh moves, the owner is searched for every time.  When asked for the
+//! distance, the distance to that cell is returned so that a min-reduction
+//! finds the owning rank.  When asked for a value, only the owning rank
+//! returns the value, all other ranks return the lowest real so that a
+//! max-reduction selects it.
+//!
+//! \param [in] mesh       the mesh object
+//! \param [in] quantity   the quantity to sample
+//! \param [in] component  the vector component for vector quantities
+//! \param [in] x          the probe location
+//! \param [in] distance   the global distance to the nearest cell
+//! \return the sampled value
+////////////////////////////////////////////////////////////////////////////////
+real_t sample_probe(
+  client_handle_r<mesh_t> mesh,
+  probe_t quantity,
+  size_t component,
+  vector_t x,
+  real_t distance,
+  dense_handle_r<vector_t> uc,
+  dense_handle_r<real_t> pc,
+  dense_handle_r<real_t> dc
+) {
+
+  // a rank without cells is never the nearest, and returns the identity
+  // of both reductions
+  const auto & cell_list = mesh.cells( flecsi::owned );
+  if ( cell_list.size() == 0 )
+    return quantity == probe_t::distance ?
+      std::numeric_limits<real_t>::max() :
+      std::numeric_limits<real_t>::lowest();
+
+  // find the nearest owned cell
+  auto min_dist = std::numeric_limits<real_t>::max();
+  auto nearest = cell_list.front();
+
+  for ( auto c : cell_list ) {
+    auto dist = ristra::math::magnitude( c->centroid() - x );
+    if ( dist < min_dist ) {
+      min_dist = dist;
+      nearest = c;
+    }
+  }
+
+  if ( quantity == probe_t::distance )
+    return min_dist;
+
+  // another rank owns this probe
+  if ( min_dist > distance )
+    return std::numeric_limits<real_t>::lowest();
+
+  switch (quantity) {
+    case probe_t::density:
+      return dc(nearest);
+    case probe_t::pressure:
+      return pc(nearest);
+    case probe_t::velocity:
+      return uc(nearest)[component];
+    default:
+      return std::numeric_limits<real_t>::lowest();
+  }
+
+}
+
+#ifdef FLECSALE_ENABLE_PYTHON
+////////////////////////////////////////////////////////////////////////////////
+/// \brief hand the solution to the python analysis
+///
+/// The owned values are exposed as read-only numpy arrays over the solver
+/// storage, so nothing is copied unless the storage is not strided.
+////////////////////////////////////////////////////////////////////////////////
+void python_analysis( 
+  client_handle_r<mesh_t> mesh, 
+  size_t iteration,
+  real_t time,
+  dense_handle_r<real_t> d,
+  dense_handle_r<vector_t> v,
+  dense_handle_r<real_t> p
+) {
+  clog(info) << "PYTHON ANALYSIS TASK" << std::endl;
+
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+  auto size = context.colors();
+
+  auto & hook = apps::common::python_hook( inputs_t::analysis );
+
+  auto cells = mesh.cells(flecsi::owned);
+  auto verts = mesh.vertices(flecsi::owned);
+
+  hook.add_field<real_t>( "density", cells,
+    [&](auto c) -> decltype(auto) { return d(c); } );
+  hook.add_field<real_t>( "velocity", cells,
+    [&](auto c) -> decltype(auto) { return v(c); } );
+  hook.add_field<real_t>( "pressure", cells,
+    [&](auto c) -> decltype(auto) { return p(c); } );
+  hook.add_field<real_t>( "centroid", cells,
+    [](auto c) -> decltype(auto) { return c->centroid(); } );
+  hook.add_field<real_t>( "coordinates", verts,
+    [](auto vt) -> decltype(auto) { return vt->coordinates(); } );
+
+  hook.call( iteration, time, rank, size );
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief output the solution
 ////////////////////////////////////////////////////////////////////////////////
@@ -691,6 +1206,188 @@ void output(
   );
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// \brief output the solution as compressed fields
+///
+/// Only the owned cells are written, and each field is compressed with the
+/// settings chosen for it in the input file.  When the output is aggregated,
+/// the fields are only posted to this rank's writer, and the solver goes on
+/// while they are sent.  wait_fields completes them, and the writer writes
+/// the file then.  The writers talk over MPI, so this runs as an MPI task,
+/// one point per rank and all of them at once.
+////////////////////////////////////////////////////////////////////////////////
+void write_fields( 
+  client_handle_r<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t iteration,
+  real_t time,
+  dense_handle_r<real_t> d,
+  dense_handle_r<vector_t> v,
+  dense_handle_r<real_t> e,
+  dense_handle_r<real_t> p,
+  dense_handle_r<real_t> T,
+  dense_handle_r<real_t> a
+) {
+  clog(info) << "WRITE FIELDS TASK" << std::endl;
+ 
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  constexpr auto num_dims = mesh_t::num_dimensions;
+  const auto & settings = inputs_t::field_output;
+
+  // gather the owned values of each field and compress them
+  flecsale::io::field_records_t records;
+  std::vector<real_t> values;
+
+  auto write_scalar = [&]( const std::string & name, const auto & f ) {
+    values.clear();
+    for ( auto c : mesh.cells(flecsi::owned) ) values.emplace_back( f(c) );
+    records.write( name, values.data(), values.size(), 1, settings.codec(name) );
+  };
+
+  write_scalar( "density", d );
+  write_scalar( "internal_energy", e );
+  write_scalar( "pressure", p );
+  write_scalar( "temperature", T );
+  write_scalar( "sound_speed", a );
+
+  values.clear();
+  for ( auto c : mesh.cells(flecsi::owned) )
+    for ( auto x : v(c) ) values.emplace_back( x );
+  records.write( "velocity", values.data(), values.size(), num_dims,
+    settings.codec("velocity") );
+
+  // one file per rank
+  if ( !settings.aggregation.enabled() ) {
+    auto output_filename = 
+      prefix.str() + "_rank" + apps::common::zero_padded(rank) +
+      "_" + apps::common::zero_padded(iteration) + ".flz";
+    flecsale::io::field_file_writer_t file( output_filename, iteration, time );
+    file.write_records( records );
+    return;
+  }
+
+  // or one file per writer, indexed by global id
+  auto & aggregator = apps::common::field_aggregator();
+  if ( !aggregator )
+    aggregator = std::make_unique<flecsale::io::aggregator_t>(
+      MPI_COMM_WORLD, settings.aggregation
+    );
+
+  const auto & cell_lid_to_gid =
+    context.index_map( mesh_t::index_spaces_t::cells );
+  std::vector<std::uint64_t> ids;
+  for ( auto c : mesh.cells(flecsi::owned) )
+    ids.emplace_back( cell_lid_to_gid.at(c.id()) );
+
+  auto output_filename = 
+    prefix.str() + "_writer" + 
+    apps::common::zero_padded(aggregator->writer_rank()) +
+    "_" + apps::common::zero_padded(iteration) + ".flz";
+  // the last output was waited on, so nothing else is in flight
+  apps::common::pending_field_write() =
+    aggregator->post( output_filename, iteration, time, ids, records );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief complete the aggregated output posted by write_fields
+////////////////////////////////////////////////////////////////////////////////
+void wait_fields( client_handle_r<mesh_t> mesh ) 
+{
+  apps::common::pending_field_write().wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief complete the last output, and release the writer groups before
+///        MPI shuts down
+////////////////////////////////////////////////////////////////////////////////
+void finish_fields( client_handle_r<mesh_t> mesh ) 
+{
+  apps::common::pending_field_write().wait();
+  auto & aggregator = apps::common::field_aggregator();
+  if ( aggregator ) aggregator.reset();
+}
+
+#ifdef FLECSALE_ENABLE_VTK
+////////////////////////////////////////////////////////////////////////////////
+/// \brief refresh the vtk view of the solution
+///
+/// The topology is only built on the first call, and the points are refreshed
+/// on later calls since the mesh moves every step.  The cell fields are
+/// copied into the grid every call, so it can be used once the task is done.
+////////////////////////////////////////////////////////////////////////////////
+void update_vtk( 
+  client_handle_r<mesh_t> mesh, 
+  real_t time,
+  dense_handle_r<real_t> d,
+  dense_handle_r<vector_t> v,
+  dense_handle_r<real_t> e,
+  dense_handle_r<real_t> p,
+  dense_handle_r<real_t> T,
+  dense_handle_r<real_t> a
+) {
+  auto & adaptor = 
+    apps::common::vtk_adaptor<real_t, mesh_t::num_dimensions>();
+
+  if ( !adaptor.has_topology() )
+    adaptor.build_topology( mesh );
+  else
+    adaptor.update_points( mesh );
+
+  auto cells = mesh.cells(flecsi::owned);
+
+  adaptor.add_cell_field( "density", cells,
+    [&](auto c) -> decltype(auto) { return d(c); } );
+  adaptor.add_cell_field( "velocity", cells,
+    [&](auto c) -> decltype(auto) { return v(c); } );
+  adaptor.add_cell_field( "internal_energy", cells,
+    [&](auto c) -> decltype(auto) { return e(c); } );
+  adaptor.add_cell_field( "pressure", cells,
+    [&](auto c) -> decltype(auto) { return p(c); } );
+  adaptor.add_cell_field( "temperature", cells,
+    [&](auto c) -> decltype(auto) { return T(c); } );
+  adaptor.add_cell_field( "sound_speed", cells,
+    [&](auto c) -> decltype(auto) { return a(c); } );
+
+  adaptor.set_time( time );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief output the solution to a vtk unstructured grid file
+////////////////////////////////////////////////////////////////////////////////
+void write_vtu( 
+  client_handle_r<mesh_t> mesh, 
+  char_array_t prefix,
+  size_t iteration,
+  real_t time,
+  dense_handle_r<real_t> d,
+  dense_handle_r<vector_t> v,
+  dense_handle_r<real_t> e,
+  dense_handle_r<real_t> p,
+  dense_handle_r<real_t> T,
+  dense_handle_r<real_t> a
+) {
+  clog(info) << "WRITE VTU TASK" << std::endl;
+ 
+  // get the context
+  auto & context = flecsi::execution::context_t::instance();
+  auto rank = context.color();
+
+  update_vtk( mesh, time, d, v, e, p, T, a );
+
+  // figure out this ranks file name
+  auto output_filename = 
+    prefix.str() + "_rank" + apps::common::zero_padded(rank) +
+    "_" + apps::common::zero_padded(iteration) + ".vtu";
+
+  apps::common::vtk_adaptor<real_t, mesh_t::num_dimensions>().write( 
+    output_filename
+  );
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief output the solution
 ////////////////////////////////////////////////////////////////////////////////
@@ -812,7 +1509,12 @@ void dump(
 
 flecsi_register_task(validate_mesh, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(update_geometry, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(report_thread_bindings, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(first_touch_fields, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(initial_conditions, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(initialize_activity, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(update_activity, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_cost, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(install_boundary, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(estimate_nodal_state, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(evaluate_nodal_state, apps::hydro, loc, index|flecsi::leaf);
@@ -820,11 +1522,25 @@ flecsi_register_task(evaluate_residual, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(evaluate_time_step, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(apply_update, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(update_state_from_energy, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(update_temperature, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(pack_halo_state, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(save_coordinates, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(restore_coordinates, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(save_solution, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(restore_solution, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(evaluate_diagnostic, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(sample_probe, apps::hydro, loc, index|flecsi::leaf);
+#ifdef FLECSALE_ENABLE_PYTHON
+flecsi_register_task(python_analysis, apps::hydro, loc, index|flecsi::leaf);
+#endif
 flecsi_register_task(output, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(write_fields, apps::hydro, mpi, index);
+flecsi_register_task(wait_fields, apps::hydro, mpi, index);
+flecsi_register_task(finish_fields, apps::hydro, mpi, index);
+#ifdef FLECSALE_ENABLE_VTK
+flecsi_register_task(update_vtk, apps::hydro, loc, index|flecsi::leaf);
+flecsi_register_task(write_vtu, apps::hydro, loc, index|flecsi::leaf);
+#endif
 flecsi_register_task(print, apps::hydro, loc, index|flecsi::leaf);
 flecsi_register_task(dump, apps::hydro, loc, index|flecsi::leaf);
 
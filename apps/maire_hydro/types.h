@@ -21,6 +21,14 @@
 #include <flecsi-sp/utils/types.h>
 #include <flecsi-sp/burton/burton_mesh.h>
 
+#include "../common/activity.h"
+#include "../common/analysis.h"
+#include "../common/diagnostics.h"
+#include "../common/field_output.h"
+#include "../common/global_sum.h"
+#include "../common/load_balance.h"
+#include "../common/loop_schedule.h"
+#include "../common/precision.h"
 #include "../common/utils.h"
 
 namespace apps {
@@ -41,6 +49,28 @@ using matrix = ristra::math::matrix< real_t, N, N >;
 
 using flux_data_t = eqns_t::flux_data_t;
 
+//! the types the bulk fields are stored as, these are single precision in
+//! mixed precision builds while the arithmetic stays in real_t
+//! \{
+using stored_real_t = apps::common::stored_t<real_t>;
+using stored_vector_t = apps::common::stored_t<vector_t>;
+using stored_flux_data_t = apps::common::stored_t<flux_data_t>;
+//! \}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The part of the cell state the nodal solve reads.
+//!
+//! The nodal solve is the only task in a step that reads ghost cells.  With
+//! its state packed into one field, each half step exchanges that one field
+//! instead of every state field.
+////////////////////////////////////////////////////////////////////////////////
+struct halo_state_t {
+  real_t density;
+  vector_t velocity;
+  real_t pressure;
+  real_t sound_speed;
+};
+
 
 // explicitly use some other stuff
 using std::cout;
@@ -58,6 +88,18 @@ using dense_handle_rw = flecsi_sp::utils::dense_handle_rw<T>;
 template<typename T>
 using dense_handle_r = flecsi_sp::utils::dense_handle_r<T>;
 
+//! access to the owned entities only, a task that only uses these for the
+//! fields with ghosts does not wait for the ghost exchange
+//! \{
+template<typename T>
+using dense_handle_r_owned =
+  flecsi::dense_accessor<T, flecsi::ro, flecsi::ro, flecsi::na>;
+
+template<typename T>
+using dense_handle_w_owned =
+  flecsi::dense_accessor<T, flecsi::wo, flecsi::wo, flecsi::na>;
+//! \}
+
 template<typename DC>
 using client_handle_w = flecsi_sp::utils::client_handle_w<DC>;
 
@@ -81,6 +123,34 @@ enum class mode_t
 //! a trivially copyable character array
 using char_array_t = flecsi_sp::utils::char_array_t;
 
+//! the diagnostics types
+//! \{
+using diagnostic_t = apps::common::diagnostic_t;
+using probe_t = apps::common::probe_t;
+using diagnostics_inputs_t = apps::common::diagnostics_inputs_u<real_t, vector_t>;
+//! \}
+
+//! the field output types
+//! \{
+using output_format_t = apps::common::output_format_t;
+using field_output_inputs_t = apps::common::field_output_inputs_t;
+//! \}
+
+//! the python analysis inputs
+using analysis_inputs_t = apps::common::analysis_inputs_t;
+
+//! the activity tracking inputs
+using activity_inputs_t = apps::common::activity_inputs_t;
+
+//! the load balance inputs
+using load_balance_inputs_t = apps::common::load_balance_inputs_t;
+
+//! the loop schedule inputs
+using loop_schedule_inputs_t = apps::common::loop_schedule_inputs_t;
+
+//! a stage of a global sum
+using sum_request_t = apps::common::sum_request_t;
+
 ////////////////////////////////////////////////////////////////////////////////
 //! \brief A general boundary condition type.
 //! \tparam N  The number of dimensions.
@@ -139,7 +139,19 @@ endif()
 # double or single precision
 set( FLECSALE_DOUBLE_PRECISION ${FLECSI_SP_DOUBLE_PRECISION} CACHE BOOL "" FORCE)
 
-if ( FLECSALE_DOUBLE_PRECISION )
+# store the bulk fields in single precision
+option( FLECSALE_MIXED_PRECISION
+  "Store the bulk fields in single precision, but compute in double" OFF )
+
+if ( FLECSALE_MIXED_PRECISION AND NOT FLECSALE_DOUBLE_PRECISION )
+  message(FATAL_ERROR "Mixed precision requires a double precision build.")
+endif()
+
+if ( FLECSALE_MIXED_PRECISION )
+  message(STATUS "Note: Mixed precision build activated.")
+  # the regression results only match the gold files to float round off
+  set( FLECSALE_TEST_TOLERANCE 1.0e-5 CACHE STRING "The testing tolerance" )
+elseif ( FLECSALE_DOUBLE_PRECISION )
   message(STATUS "Note: Double precision build activated.")
   set( FLECSALE_TEST_TOLERANCE 1.0e-14 CACHE STRING "The testing tolerance" )
 else()
@@ -147,6 +159,14 @@ else()
   set( FLECSALE_TEST_TOLERANCE 1.0e-6 CACHE STRING "The testing tolerance" )
 endif()
 
+# the ensemble fields hold this many members in every cell
+set( FLECSALE_ENSEMBLE_WIDTH 8 CACHE STRING
+  "The most ensemble members one run holds" )
+
+if ( NOT FLECSALE_ENSEMBLE_WIDTH GREATER 0 )
+  message(FATAL_ERROR "The ensemble width must be positive.")
+endif()
+
 
 # size of integer ids to use
 set( FLECSALE_USE_64BIT_IDS ${FLECSI_SP_USE_64BIT_IDS} CACHE BOOL "" FORCE )
@@ -198,6 +218,19 @@ if (FLECSALE_ENABLE_PYTHON)
    message (STATUS "Found PythonLibs: ${PYTHON_INCLUDE_DIRS}")
    include_directories( ${PYTHON_INCLUDE_DIRS} )
    list( APPEND FLECSALE_LIBRARIES ${PYTHON_LIBRARIES} )
+
+   # the in situ analysis hands fields to python as numpy arrays
+   execute_process(
+     COMMAND ${PYTHON_EXECUTABLE} -c "import numpy; print(numpy.get_include())"
+     OUTPUT_VARIABLE NUMPY_INCLUDE_DIR
+     OUTPUT_STRIP_TRAILING_WHITESPACE
+     RESULT_VARIABLE NUMPY_NOT_FOUND
+   )
+   if (NUMPY_NOT_FOUND)
+     message(FATAL_ERROR "Python requested, but numpy was not found")
+   endif()
+   message (STATUS "Found NumPy: ${NUMPY_INCLUDE_DIR}")
+   include_directories( ${NUMPY_INCLUDE_DIR} )
 endif ()
 
 # find lua for embedding
@@ -0,0 +1,220 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Building blocks for cell-based adaptive refinement of quad and
+///        hex meshes.
+///
+/// A refined cell is split into 2^D children of equal volume.  Cells are
+/// flagged from a jump indicator, the flags are made consistent with a 2:1
+/// level balance between neighbors and with the coarsening of whole sibling
+/// groups, and the state is moved between levels with operators that
+/// conserve the volume integral.
+///
+/// A coarse cell next to finer ones sees each of their faces as a separate
+/// hanging face, so summing the fluxes of its faces stays conservative.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace flecsale {
+namespace amr {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief What to do with a cell.
+////////////////////////////////////////////////////////////////////////////////
+enum class refinement_t : signed char {
+  //! merge the cell with its siblings
+  coarsen = -1,
+  //! leave the cell alone
+  keep = 0,
+  //! split the cell into its children
+  refine = 1
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The normalized jump between two cell values.
+//!
+//! The result is in [0,1], so one threshold works for any variable and any
+//! scaling of it.  Using the pressure or density picks out shocks and
+//! contacts.
+//!
+//! \param [in] a,b  The two cell values.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+T jump_indicator( T a, T b )
+{
+  auto den = std::abs(a) + std::abs(b);
+  if ( den <= std::numeric_limits<T>::min() ) return 0;
+  return std::abs( a - b ) / den;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Flag one cell from its indicator.
+//!
+//! \param [in] indicator  The largest jump to a neighbor.
+//! \param [in] level  The refinement level of the cell, zero is the base mesh.
+//! \param [in] max_level  The finest level allowed.
+//! \param [in] refine_threshold  Cells above this are refined.
+//! \param [in] coarsen_threshold  Cells below this are coarsened.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+refinement_t mark(
+  T indicator, std::size_t level, std::size_t max_level,
+  T refine_threshold, T coarsen_threshold
+) {
+  if ( indicator > refine_threshold && level < max_level )
+    return refinement_t::refine;
+  if ( indicator < coarsen_threshold && level > 0 )
+    return refinement_t::coarsen;
+  return refinement_t::keep;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Only coarsen a sibling group if all of its members agree.
+//!
+//! \param [in] siblings  The cells of each group of siblings.
+//! \param [in,out] flags  The flags of all cells.
+//! \return the number of flags that were changed
+////////////////////////////////////////////////////////////////////////////////
+template< typename S >
+std::size_t consolidate_coarsening(
+  const S & siblings, std::vector<refinement_t> & flags
+) {
+  std::size_t num_changed = 0;
+  for ( const auto & group : siblings ) {
+    auto all = std::all_of( group.begin(), group.end(),
+      [&]( auto i ) { return flags[i] == refinement_t::coarsen; } );
+    if ( all ) continue;
+    for ( auto i : group )
+      if ( flags[i] == refinement_t::coarsen ) {
+        flags[i] = refinement_t::keep;
+        ++num_changed;
+      }
+  }
+  return num_changed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Adjust the flags so neighbors differ by at most one level.
+//!
+//! Refinement wins over coarsening: a coarse neighbor of a cell that ends
+//! up two levels finer is refined, and a cell may not coarsen away from a
+//! neighbor that is already one level finer.  The flags are swept until
+//! nothing changes.
+//!
+//! \param [in] levels  The current level of each cell.
+//! \param [in] neighbors  The face neighbors of each cell.
+//! \param [in] max_level  The finest level allowed.
+//! \param [in,out] flags  The flags of all cells.
+//! \return the number of flags that were changed
+////////////////////////////////////////////////////////////////////////////////
+template< typename L, typename N >
+std::size_t balance(
+  const L & levels, const N & neighbors, std::size_t max_level,
+  std::vector<refinement_t> & flags
+) {
+  auto target = [&]( std::size_t i ) {
+    return static_cast<long>( levels[i] ) + static_cast<long>( flags[i] );
+  };
+
+  std::size_t num_changed = 0;
+  bool changed = true;
+  while ( changed ) {
+    changed = false;
+    for ( std::size_t i=0; i<flags.size(); ++i ) {
+      for ( auto j : neighbors[i] ) {
+        if ( target(j) <= target(i) + 1 ) continue;
+        // raise this cell by one step towards its neighbor
+        if ( flags[i] == refinement_t::coarsen )
+          flags[i] = refinement_t::keep;
+        else if ( flags[i] == refinement_t::keep && levels[i] < max_level )
+          flags[i] = refinement_t::refine;
+        else
+          continue;
+        ++num_changed;
+        changed = true;
+      }
+    }
+  }
+  return num_changed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Fill the children of a refined cell.
+//!
+//! The state is reconstructed linearly from the parent with the given
+//! (limited) gradients, and the mean is then corrected so the volume
+//! integral over the children matches the parent exactly.
+//!
+//! \param [in] parent  The parent state, an array of variables.
+//! \param [in] grad  The gradients, grad[k][d] is the derivative of
+//!                   variable k in direction d.
+//! \param [in] offsets  The offset of each child centroid from the parent
+//!                      centroid.
+//! \param [in] volumes  The volume of each child.
+//! \param [out] children  The state of each child.
+////////////////////////////////////////////////////////////////////////////////
+template< typename U, typename G, typename X, typename V >
+void prolong(
+  const U & parent, const G & grad, const std::vector<X> & offsets,
+  const std::vector<V> & volumes, std::vector<U> & children
+) {
+  auto num_children = offsets.size();
+  auto num_vars = parent.size();
+  children.assign( num_children, parent );
+
+  V total_volume(0);
+  for ( auto vol : volumes ) total_volume += vol;
+
+  for ( std::size_t k=0; k<num_vars; ++k ) {
+    // the linear reconstruction
+    V integral(0);
+    for ( std::size_t i=0; i<num_children; ++i ) {
+      const auto & dx = offsets[i];
+      for ( std::size_t d=0; d<dx.size(); ++d )
+        children[i][k] += grad[k][d] * dx[d];
+      integral += children[i][k] * volumes[i];
+    }
+    // remove the error in the mean
+    auto shift = parent[k] - integral / total_volume;
+    for ( std::size_t i=0; i<num_children; ++i ) children[i][k] += shift;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Merge the children of a coarsened cell.
+//!
+//! \param [in] children  The state of each child.
+//! \param [in] volumes  The volume of each child.
+//! \return the volume average of the children
+////////////////////////////////////////////////////////////////////////////////
+template< typename U, typename V >
+U restrict_state( const std::vector<U> & children, const std::vector<V> & volumes )
+{
+  U parent = children.front();
+  V total_volume(0);
+  for ( auto vol : volumes ) total_volume += vol;
+
+  for ( std::size_t k=0; k<parent.size(); ++k ) {
+    V integral(0);
+    for ( std::size_t i=0; i<children.size(); ++i )
+      integral += children[i][k] * volumes[i];
+    parent[k] = integral / total_volume;
+  }
+  return parent;
+}
+
+} // namespace
+} // namespace
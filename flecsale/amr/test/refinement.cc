@@ -0,0 +1,111 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the adaptive refinement building blocks.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <array>
+#include <vector>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/amr/refinement.h>
+
+using namespace flecsale::amr;
+
+using real_t = flecsale::config::real_t;
+using flecsale::config::test_tolerance;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the indicator and the marking of cells
+///////////////////////////////////////////////////////////////////////////////
+TEST(amr, mark) {
+
+  ASSERT_NEAR( 0, jump_indicator<real_t>( 2, 2 ), test_tolerance );
+  ASSERT_NEAR( 1./3., jump_indicator<real_t>( 1, 2 ), test_tolerance );
+  ASSERT_NEAR( 0, jump_indicator<real_t>( 0, 0 ), test_tolerance );
+  // the indicator does not depend on the scale
+  ASSERT_NEAR( jump_indicator<real_t>( 1.e-6, 1.e-5 ),
+    jump_indicator<real_t>( 1, 10 ), test_tolerance );
+
+  ASSERT_EQ( refinement_t::refine, mark<real_t>( 0.5, 0, 2, 0.1, 0.01 ) );
+  ASSERT_EQ( refinement_t::keep, mark<real_t>( 0.5, 2, 2, 0.1, 0.01 ) );
+  ASSERT_EQ( refinement_t::coarsen, mark<real_t>( 0.001, 1, 2, 0.1, 0.01 ) );
+  ASSERT_EQ( refinement_t::keep, mark<real_t>( 0.001, 0, 2, 0.1, 0.01 ) );
+  ASSERT_EQ( refinement_t::keep, mark<real_t>( 0.05, 1, 2, 0.1, 0.01 ) );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the consistency of the flags
+///////////////////////////////////////////////////////////////////////////////
+TEST(amr, balance) {
+
+  // a row of cells: 0 1 2 3 4, where 3 and 4 are siblings on level 1
+  std::vector<std::size_t> levels = { 0, 0, 1, 1, 1 };
+  std::vector< std::vector<std::size_t> > neighbors =
+    { {1}, {0,2}, {1,3}, {2,4}, {3} };
+  std::vector< std::vector<std::size_t> > siblings = { {2}, {3,4} };
+
+  // refining cell 2 drags cell 1 along, but not cell 0
+  std::vector<refinement_t> flags( 5, refinement_t::keep );
+  flags[2] = refinement_t::refine;
+  ASSERT_EQ( 1, balance( levels, neighbors, 3, flags ) );
+  ASSERT_EQ( refinement_t::refine, flags[1] );
+  ASSERT_EQ( refinement_t::keep, flags[0] );
+
+  // a group only coarsens as a whole
+  flags.assign( 5, refinement_t::keep );
+  flags[3] = refinement_t::coarsen;
+  ASSERT_EQ( 1, consolidate_coarsening( siblings, flags ) );
+  ASSERT_EQ( refinement_t::keep, flags[3] );
+
+  // and not away from a finer neighbor
+  levels = { 0, 0, 2, 1, 1 };
+  flags.assign( 5, refinement_t::keep );
+  flags[3] = flags[4] = refinement_t::coarsen;
+  ASSERT_EQ( 0, consolidate_coarsening( siblings, flags ) );
+  balance( levels, neighbors, 3, flags );
+  ASSERT_EQ( refinement_t::keep, flags[3] );
+  consolidate_coarsening( siblings, flags );
+  ASSERT_EQ( refinement_t::keep, flags[4] );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the transfer of the state between levels
+///////////////////////////////////////////////////////////////////////////////
+TEST(amr, transfer) {
+
+  using state_t = std::array<real_t,2>;
+  using vector_t = std::array<real_t,2>;
+
+  // a quad split in four, with unequal children to exercise the correction
+  state_t parent = { 1, -2 };
+  std::array<vector_t,2> grad = { vector_t{ 1, 0.5 }, vector_t{ -2, 3 } };
+  std::vector<vector_t> offsets =
+    { {-0.25, -0.25}, {0.25, -0.25}, {-0.25, 0.25}, {0.25, 0.25} };
+  std::vector<real_t> volumes = { 0.25, 0.25, 0.2, 0.3 };
+
+  std::vector<state_t> children;
+  prolong( parent, grad, offsets, volumes, children );
+  ASSERT_EQ( 4, children.size() );
+
+  // the slope survives
+  ASSERT_NEAR( 0.5, children[1][0] - children[0][0], test_tolerance );
+  ASSERT_NEAR( 1.5, children[3][1] - children[1][1], test_tolerance );
+
+  // and the volume integral is conserved both ways
+  auto back = restrict_state( children, volumes );
+  ASSERT_NEAR( parent[0], back[0], test_tolerance );
+  ASSERT_NEAR( parent[1], back[1], test_tolerance );
+
+} // TEST
@@ -16,6 +16,11 @@
 #include <ristra/math/general.h>
 #include <ristra/math/array.h>
 
+// system includes
+#include <cassert>
+#include <tuple>
+#include <type_traits>
+
 namespace flecsale {
 namespace eqns {
 
@@ -102,6 +107,35 @@ public:
     
   };
 
+  //============================================================================
+  //! \brief The reconstructed variables struct.
+  //!
+  //! Density, velocity and pressure are the variables that are reconstructed
+  //! to the faces.  Everything else follows from the equation of state.
+  //============================================================================
+  struct primitives {
+
+    //! \brief the reconstructed variables
+    enum index : size_t
+    {
+      density = 0,
+      velocity,
+      pressure = 1 + N,
+      total
+    };
+
+    //! \brief  The type for holding the reconstructed variables.
+    using data_t = ristra::math::array<real_t, index::total>;
+
+    //! \brief  The type for holding one gradient per reconstructed variable.
+    using gradient_t = ristra::math::array<vector_t, index::total>;
+
+    //! \brief the number of reconstructed variables
+    static constexpr size_t number(void)
+    {  return index::total; }
+
+  };
+
 
   //============================================================================
   // Deferred Typedefs
@@ -115,6 +149,11 @@ public:
   //! \brief  the type for holding the state data (mass, momentum, and energy)
   using flux_data_t = typename equations::data_t;
 
+  //! \brief  the type for holding the reconstructed variables
+  using primitive_data_t = typename primitives::data_t;
+  //! \brief  the type for holding the gradients of the reconstructed variables
+  using gradient_data_t = typename primitives::gradient_t;
+
 
 
   //============================================================================
@@ -172,6 +211,70 @@ public:
                          velocity(std::forward<U>(u)) );
   }
 
+  //============================================================================
+  //! \brief Check if a state carries its conserved quantities.
+  //!
+  //! A state may append a flux_data_t holding the mass, momentum and total
+  //! energy densities after the primitive variables.  These are then used as
+  //! is instead of being rebuilt from the primitives, and updates accumulate
+  //! into them directly.
+  //============================================================================
+  template< typename U, typename = void >
+  struct has_conserved : std::false_type {};
+
+  //! \copydoc has_conserved
+  template< typename U >
+  struct has_conserved< U, std::enable_if_t<
+    ( std::tuple_size< std::decay_t<U> >::value > variables::index::total )
+  > > : std::true_type {};
+
+  //============================================================================
+  //! \brief Return the conserved quantities (mass, momentum, and energy).
+  //!
+  //! If the state carries them, a reference to the stored values is 
+  //! returned.  Otherwise they are computed from the primitive variables.
+  //! \param [in] u The state.
+  //! \return The conserved quantities.
+  //============================================================================
+  template< typename U >
+  static decltype(auto) conserved( U && u ) noexcept
+  {
+    if constexpr ( has_conserved<U>::value ) {
+      return std::get<variables::index::total>( std::forward<U>(u) );
+    }
+    else {
+      const auto & rho = density( std::forward<U>(u) );
+      const auto & vel = velocity( std::forward<U>(u) );
+
+      flux_data_t q;
+      real_t ke(0);
+      q[equations::index::mass] = rho;
+      for ( int i=0; i<N; ++i ) {
+        q[equations::index::momentum+i] = rho*vel[i];
+        ke += q[equations::index::momentum+i]*vel[i];
+      }
+      q[equations::index::energy] = 
+        rho*internal_energy( std::forward<U>(u) ) + 0.5*ke;
+
+      return q;
+    }
+  }
+
+  //============================================================================
+  //! \brief Return the total energy per unit volume, i.e. rho*E.
+  //! \param [in] u The state.
+  //! \return The total energy density.
+  //============================================================================
+  template< typename U >
+  static auto total_energy_density( U && u ) noexcept
+  {
+    if constexpr ( has_conserved<U>::value ) 
+      return conserved( std::forward<U>(u) )[equations::index::energy];
+    else
+      return density( std::forward<U>(u) ) * 
+        total_energy( std::forward<U>(u) );
+  }
+
   //============================================================================
   //! \brief Compute the fastest moving wavespeed, i.e. the maximum absolute 
   //!        value.
@@ -239,29 +342,10 @@ public:
   static auto solution_delta( 
     UL && ul, UR && ur 
   ) {
-    using ristra::math::get;
-
-    // get the conserved quatities
-    auto & mass_l = density( std::forward<UL>(ul) );
-    auto & vel_l  = velocity( std::forward<UL>(ul) );
-    auto ener_l = mass_l*total_energy( std::forward<UL>(ul) );
-
-    auto & mass_r = density( std::forward<UL>(ur) );
-    auto & vel_r  = velocity( std::forward<UL>(ur) );
-    auto ener_r = mass_r*total_energy( std::forward<UL>(ur) );
-
-    // compute the change
-    flux_data_t du;
-
-    du[equations::index::mass] = mass_r - mass_l;
-    
-    for ( int i=0; i<N; ++i )  
-      du[equations::index::momentum+i] = mass_r*vel_r[i] - mass_l*vel_l[i];
-    
-    du[equations::index::energy] = ener_r - ener_l;
-
+    // stored conserved quantities are used as is
+    flux_data_t du = conserved( std::forward<UR>(ur) );
+    du -= conserved( std::forward<UL>(ul) );
     return du;
-
   }
 
   //============================================================================
@@ -282,7 +366,7 @@ public:
     const auto & rho = density ( std::forward<U>(u) );
     const auto & vel = velocity( std::forward<U>(u) );
     const auto & p   = pressure( std::forward<U>(u) );
-    const auto & et  = total_energy( std::forward<U>(u) );
+    auto rho_et = total_energy_density( std::forward<U>(u) );
       
     assert( rho > 0  );
 
@@ -298,7 +382,7 @@ public:
     for ( int i=0; i<N; i++ ) 
       f[equations::index::momentum+i] = mass_flux * vel[i] + p*norm[i];
 
-    f[equations::index::energy] = mass_flux * (et + p/rho);
+    f[equations::index::energy] = v_dot_n * (rho_et + p);
 
     return f;
   }
@@ -374,39 +458,160 @@ public:
     sound_speed(std::forward<U>(u)) = eos.compute_sound_speed_de( d, ie );
   }
 
+  //============================================================================
+  //! \brief Update the quantities needed to advance the solution.
+  //!
+  //! Same as update_state_from_energy, but the temperature is left alone
+  //! since neither the fluxes nor the time step need it.  Call
+  //! update_temperature before it is consumed.
+  //! \param [in,out] u   The state to update.
+  //! \param [in]     eos The equation of state to apply.
+  //! \tparam E  The type of the equation of state.
+  //============================================================================
+  template <typename U, typename E>
+  static void update_flow_state_from_energy( U && u, const E & eos )
+  {
+    // access independant or derived quantities 
+    auto d  = density ( std::forward<U>(u) );
+    auto ie = internal_energy( std::forward<U>(u) );
+      
+    assert( d > 0  );
+    assert( ie > 0  );
+
+    // explicitly set the individual elements
+    pressure(std::forward<U>(u))    = eos.compute_pressure_de( d, ie );
+    sound_speed(std::forward<U>(u)) = eos.compute_sound_speed_de( d, ie );
+  }
 
   //============================================================================
-  //! \brief Apply an update from conservative fluxes.
+  //! \brief Update the temperature from the energy.
   //! \param [in,out] u   The state to update.
-  //! \param [in]     du  The conservative change in state.
+  //! \param [in]     eos The equation of state to apply.
+  //! \tparam E  The type of the equation of state.
   //============================================================================
-  template< typename U, typename F >
-  static void update_state_from_flux( U && u, F && du )
+  template <typename U, typename E>
+  static void update_temperature( U && u, const E & eos )
   {
-    using ristra::math::get;
-    using ristra::math::abs;
+    auto d  = density ( std::forward<U>(u) );
+    auto ie = internal_energy( std::forward<U>(u) );
+    temperature(std::forward<U>(u)) = eos.compute_temperature_de( d, ie );
+  }
 
-    // compute the change in density and energy
-    auto den0 = density(std::forward<U>(u));
-    auto mass = den0 + du[equations::index::mass];
-    auto ener = den0*total_energy(std::forward<U>(u)) + 
-                du[equations::index::energy];
 
-    // recompute solution quantities
+  //============================================================================
+  //! \brief Recompute the primitive variables from the conserved ones.
+  //!
+  //! Only the density, velocity and internal energy are set.  The rest
+  //! should be updated with update_state_from_energy.
+  //! \param [in,out] u   The state to update.
+  //! \param [in]     q   The conserved quantities.
+  //============================================================================
+  template< typename U, typename Q >
+  static void update_state_from_conserved( U && u, const Q & q )
+  {
+    auto mass = q[equations::index::mass];
     auto inv_mass = 1 / mass;
-    
+
     auto & vel = velocity(std::forward<U>(u));
+    real_t ke(0);
     for ( int i=0; i<N; ++i ) {
-      auto mom = den0*vel[i] + 
-                 std::forward<F>(du)[equations::index::momentum + i];
+      const auto & mom = q[equations::index::momentum + i];
       vel[i] = mom * inv_mass;
+      ke += mom * vel[i];
     }
-    
-    density(std::forward<U>(u)) = mass;    
 
-    internal_energy(u) = 
-      ener*inv_mass - 0.5 * dot_product( vel, vel );
+    density(std::forward<U>(u)) = mass;
+    internal_energy(std::forward<U>(u)) = 
+      ( q[equations::index::energy] - 0.5*ke ) * inv_mass;
+  }
+
+  //============================================================================
+  //! \brief Extract the reconstructed variables from a state.
+  //! \param [in] u  The state.
+  //! \return The density, velocity and pressure packed in one array.
+  //============================================================================
+  template< typename U >
+  static auto primitive( U && u )
+  {
+    primitive_data_t w;
+    w[primitives::index::density] = density( std::forward<U>(u) );
+    const auto & vel = velocity( std::forward<U>(u) );
+    for ( int i=0; i<N; ++i )
+      w[primitives::index::velocity + i] = vel[i];
+    w[primitives::index::pressure] = pressure( std::forward<U>(u) );
+    return w;
+  }
+
+  //============================================================================
+  //! \brief Set a state from reconstructed variables.
+  //! \param [in,out] u   The state to update.
+  //! \param [in]     w   The density, velocity and pressure.
+  //! \param [in]     eos The equation of state to apply.
+  //============================================================================
+  template< typename U, typename W, typename E >
+  static void update_state_from_primitive( U && u, const W & w, const E & eos )
+  {
+    density( std::forward<U>(u) ) = w[primitives::index::density];
+    auto & vel = velocity( std::forward<U>(u) );
+    for ( int i=0; i<N; ++i )
+      vel[i] = w[primitives::index::velocity + i];
+    pressure( std::forward<U>(u) ) = w[primitives::index::pressure];
+    update_state_from_pressure( std::forward<U>(u), eos );
+  }
 
+  //============================================================================
+  //! \brief The rate of change of the reconstructed variables.
+  //!
+  //! This is the quasi-linear, non-conservative form of the equations,
+  //! \f$ \partial_t W = -A(W) \nabla W \f$, evaluated with the cell
+  //! gradients.  It is used by the MUSCL-Hancock predictor.
+  //! \param [in] u     The cell state.
+  //! \param [in] grad  The gradients of the reconstructed variables.
+  //============================================================================
+  template< typename U, typename G >
+  static auto primitive_rate( U && u, const G & grad )
+  {
+    const auto & rho = density( std::forward<U>(u) );
+    const auto & vel = velocity( std::forward<U>(u) );
+    const auto & a = sound_speed( std::forward<U>(u) );
+
+    // u.grad(w) for every variable, and div(u)
+    primitive_data_t dwdt;
+    real_t div_u(0);
+    for ( size_t k=0; k<primitives::index::total; ++k ) {
+      real_t adv(0);
+      for ( int i=0; i<N; ++i ) adv += vel[i] * grad[k][i];
+      dwdt[k] = - adv;
+    }
+    for ( int i=0; i<N; ++i )
+      div_u += grad[primitives::index::velocity + i][i];
+
+    // the pressure gradient accelerates the flow, and compression heats it
+    dwdt[primitives::index::density] -= rho * div_u;
+    for ( int i=0; i<N; ++i )
+      dwdt[primitives::index::velocity + i] -=
+        grad[primitives::index::pressure][i] / rho;
+    dwdt[primitives::index::pressure] -= rho * a * a * div_u;
+
+    return dwdt;
+  }
+
+  //============================================================================
+  //! \brief Apply an update from conservative fluxes.
+  //!
+  //! When the state carries its conserved quantities, the update is a plain
+  //! accumulation into them followed by a single conversion back to the
+  //! primitive variables.
+  //! \param [in,out] u   The state to update.
+  //! \param [in]     du  The conservative change in state.
+  //============================================================================
+  template< typename U, typename F >
+  static void update_state_from_flux( U && u, F && du )
+  {
+    // either a reference to the stored values or a temporary
+    decltype(auto) q = conserved( std::forward<U>(u) );
+    q += std::forward<F>(du);
+    update_state_from_conserved( std::forward<U>(u), q );
   }
 
 };
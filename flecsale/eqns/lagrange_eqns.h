@@ -301,6 +301,50 @@ public:
     ss = std::max( ss, min_sound_speed );
   }
 
+  //============================================================================
+  //! \brief Update the quantities needed to advance the solution.
+  //!
+  //! Same as update_state_from_energy, but the temperature is left alone
+  //! since neither the nodal solver nor the time step need it.  Call
+  //! update_temperature before it is consumed.
+  //! \param [in,out] u   The state to update.
+  //! \param [in]     eos The equation of state object to apply.
+  //! \tparam E  The EOS object type.
+  //============================================================================
+  template <typename U, typename E>
+  static void update_flow_state_from_energy( U && u, const E & eos )
+  {
+    // access independant or derived quantities 
+    auto d = density( std::forward<U>(u) );
+    auto ie = internal_energy( std::forward<U>(u) );
+      
+    assert( d > 0  );
+    assert( ie > 0  );
+
+    // can use aliases for clarity
+    auto & p  = pressure( std::forward<U>(u) );
+    auto & ss = sound_speed( std::forward<U>(u) );
+
+    // explicitly set the individual elements
+    p  = eos.compute_pressure_de( d, ie );
+    ss = eos.compute_sound_speed_de( d, ie );
+    ss = std::max( ss, min_sound_speed );
+  }
+
+  //============================================================================
+  //! \brief Update the temperature from the energy.
+  //! \param [in,out] u   The state to update.
+  //! \param [in]     eos The equation of state object to apply.
+  //! \tparam E  The EOS object type.
+  //============================================================================
+  template <typename U, typename E>
+  static void update_temperature( U && u, const E & eos )
+  {
+    auto d = density( std::forward<U>(u) );
+    auto ie = internal_energy( std::forward<U>(u) );
+    temperature( std::forward<U>(u) ) = eos.compute_temperature_de( d, ie );
+  }
+
 
   //============================================================================
   //! \brief Apply an update from conservative fluxes.
@@ -0,0 +1,208 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Least-squares gradients and slope limiters for second order
+///        reconstruction.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <ristra/assertions/errors.h>
+#include <ristra/utils/array_view.h>
+#include <flecsale/linalg/qr.h>
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace flecsale {
+namespace eqns {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The available slope limiters.
+////////////////////////////////////////////////////////////////////////////////
+enum class limiter_t {
+  //! the gradients are used as is
+  none,
+  //! strictly monotone, but not differentiable
+  barth_jespersen,
+  //! a smooth version of barth_jespersen that converges better
+  venkatakrishnan
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Convert a limiter name to its enum.
+//! \param [in] name  One of "none", "barth_jespersen" or "venkatakrishnan".
+////////////////////////////////////////////////////////////////////////////////
+inline limiter_t limiter( const std::string & name )
+{
+  if ( name == "none" )
+    return limiter_t::none;
+  else if ( name == "barth_jespersen" )
+    return limiter_t::barth_jespersen;
+  else if ( name == "venkatakrishnan" )
+    return limiter_t::venkatakrishnan;
+  else
+    THROW_RUNTIME_ERROR( "Unknown limiter \"" << name << "\"" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The Barth-Jespersen limiter.
+//!
+//! Returns the largest factor that keeps the reconstructed value within the
+//! range of the neighboring cell values.
+//!
+//! \param [in] delta  The unlimited change from the cell to the face.
+//! \param [in] delta_min,delta_max  The smallest and largest change from the
+//!                                  cell to its neighbors.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+T barth_jespersen( T delta, T delta_min, T delta_max )
+{
+  if ( delta > 0 )
+    return std::min<T>( 1, delta_max / delta );
+  else if ( delta < 0 )
+    return std::min<T>( 1, delta_min / delta );
+  else
+    return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The Venkatakrishnan limiter.
+//!
+//! \param [in] delta  The unlimited change from the cell to the face.
+//! \param [in] delta_min,delta_max  The smallest and largest change from the
+//!                                  cell to its neighbors.
+//! \param [in] eps2  The smoothing parameter, usually \f$ (K h)^3 \f$ where
+//!                   h is the cell size.  Zero gives back a smooth version
+//!                   of barth_jespersen.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+T venkatakrishnan( T delta, T delta_min, T delta_max, T eps2 )
+{
+  if ( delta == 0 ) return 1;
+  auto dm = ( delta > 0 ) ? delta_max : delta_min;
+  auto dm2 = dm*dm;
+  auto num = dm2 + eps2 + 2*delta*dm;
+  auto den = dm2 + 2*delta*delta + delta*dm + eps2;
+  return std::min<T>( 1, num / den );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Evaluate one of the limiters.
+//! \param [in] type  The limiter to use.
+//! \param [in] delta,delta_min,delta_max,eps2  See venkatakrishnan.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+T limit( limiter_t type, T delta, T delta_min, T delta_max, T eps2 )
+{
+  switch ( type ) {
+    case limiter_t::barth_jespersen:
+      return barth_jespersen( delta, delta_min, delta_max );
+    case limiter_t::venkatakrishnan:
+      return venkatakrishnan( delta, delta_min, delta_max, eps2 );
+    default:
+      return 1;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief A least-squares gradient of several variables at once.
+//!
+//! Each neighbor contributes one row, \f$ \Delta x \cdot \nabla u = \Delta u
+//! \f$, weighted by the inverse distance.  The overdetermined system is
+//! solved with flecsale::linalg::qr, once per variable.  The scratch storage
+//! is kept between cells, so use one object per thread.
+//!
+//! \tparam T  The real type.
+//! \tparam D  The number of dimensions.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, std::size_t D >
+class least_squares_u {
+
+public:
+
+  //! \brief Forget the neighbors added so far.
+  void clear()
+  {
+    dx_.clear();
+    du_.clear();
+    num_rows_ = 0;
+  }
+
+  //! \brief Return the number of neighbors added so far.
+  std::size_t size() const
+  { return num_rows_; }
+
+  //! \brief Add a neighbor.
+  //! \param [in] dx  The displacement from the cell to the neighbor.
+  //! \param [in] du  The change in each variable from the cell to the
+  //!                 neighbor.
+  template< typename X, typename U >
+  void add( const X & dx, const U & du )
+  {
+    T dist2(0);
+    for ( std::size_t d=0; d<D; ++d ) dist2 += dx[d]*dx[d];
+    auto w = 1 / std::sqrt( dist2 );
+
+    for ( std::size_t d=0; d<D; ++d ) dx_.emplace_back( w * dx[d] );
+    num_vars_ = du.size();
+    for ( std::size_t k=0; k<num_vars_; ++k ) du_.emplace_back( w * du[k] );
+    ++num_rows_;
+  }
+
+  //! \brief Solve for the gradients.
+  //!
+  //! Cells with fewer neighbors than dimensions get a zero gradient, which
+  //! makes them first order.
+  //! \param [out] grad  The gradients, grad[k][d] is the derivative of
+  //!                    variable k in direction d.
+  template< typename G >
+  void solve( G & grad )
+  {
+    if ( num_rows_ < D ) {
+      for ( std::size_t k=0; k<grad.size(); ++k )
+        for ( std::size_t d=0; d<D; ++d ) grad[k][d] = 0;
+      return;
+    }
+
+    b_.resize( num_rows_ );
+
+    for ( std::size_t k=0; k<num_vars_; ++k ) {
+      // qr overwrites the system, so start from a fresh copy
+      A_.assign( dx_.begin(), dx_.end() );
+      for ( std::size_t i=0; i<num_rows_; ++i ) b_[i] = du_[i*num_vars_ + k];
+      auto A_view = ristra::utils::make_array_view( A_, num_rows_, D );
+      auto b_view = ristra::utils::make_array_view( b_ );
+      linalg::qr( A_view, b_view );
+      for ( std::size_t d=0; d<D; ++d ) grad[k][d] = b_view[d];
+    }
+  }
+
+private:
+
+  //! the weighted displacements, one row per neighbor
+  std::vector<T> dx_;
+  //! the weighted changes, one row per neighbor
+  std::vector<T> du_;
+  //! scratch space for the solver
+  std::vector<T> A_, b_;
+  //! the number of neighbors
+  std::size_t num_rows_ = 0;
+  //! the number of variables
+  std::size_t num_vars_ = 0;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,250 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Storage for a set of states with a compile time memory layout.
+///
+/// A state is described by the data_t tuple of the equations, e.g.
+/// euler_eqns_t::state_data_t, whose elements are ordered by the
+/// variables::index enum.  Indexing the storage returns something that the
+/// equation accessors understand, so
+/// \code
+///   eqns_t::density( storage(i) )
+/// \endcode
+/// works the same regardless of the layout.  Vector valued variables are
+/// always kept as a unit so that accessors can keep returning references
+/// to them.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace flecsale {
+namespace eqns {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief The supported memory layouts.
+////////////////////////////////////////////////////////////////////////////////
+enum class layout_t {
+  //! one packed record per state, best for gathers
+  aos,
+  //! one array per variable, best for streaming a few variables
+  soa,
+  //! blocks of W states stored as one array per variable
+  aosoa
+};
+
+namespace detail {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Derive the storage types from the state tuple.
+//! \tparam D  The state tuple type.
+////////////////////////////////////////////////////////////////////////////////
+template<
+  typename D,
+  typename = std::make_index_sequence< std::tuple_size<D>::value >
+>
+struct state_types_u;
+
+//! \copydoc state_types_u
+template< typename D, std::size_t... I >
+struct state_types_u< D, std::index_sequence<I...> > {
+
+  //! a tuple of references to the variables of one state
+  using ref_t = std::tuple< std::tuple_element_t<I,D> &... >;
+  //! a tuple of const references to the variables of one state
+  using const_ref_t = std::tuple< const std::tuple_element_t<I,D> &... >;
+
+  //! one array per variable
+  using columns_t = std::tuple< std::vector< std::tuple_element_t<I,D> >... >;
+
+  //! a block of W states, with one array per variable
+  template< std::size_t W >
+  using block_t = std::tuple< std::array< std::tuple_element_t<I,D>, W >... >;
+
+  //! \brief Gather the references to state i from a set of columns.
+  template< typename C >
+  static auto column_refs( C & columns, std::size_t i )
+  {
+    using result_t = std::conditional_t<
+      std::is_const<C>::value, const_ref_t, ref_t >;
+    return result_t( std::get<I>(columns)[i]... );
+  }
+
+  //! \brief Resize every column.
+  static void resize_columns( columns_t & columns, std::size_t n )
+  { (void)std::initializer_list<int>{ (std::get<I>(columns).resize(n), 0)... }; }
+
+};
+
+} // namespace detail
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Storage for a set of states.
+//!
+//! \tparam D  The state tuple type.
+//! \tparam L  The memory layout.
+//! \tparam W  The block width, only used by layout_t::aosoa.
+////////////////////////////////////////////////////////////////////////////////
+template< typename D, layout_t L, std::size_t W = 8 >
+class state_storage_u;
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Array of structures storage.
+//!
+//! Indexing returns a reference to the packed record.
+////////////////////////////////////////////////////////////////////////////////
+template< typename D, std::size_t W >
+class state_storage_u< D, layout_t::aos, W > {
+
+public:
+
+  //! the state tuple type
+  using data_t = D;
+  //! the layout
+  static constexpr layout_t layout = layout_t::aos;
+
+  //! \brief Create storage for n states.
+  explicit state_storage_u( std::size_t n = 0 ) : data_(n) {}
+
+  //! \brief Return the number of states.
+  std::size_t size() const { return data_.size(); }
+
+  //! \brief Change the number of states.
+  void resize( std::size_t n ) { data_.resize(n); }
+
+  //! \brief Access state i.
+  data_t & operator()( std::size_t i ) { return data_[i]; }
+  //! \copydoc operator()
+  const data_t & operator()( std::size_t i ) const { return data_[i]; }
+
+private:
+
+  //! the records
+  std::vector<data_t> data_;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Structure of arrays storage.
+//!
+//! Indexing returns a tuple of references into each array, just like the
+//! pack() helper of the apps.
+////////////////////////////////////////////////////////////////////////////////
+template< typename D, std::size_t W >
+class state_storage_u< D, layout_t::soa, W > {
+
+  //! the derived types
+  using types_t = detail::state_types_u<D>;
+
+public:
+
+  //! the state tuple type
+  using data_t = D;
+  //! the layout
+  static constexpr layout_t layout = layout_t::soa;
+
+  //! \brief Create storage for n states.
+  explicit state_storage_u( std::size_t n = 0 ) { resize(n); }
+
+  //! \brief Return the number of states.
+  std::size_t size() const { return size_; }
+
+  //! \brief Change the number of states.
+  void resize( std::size_t n )
+  {
+    types_t::resize_columns( columns_, n );
+    size_ = n;
+  }
+
+  //! \brief Access state i.
+  auto operator()( std::size_t i )
+  { return types_t::column_refs( columns_, i ); }
+  //! \copydoc operator()
+  auto operator()( std::size_t i ) const
+  { return types_t::column_refs( columns_, i ); }
+
+  //! \brief Access the array of variable I.
+  template< std::size_t I >
+  auto & column() { return std::get<I>(columns_); }
+  //! \copydoc column
+  template< std::size_t I >
+  const auto & column() const { return std::get<I>(columns_); }
+
+private:
+
+  //! the arrays
+  typename types_t::columns_t columns_;
+  //! the number of states
+  std::size_t size_ = 0;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Array of structures of arrays storage.
+//!
+//! States are grouped in blocks of W, and each block stores one array per
+//! variable.  Indexing returns a tuple of references into the block.
+////////////////////////////////////////////////////////////////////////////////
+template< typename D, std::size_t W >
+class state_storage_u< D, layout_t::aosoa, W > {
+
+  static_assert( W > 0, "the block width must be positive" );
+
+  //! the derived types
+  using types_t = detail::state_types_u<D>;
+  //! the block type
+  using block_t = typename types_t::template block_t<W>;
+
+public:
+
+  //! the state tuple type
+  using data_t = D;
+  //! the layout
+  static constexpr layout_t layout = layout_t::aosoa;
+  //! the block width
+  static constexpr std::size_t width = W;
+
+  //! \brief Create storage for n states.
+  explicit state_storage_u( std::size_t n = 0 ) { resize(n); }
+
+  //! \brief Return the number of states.
+  std::size_t size() const { return size_; }
+
+  //! \brief Change the number of states.
+  void resize( std::size_t n )
+  {
+    blocks_.resize( (n + W - 1) / W );
+    size_ = n;
+  }
+
+  //! \brief Access state i.
+  auto operator()( std::size_t i )
+  { return types_t::column_refs( blocks_[i/W], i%W ); }
+  //! \copydoc operator()
+  auto operator()( std::size_t i ) const
+  { return types_t::column_refs( blocks_[i/W], i%W ); }
+
+private:
+
+  //! the blocks
+  std::vector<block_t> blocks_;
+  //! the number of states
+  std::size_t size_ = 0;
+
+};
+
+} // namespace
+} // namespace
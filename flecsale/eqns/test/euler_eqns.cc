@@ -32,6 +32,7 @@ using namespace flecsale::eqns;
 using namespace flecsale::eos;
 
 using real_t = config::real_t;
+using config::test_tolerance;
 using eqns_t = euler_eqns_t<real_t,3>;
 using eos_t  = ideal_gas_t<real_t>;
 
@@ -75,3 +76,63 @@ TEST(eqns, euler) {
 } // TEST_F
 
 
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the conserved state storage
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, euler_conserved) {
+
+  using vector_t = eqns_t::vector_t;
+  using flux_data_t = eqns_t::flux_data_t;
+  using index = eqns_t::equations::index;
+
+  eos_t eos;
+
+  // a primitive state, and the same state carrying its conserved quantities
+  real_t d = 1.0, p = 2.0, e, T, a;
+  vector_t v{1.0, 0.5, 0.75};
+  auto w = std::forward_as_tuple( d, v, p, e, T, a );
+  eqns_t::update_state_from_pressure( w, eos );
+
+  real_t dq = d, pq = p, eq = e, Tq = T, aq = a;
+  vector_t vq = v;
+  flux_data_t q = eqns_t::conserved( w );
+  auto wq = std::forward_as_tuple( dq, vq, pq, eq, Tq, aq, q );
+
+  static_assert( !eqns_t::has_conserved<decltype(w)>::value, "bad trait" );
+  static_assert( eqns_t::has_conserved<decltype(wq)>::value, "bad trait" );
+
+  ASSERT_NEAR( q[index::mass], d, test_tolerance );
+  for ( int i=0; i<3; ++i )
+    ASSERT_NEAR( q[index::momentum+i], d*v[i], test_tolerance );
+  ASSERT_NEAR( q[index::energy], d*eqns_t::total_energy(w), test_tolerance );
+
+  // the fluxes must agree
+  vector_t n{0.0, 1.0, 0.0};
+  auto f = eqns_t::flux( w, n );
+  auto fq = eqns_t::flux( wq, n );
+  for ( std::size_t i=0; i<eqns_t::equations::number(); ++i )
+    ASSERT_NEAR( f[i], fq[i], test_tolerance );
+
+  // and so must the updates
+  flux_data_t du;
+  du[index::mass] = 0.1;
+  du[index::momentum+0] = -0.2;
+  du[index::momentum+1] = 0.05;
+  du[index::momentum+2] = 0.0;
+  du[index::energy] = 0.3;
+
+  eqns_t::update_state_from_flux( w, du );
+  eqns_t::update_state_from_flux( wq, du );
+
+  ASSERT_NEAR( d, dq, test_tolerance );
+  ASSERT_NEAR( e, eq, test_tolerance );
+  for ( int i=0; i<3; ++i ) 
+    ASSERT_NEAR( v[i], vq[i], test_tolerance );
+
+  // the stored state was accumulated in place
+  ASSERT_NEAR( q[index::mass], 1.1, test_tolerance );
+  ASSERT_NEAR( eqns_t::conserved(w)[index::energy], q[index::energy],
+    test_tolerance );
+
+} // TEST
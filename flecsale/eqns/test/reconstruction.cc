@@ -0,0 +1,155 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the second order reconstruction.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <array>
+#include <iostream>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eqns/euler_eqns.h>
+#include <flecsale/eqns/reconstruction.h>
+#include <flecsale/eos/ideal_gas.h>
+
+
+// explicitly use some stuff
+using std::cout;
+using std::endl;
+
+using namespace flecsale;
+using namespace flecsale::eqns;
+using namespace flecsale::eos;
+
+using real_t = config::real_t;
+using config::test_tolerance;
+using eqns_t = euler_eqns_t<real_t,2>;
+using eos_t  = ideal_gas_t<real_t>;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the least-squares gradients
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, least_squares) {
+
+  // two linear fields, on an irregular stencil
+  auto u = []( real_t x, real_t y ) {
+    return std::array<real_t,2>{ 1 + 2*x - 3*y, -0.5*x + 0.25*y };
+  };
+
+  std::vector< std::array<real_t,2> > stencil = {
+    {1.0, 0.1}, {-0.9, 0.2}, {0.1, 1.1}, {-0.2, -0.8}, {0.7, 0.6}
+  };
+
+  least_squares_u<real_t,2> ls;
+  std::array< std::array<real_t,2>, 2 > grad;
+
+  auto u0 = u( 0.3, -0.2 );
+  for ( const auto & dx : stencil ) {
+    auto un = u( 0.3 + dx[0], -0.2 + dx[1] );
+    std::array<real_t,2> du{ un[0] - u0[0], un[1] - u0[1] };
+    ls.add( dx, du );
+  }
+  ASSERT_EQ( ls.size(), stencil.size() );
+  ls.solve( grad );
+
+  // linear fields are recovered exactly
+  ASSERT_NEAR(  2.0,  grad[0][0], test_tolerance );
+  ASSERT_NEAR( -3.0,  grad[0][1], test_tolerance );
+  ASSERT_NEAR( -0.5,  grad[1][0], test_tolerance );
+  ASSERT_NEAR(  0.25, grad[1][1], test_tolerance );
+
+  // too few neighbors gives a zero gradient
+  ls.clear();
+  ls.add( stencil[0], std::array<real_t,2>{1, 1} );
+  ls.solve( grad );
+  ASSERT_EQ( 0, grad[0][0] );
+  ASSERT_EQ( 0, grad[1][1] );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the slope limiters
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, limiters) {
+
+  // the face value may not exceed the neighbors
+  ASSERT_NEAR( 0.5, barth_jespersen<real_t>( 2, -1, 1 ), test_tolerance );
+  ASSERT_NEAR( 0.25, barth_jespersen<real_t>( -4, -1, 1 ), test_tolerance );
+  ASSERT_NEAR( 1.0, barth_jespersen<real_t>( 0.5, -1, 1 ), test_tolerance );
+  ASSERT_NEAR( 1.0, barth_jespersen<real_t>( 0, 0, 0 ), test_tolerance );
+  // a local extremum is flattened
+  ASSERT_NEAR( 0.0, barth_jespersen<real_t>( 1, -1, 0 ), test_tolerance );
+
+  // venkatakrishnan is bounded and smooth
+  for ( real_t r = -4; r <= 4; r += 0.125 ) {
+    auto phi = venkatakrishnan<real_t>( r, -1, 1, 0 );
+    ASSERT_LE( phi, 1 );
+    ASSERT_GE( phi, 0 );
+    ASSERT_LE( phi * std::abs(r), 1 + test_tolerance );
+  }
+  ASSERT_NEAR( 1.0, venkatakrishnan<real_t>( 0, -1, 1, 0 ), test_tolerance );
+  // a large smoothing parameter switches the limiter off
+  ASSERT_NEAR( 1.0, venkatakrishnan<real_t>( 1, -1, 0, 1.e20 ), 1.e-10 );
+
+  ASSERT_EQ( limiter_t::venkatakrishnan, limiter("venkatakrishnan") );
+  ASSERT_EQ( 1, limit<real_t>( limiter_t::none, 2, -1, 1, 0 ) );
+  ASSERT_NEAR( 0.5, limit<real_t>( limiter_t::barth_jespersen, 2, -1, 1, 0 ),
+    test_tolerance );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the reconstructed variables of the euler equations
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, euler_primitive) {
+
+  using vector_t = eqns_t::vector_t;
+  using index = eqns_t::primitives::index;
+
+  eos_t eos;
+
+  real_t d = 1.0, p = 2.0, e, T, a;
+  vector_t v{1.0, 0.5};
+  auto u = std::forward_as_tuple( d, v, p, e, T, a );
+  eqns_t::update_state_from_pressure( u, eos );
+
+  // round trip through the reconstructed variables
+  auto w = eqns_t::primitive( u );
+  ASSERT_NEAR( d, w[index::density], test_tolerance );
+  ASSERT_NEAR( v[1], w[index::velocity+1], test_tolerance );
+  ASSERT_NEAR( p, w[index::pressure], test_tolerance );
+
+  eqns_t::state_data_t uw;
+  eqns_t::update_state_from_primitive( uw, w, eos );
+  ASSERT_NEAR( e, eqns_t::internal_energy(uw), test_tolerance );
+  ASSERT_NEAR( a, eqns_t::sound_speed(uw), test_tolerance );
+
+  // a density gradient is simply advected
+  eqns_t::gradient_data_t grad;
+  for ( auto & g : grad ) g = 0;
+  grad[index::density][0] = 3;
+  auto dwdt = eqns_t::primitive_rate( u, grad );
+  ASSERT_NEAR( -3*v[0], dwdt[index::density], test_tolerance );
+  ASSERT_NEAR( 0, dwdt[index::velocity], test_tolerance );
+  ASSERT_NEAR( 0, dwdt[index::pressure], test_tolerance );
+
+  // compression raises the pressure, and the pressure gradient accelerates
+  for ( auto & g : grad ) g = 0;
+  grad[index::velocity][0] = -1;
+  grad[index::pressure][1] = 2;
+  dwdt = eqns_t::primitive_rate( u, grad );
+  ASSERT_NEAR( d, dwdt[index::density], test_tolerance );
+  ASSERT_NEAR( v[0], dwdt[index::velocity], test_tolerance );
+  ASSERT_NEAR( -2/d, dwdt[index::velocity+1], test_tolerance );
+  ASSERT_NEAR( d*a*a - v[1]*2, dwdt[index::pressure], test_tolerance );
+
+} // TEST
@@ -0,0 +1,195 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+/// 
+/// \brief Tests and timings of the state storage layouts.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/eos/ideal_gas.h>
+#include <flecsale/eqns/euler_eqns.h>
+#include <flecsale/eqns/flux.h>
+#include <flecsale/eqns/state_layout.h>
+
+
+// explicitly use some stuff
+using std::cout;
+using std::endl;
+
+using namespace flecsale;
+using namespace flecsale::eqns;
+using namespace flecsale::eos;
+
+using real_t = config::real_t;
+using config::test_tolerance;
+using eqns_t = euler_eqns_t<real_t,2>;
+using eos_t  = ideal_gas_t<real_t>;
+using vector_t = eqns_t::vector_t;
+using state_data_t = eqns_t::state_data_t;
+
+template< layout_t L >
+using storage_t = state_storage_u< state_data_t, L, 8 >;
+
+//! the names of the layouts
+const char * layout_name( layout_t layout )
+{
+  switch (layout) {
+    case layout_t::aos: return "aos";
+    case layout_t::soa: return "soa";
+    case layout_t::aosoa: return "aosoa";
+  }
+  return "";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Fill a storage with a smooth state
+///////////////////////////////////////////////////////////////////////////////
+template< typename S >
+void initialize( S & states, const eos_t & eos )
+{
+  for ( std::size_t i=0; i<states.size(); ++i ) {
+    auto && u = states(i);
+    eqns_t::density(u) = 1 + 0.001*i;
+    eqns_t::velocity(u) = vector_t{ 0.1, -0.2 };
+    eqns_t::pressure(u) = 1 + 0.002*i;
+    eqns_t::update_state_from_pressure( u, eos );
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Check that a layout behaves like the packed state
+///////////////////////////////////////////////////////////////////////////////
+template< layout_t L >
+void check_layout()
+{
+  eos_t eos;
+  storage_t<L> states( 21 );
+  ASSERT_EQ( states.size(), 21 );
+  initialize( states, eos );
+
+  const auto & const_states = states;
+
+  for ( std::size_t i=0; i<states.size(); ++i ) {
+    state_data_t w;
+    eqns_t::density(w) = 1 + 0.001*i;
+    eqns_t::velocity(w) = vector_t{ 0.1, -0.2 };
+    eqns_t::pressure(w) = 1 + 0.002*i;
+    eqns_t::update_state_from_pressure( w, eos );
+
+    auto && u = const_states(i);
+    ASSERT_NEAR( eqns_t::density(u), eqns_t::density(w), test_tolerance );
+    ASSERT_NEAR( eqns_t::internal_energy(u), eqns_t::internal_energy(w),
+      test_tolerance );
+    ASSERT_NEAR( eqns_t::sound_speed(u), eqns_t::sound_speed(w),
+      test_tolerance );
+    ASSERT_NEAR( eqns_t::velocity(u)[1], -0.2, test_tolerance );
+  }
+
+  // references must point at the storage
+  eqns_t::density( states(20) ) = 5;
+  ASSERT_NEAR( eqns_t::density( const_states(20) ), 5, test_tolerance );
+
+  // growing keeps the existing states
+  states.resize( 40 );
+  ASSERT_NEAR( eqns_t::density( const_states(3) ), 1.003, test_tolerance );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the layouts
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, state_layout) {
+  check_layout< layout_t::aos >();
+  check_layout< layout_t::soa >();
+  check_layout< layout_t::aosoa >();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Time a gather heavy face kernel and a streaming cell kernel
+///////////////////////////////////////////////////////////////////////////////
+template< layout_t L >
+void time_layout( 
+  const std::vector< std::pair<std::size_t, std::size_t> > & faces,
+  std::size_t num_cells,
+  std::size_t num_repeats
+) {
+  using clock_t = std::chrono::high_resolution_clock;
+
+  eos_t eos;
+  storage_t<L> states( num_cells );
+  initialize( states, eos );
+
+  const vector_t normal{ 1, 0 };
+  real_t checksum = 0;
+
+  // gather two states per face
+  auto start = clock_t::now();
+  for ( std::size_t r=0; r<num_repeats; ++r ) 
+    for ( const auto & f : faces ) {
+      auto flux = hlle_flux<eqns_t>(
+        states(f.first), states(f.second), normal );
+      checksum += flux[0];
+    }
+  std::chrono::duration<double> face_time = clock_t::now() - start;
+
+  // stream through the cells
+  start = clock_t::now();
+  for ( std::size_t r=0; r<num_repeats; ++r ) 
+    for ( std::size_t i=0; i<num_cells; ++i ) {
+      auto && u = states(i);
+      eqns_t::update_flow_state_from_energy( u, eos );
+      checksum += eqns_t::pressure(u);
+    }
+  std::chrono::duration<double> cell_time = clock_t::now() - start;
+
+  cout << std::setw(8) << layout_name(L) 
+       << std::setw(14) << face_time.count() / num_repeats
+       << std::setw(14) << cell_time.count() / num_repeats
+       << "    (" << checksum << ")" << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Compare the layouts
+//!
+//! The faces connect each cell to its neighbors in a 2d grid whose cells
+//! are shuffled, which mimics the gathers of an unstructured mesh.
+///////////////////////////////////////////////////////////////////////////////
+TEST(eqns, state_layout_timing) {
+
+  constexpr std::size_t nx = 256;
+  constexpr std::size_t num_cells = nx*nx;
+  constexpr std::size_t num_repeats = 5;
+
+  std::vector<std::size_t> order( num_cells );
+  for ( std::size_t i=0; i<num_cells; ++i ) order[i] = i;
+  std::shuffle( order.begin(), order.end(), std::mt19937(0) );
+
+  std::vector< std::pair<std::size_t, std::size_t> > faces;
+  faces.reserve( 2*num_cells );
+  for ( std::size_t j=0; j<nx; ++j )
+    for ( std::size_t i=0; i<nx; ++i ) {
+      auto c = order[ i + nx*j ];
+      if ( i+1 < nx ) faces.emplace_back( c, order[ i+1 + nx*j ] );
+      if ( j+1 < nx ) faces.emplace_back( c, order[ i + nx*(j+1) ] );
+    }
+
+  cout << std::setw(8) << "layout" << std::setw(14) << "faces (s)" 
+       << std::setw(14) << "cells (s)" << endl;
+  time_layout< layout_t::aos >( faces, num_cells, num_repeats );
+  time_layout< layout_t::soa >( faces, num_cells, num_repeats );
+  time_layout< layout_t::aosoa >( faces, num_cells, num_repeats );
+
+}
@@ -0,0 +1,578 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Aggregate the field output of many ranks into a few files.
+///
+/// The ranks are split into groups, and the first rank of each group writes
+/// one file for the whole group.  Each file starts with a table of the
+/// slices it holds and an index that maps global ids to file offsets.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "field_file.h"
+
+// system includes
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace flecsale {
+namespace io {
+
+//! the magic bytes at the start of every aggregated file
+static constexpr char aggregate_file_magic[8] =
+  {'F','L','E','C','A','G','G','1'};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief How ranks are assigned to writers.
+///////////////////////////////////////////////////////////////////////////////
+struct aggregation_t {
+
+  //! the number of consecutive ranks that share a writer
+  std::size_t ranks_per_writer = 0;
+
+  //! the number of writers on each node, this overrides ranks_per_writer
+  std::size_t writers_per_node = 0;
+
+  //! \brief return true if the output should be aggregated
+  bool enabled() const
+  { return ranks_per_writer > 0 || writers_per_node > 0; }
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief One entry of the global id index.
+///////////////////////////////////////////////////////////////////////////////
+struct aggregate_index_t {
+  //! the global id
+  std::uint64_t id;
+  //! the file offset of the slice holding the id
+  std::uint64_t offset;
+  //! the position of the id within the slice
+  std::uint64_t position;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief One entry of the slice table.
+///////////////////////////////////////////////////////////////////////////////
+struct aggregate_slice_t {
+  //! the rank the slice came from
+  std::uint64_t source;
+  //! the file offset of the slice
+  std::uint64_t offset;
+  //! the size of the slice in bytes
+  std::uint64_t size;
+  //! the number of ids in the slice
+  std::uint64_t num_ids;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief An aggregated write that is still in flight.
+///
+/// It owns the buffers of its messages, so the caller can go on computing
+/// while they are sent.  The writer only posts its receives once the sizes
+/// have arrived, and writes the file when the write is waited on.  MPI only
+/// makes progress inside MPI calls, so a long computation between the post
+/// and the wait can be overlapped with test().
+////////////////////////////////////////////////////////////////////////////////
+class aggregate_write_t {
+
+public:
+
+  //! \brief An empty handle, with nothing in flight.
+  aggregate_write_t() = default;
+
+  //! \brief Take over the messages of another handle.
+  aggregate_write_t( aggregate_write_t && other )
+  { *this = std::move( other ); }
+
+  //! \brief Complete the write in flight, and take over the messages of
+  //!        another handle.
+  aggregate_write_t & operator=( aggregate_write_t && other )
+  {
+    if ( this == &other ) return *this;
+    wait();
+    group_ = other.group_;
+    group_size_ = other.group_size_;
+    is_writer_ = other.is_writer_;
+    filename_ = std::move( other.filename_ );
+    iteration_ = other.iteration_;
+    time_ = other.time_;
+    // moving the vectors keeps their storage, which the requests point to
+    mine_ = std::move( other.mine_ );
+    sizes_ = std::move( other.sizes_ );
+    recv_ = std::move( other.recv_ );
+    sources_ = std::move( other.sources_ );
+    gather_ = other.gather_;
+    send_ = other.send_;
+    requests_ = std::move( other.requests_ );
+    receiving_ = other.receiving_;
+    pending_ = other.pending_;
+    other.gather_ = MPI_REQUEST_NULL;
+    other.send_ = MPI_REQUEST_NULL;
+    other.pending_ = false;
+    return *this;
+  }
+
+  //! the messages can only have one owner
+  aggregate_write_t( const aggregate_write_t & ) = delete;
+  aggregate_write_t & operator=( const aggregate_write_t & ) = delete;
+
+  //! \brief Complete the write in flight, unless MPI is already gone.
+  ~aggregate_write_t()
+  {
+    int finalized;
+    MPI_Finalized( &finalized );
+    if ( !finalized ) wait();
+  }
+
+  //! \brief Return true if the write is still in flight.
+  bool pending() const
+  { return pending_; }
+
+  //! \brief Make progress without blocking.
+  //!
+  //! The writer posts its receives once the sizes are in, but only writes
+  //! the file in wait().
+  //!
+  //! \return true if every message is complete
+  bool test()
+  {
+    if ( !pending_ ) return true;
+    int done;
+    if ( is_writer_ && !receiving_ ) {
+      MPI_Test( &gather_, &done, MPI_STATUS_IGNORE );
+      if ( !done ) return false;
+      post_receives();
+    }
+    if ( is_writer_ ) {
+      MPI_Testall(
+        requests_.size(), requests_.data(), &done, MPI_STATUSES_IGNORE
+      );
+      return done;
+    }
+    MPI_Request requests[2] = { gather_, send_ };
+    MPI_Testall( 2, requests, &done, MPI_STATUSES_IGNORE );
+    gather_ = requests[0];
+    send_ = requests[1];
+    return done;
+  }
+
+  //! \brief Complete the write, and on the writer write the file.
+  void wait()
+  {
+    if ( !pending_ ) return;
+    MPI_Wait( &gather_, MPI_STATUS_IGNORE );
+    if ( is_writer_ ) {
+      if ( !receiving_ ) post_receives();
+      MPI_Waitall( requests_.size(), requests_.data(), MPI_STATUSES_IGNORE );
+      write_file( filename_, iteration_, time_, recv_, sources_ );
+    }
+    else {
+      MPI_Wait( &send_, MPI_STATUS_IGNORE );
+    }
+    pending_ = false;
+    recv_.clear();
+    requests_.clear();
+  }
+
+private:
+
+  friend class aggregator_t;
+
+  //! \brief post the receives of the writer, once the sizes are known
+  void post_receives()
+  {
+    requests_.resize( group_size_-1 );
+    for ( int r=1; r<group_size_; ++r ) {
+      recv_[r].resize( sizes_[2*r] );
+      sources_[r] = sizes_[2*r+1];
+      MPI_Irecv(
+        recv_[r].data(), recv_[r].size(), MPI_BYTE, r, tag, group_,
+        &requests_[r-1]
+      );
+    }
+    receiving_ = true;
+  }
+
+  //! \brief write the received slices to disk
+  static void write_file(
+    const std::string & filename,
+    std::size_t iteration,
+    double time,
+    const std::vector< std::vector<byte_t> > & recv,
+    const std::vector<std::uint64_t> & sources
+  ) {
+    auto num_slices = recv.size();
+
+    // split each slice into its ids and its records
+    std::vector<aggregate_slice_t> slices( num_slices );
+    std::vector<aggregate_index_t> index;
+
+    for ( std::size_t s=0; s<num_slices; ++s ) {
+      const auto * ip = recv[s].data();
+      const auto * end = ip + recv[s].size();
+      auto num_ids = detail::read_value<std::uint64_t>( ip, end );
+      slices[s].source = sources[s];
+      slices[s].num_ids = num_ids;
+      slices[s].size = recv[s].size() - sizeof(std::uint64_t) -
+        num_ids * sizeof(std::uint64_t);
+      for ( std::uint64_t i=0; i<num_ids; ++i )
+        index.push_back( { detail::read_value<std::uint64_t>( ip, end ), s, i } );
+    }
+
+    // lay out the file
+    std::uint64_t offset = sizeof(aggregate_file_magic) +
+      3*sizeof(std::uint64_t) + num_slices*sizeof(aggregate_slice_t) +
+      sizeof(std::uint64_t) + index.size()*sizeof(aggregate_index_t);
+    for ( auto & s : slices ) {
+      s.offset = offset;
+      offset += s.size;
+    }
+
+    // the index stores file offsets, and is sorted for binary searches
+    for ( auto & i : index ) i.offset = slices[i.offset].offset;
+    std::sort( index.begin(), index.end(),
+      []( const auto & a, const auto & b ) { return a.id < b.id; } );
+
+    std::vector<byte_t> header(
+      aggregate_file_magic, aggregate_file_magic + sizeof(aggregate_file_magic)
+    );
+    detail::write_value<std::uint64_t>( iteration, header );
+    detail::write_value<double>( time, header );
+    detail::write_value<std::uint64_t>( num_slices, header );
+    for ( const auto & s : slices ) detail::write_value( s, header );
+    detail::write_value<std::uint64_t>( index.size(), header );
+    auto index_bytes = reinterpret_cast<const byte_t *>( index.data() );
+    header.insert( header.end(), index_bytes,
+      index_bytes + index.size()*sizeof(aggregate_index_t) );
+
+    std::ofstream file( filename, std::ios::out | std::ios::binary );
+    if ( !file.good() )
+      THROW_RUNTIME_ERROR( "Could not open \"" << filename << "\"" );
+    file.write( reinterpret_cast<const char*>(header.data()), header.size() );
+    for ( std::size_t s=0; s<num_slices; ++s ) {
+      auto start = recv[s].size() - slices[s].size;
+      file.write(
+        reinterpret_cast<const char*>(recv[s].data() + start), slices[s].size
+      );
+    }
+  }
+
+  //! the message tag
+  static constexpr int tag = 2718;
+
+  //! the writer group, owned by the aggregator
+  MPI_Comm group_ = MPI_COMM_NULL;
+  //! the size of the group
+  int group_size_ = 1;
+  //! true on the writer
+  bool is_writer_ = false;
+
+  //! the file the writer writes
+  std::string filename_;
+  //! the iteration
+  std::size_t iteration_ = 0;
+  //! the solution time
+  double time_ = 0;
+
+  //! the size of this rank's slice, and the rank
+  std::vector<std::uint64_t> mine_;
+  //! the sizes and ranks of the whole group, on the writer
+  std::vector<std::uint64_t> sizes_;
+  //! the slices, the first one is this rank's, and the only one on a sender
+  std::vector< std::vector<byte_t> > recv_;
+  //! the rank each slice came from
+  std::vector<std::uint64_t> sources_;
+
+  //! the gather of the sizes
+  MPI_Request gather_ = MPI_REQUEST_NULL;
+  //! the send of the slice, on a sender
+  MPI_Request send_ = MPI_REQUEST_NULL;
+  //! the receives of the slices, on the writer
+  std::vector<MPI_Request> requests_;
+  //! true once the writer posted its receives
+  bool receiving_ = false;
+  //! true until the write is complete
+  bool pending_ = false;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Send the field records of each rank to a writer rank.
+///
+/// The aggregator works on its own copy of the communicator, so its
+/// messages never mix with any other use of it.  All the ranks of the
+/// communicator have to call it in the same order, so inside a task it
+/// needs a launch that maps one point to each rank, like an MPI task.  A
+/// write can be left in flight while the ranks go on computing, see post.
+////////////////////////////////////////////////////////////////////////////////
+class aggregator_t {
+
+public:
+
+  //! \brief Split the ranks into writer groups.
+  //! \param [in] comm  The communicator of all the ranks that output.
+  //! \param [in] opts  How the ranks are assigned to writers.
+  aggregator_t( MPI_Comm comm, const aggregation_t & opts )
+  {
+    // keep the messages apart from any other use of the communicator
+    MPI_Comm_dup( comm, &comm );
+    MPI_Comm_rank( comm, &rank_ );
+
+    if ( opts.writers_per_node > 0 ) {
+      // group the ranks of each node
+      MPI_Comm node;
+      MPI_Comm_split_type(
+        comm, MPI_COMM_TYPE_SHARED, rank_, MPI_INFO_NULL, &node
+      );
+      int node_rank, node_size;
+      MPI_Comm_rank( node, &node_rank );
+      MPI_Comm_size( node, &node_size );
+      auto num_writers = std::min<int>( opts.writers_per_node, node_size );
+      auto color = node_rank * num_writers / node_size;
+      MPI_Comm_split( node, color, node_rank, &group_ );
+      MPI_Comm_free( &node );
+    }
+    else {
+      // group consecutive ranks
+      auto ratio = std::max<int>( opts.ranks_per_writer, 1 );
+      MPI_Comm_split( comm, rank_ / ratio, rank_, &group_ );
+    }
+    MPI_Comm_free( &comm );
+
+    MPI_Comm_rank( group_, &group_rank_ );
+    MPI_Comm_size( group_, &group_size_ );
+
+    writer_ = rank_;
+    MPI_Bcast( &writer_, 1, MPI_INT, 0, group_ );
+  }
+
+  //! \brief Release the group.
+  ~aggregator_t()
+  {
+    int finalized;
+    MPI_Finalized( &finalized );
+    if ( finalized ) return;
+    MPI_Comm_free( &group_ );
+  }
+
+  //! the aggregator owns a communicator, so it cannot be copied
+  aggregator_t( const aggregator_t & ) = delete;
+  aggregator_t & operator=( const aggregator_t & ) = delete;
+
+  //! \brief Return true if this rank writes files.
+  bool is_writer() const
+  { return group_rank_ == 0; }
+
+  //! \brief Return the rank of this rank's writer.
+  int writer_rank() const
+  { return writer_; }
+
+  //! \brief Return the number of ranks sharing this rank's writer.
+  int group_size() const
+  { return group_size_; }
+
+  //! \brief Start sending this rank's slice to its writer.
+  //!
+  //! This is collective over the writer group, and does not block.  The
+  //! writes of a group complete in the order they were posted, and the
+  //! aggregator has to outlive the returned handle.
+  //!
+  //! \param [in] filename  The file the writer should write.
+  //! \param [in] iteration  The current iteration.
+  //! \param [in] time  The current solution time.
+  //! \param [in] ids  The global id of each entity in the slice.
+  //! \param [in] records  The compressed fields of the slice.
+  //! \return the write in flight, wait on it to complete it
+  aggregate_write_t post(
+    const std::string & filename,
+    std::size_t iteration,
+    double time,
+    const std::vector<std::uint64_t> & ids,
+    const field_records_t & records
+  ) {
+    aggregate_write_t pending;
+    pending.group_ = group_;
+    pending.group_size_ = group_size_;
+    pending.is_writer_ = is_writer();
+    pending.filename_ = filename;
+    pending.iteration_ = iteration;
+    pending.time_ = time;
+    pending.pending_ = true;
+
+    // pack the slice: the ids, then the records
+    pending.recv_.resize( is_writer() ? group_size_ : 1 );
+    pending.sources_.resize( pending.recv_.size() );
+    auto & send = pending.recv_[0];
+    detail::write_value<std::uint64_t>( ids.size(), send );
+    auto id_bytes = reinterpret_cast<const byte_t *>( ids.data() );
+    send.insert( send.end(), id_bytes, id_bytes + ids.size()*sizeof(ids[0]) );
+    send.insert( send.end(), records.bytes().begin(), records.bytes().end() );
+    pending.sources_[0] = rank_;
+
+    // the writer needs to know how much is coming, and from whom
+    pending.mine_ = { send.size(), static_cast<std::uint64_t>(rank_) };
+    pending.sizes_.resize( is_writer() ? 2*group_size_ : 0 );
+    MPI_Igather(
+      pending.mine_.data(), 2, MPI_UINT64_T, pending.sizes_.data(), 2,
+      MPI_UINT64_T, 0, group_, &pending.gather_
+    );
+
+    if ( !is_writer() )
+      MPI_Isend(
+        send.data(), send.size(), MPI_BYTE, 0, aggregate_write_t::tag,
+        group_, &pending.send_
+      );
+
+    return pending;
+  }
+
+  //! \brief Send this rank's slice to its writer, which writes the file.
+  //!
+  //! The same as post, but returns once the slice is sent and, on the
+  //! writer, once the file is written.
+  void write(
+    const std::string & filename,
+    std::size_t iteration,
+    double time,
+    const std::vector<std::uint64_t> & ids,
+    const field_records_t & records
+  ) {
+    post( filename, iteration, time, ids, records ).wait();
+  }
+
+private:
+
+  //! the writer group
+  MPI_Comm group_ = MPI_COMM_NULL;
+  //! this rank in the original communicator, and in the group
+  int rank_ = 0;
+  int group_rank_ = 0;
+  //! the size of the group
+  int group_size_ = 1;
+  //! the rank of the writer in the original communicator
+  int writer_ = 0;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Read an aggregated field file.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+class aggregate_file_reader_u {
+
+public:
+
+  //! a decompressed field
+  using field_t = field_u<T>;
+  //! the fields of one slice, keyed by name
+  using slice_fields_t = std::map<std::string, field_t>;
+
+  //! \brief Read an aggregated file.
+  //! \param [in] filename  The name of the file to read.
+  explicit aggregate_file_reader_u( const std::string & filename )
+  {
+    std::ifstream file( filename, std::ios::in | std::ios::binary );
+    if ( !file.good() )
+      THROW_RUNTIME_ERROR( "Could not open \"" << filename << "\"" );
+
+    std::vector<byte_t> buf(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+    );
+
+    const auto * start = buf.data();
+    const auto * ip = start;
+    const auto * end = ip + buf.size();
+
+    if ( buf.size() < sizeof(aggregate_file_magic) ||
+         std::memcmp( ip, aggregate_file_magic, sizeof(aggregate_file_magic) ) )
+      THROW_RUNTIME_ERROR( "\"" << filename << "\" is not an aggregated file" );
+    ip += sizeof(aggregate_file_magic);
+
+    iteration_ = detail::read_value<std::uint64_t>( ip, end );
+    time_ = detail::read_value<double>( ip, end );
+
+    slices_.resize( detail::read_value<std::uint64_t>( ip, end ) );
+    for ( auto & s : slices_ )
+      s = detail::read_value<aggregate_slice_t>( ip, end );
+
+    index_.resize( detail::read_value<std::uint64_t>( ip, end ) );
+    for ( auto & i : index_ )
+      i = detail::read_value<aggregate_index_t>( ip, end );
+
+    fields_.resize( slices_.size() );
+    for ( std::size_t s=0; s<slices_.size(); ++s ) {
+      const auto & slice = slices_[s];
+      if ( slice.offset + slice.size > buf.size() )
+        THROW_RUNTIME_ERROR( "Truncated aggregated file" );
+      read_field_records(
+        start + slice.offset, start + slice.offset + slice.size, fields_[s]
+      );
+      slice_of_offset_[slice.offset] = s;
+    }
+  }
+
+  //! \brief Return the iteration stored in the file.
+  std::size_t iteration() const
+  { return iteration_; }
+
+  //! \brief Return the time stored in the file.
+  double time() const
+  { return time_; }
+
+  //! \brief Return the slice table.
+  const auto & slices() const
+  { return slices_; }
+
+  //! \brief Return the fields of a slice.
+  const slice_fields_t & fields( std::size_t slice ) const
+  { return fields_.at(slice); }
+
+  //! \brief Return the value of a field for a global id.
+  //! \param [in] name  The field name.
+  //! \param [in] id  The global id.
+  //! \param [in] component  The component to return.
+  T value( const std::string & name, std::uint64_t id, std::size_t component = 0 )
+    const
+  {
+    auto it = std::lower_bound( index_.begin(), index_.end(), id,
+      []( const auto & a, auto b ) { return a.id < b; } );
+    if ( it == index_.end() || it->id != id )
+      THROW_RUNTIME_ERROR( "No global id " << id << " in file" );
+    auto s = slice_of_offset_.at( it->offset );
+    const auto & f = fields_[s].at( name );
+    return f.values.at( it->position * f.components + component );
+  }
+
+private:
+
+  //! the iteration
+  std::size_t iteration_ = 0;
+  //! the solution time
+  double time_ = 0;
+  //! the slice table
+  std::vector<aggregate_slice_t> slices_;
+  //! the global id index
+  std::vector<aggregate_index_t> index_;
+  //! the fields of each slice
+  std::vector<slice_fields_t> fields_;
+  //! map slice file offsets back to slices
+  std::map<std::uint64_t, std::size_t> slice_of_offset_;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,362 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Lossless and error-bounded lossy compression of field data.
+///
+/// Each compressed field is a self describing block: a small header
+/// followed by the payload.  The lossless mode byte-shuffles the elements
+/// and runs them through an lz coder.  The lossy mode quantizes floating
+/// point values onto a uniform grid whose spacing guarantees the
+/// requested error bound, delta encodes the integers, and lz compresses
+/// them.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "detail/compression_impl.h"
+
+// system includes
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace flecsale {
+namespace io {
+
+//! the byte type used by the compressed blocks
+using detail::byte_t;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The compression modes.
+///////////////////////////////////////////////////////////////////////////////
+enum class compression_mode_t : std::uint8_t
+{
+  none = 0,
+  lossless = 1,
+  lossy = 2
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Convert a string to a compression mode.
+///////////////////////////////////////////////////////////////////////////////
+inline compression_mode_t compression_mode( const std::string & name )
+{
+  if ( name == "none" )
+    return compression_mode_t::none;
+  else if ( name == "lossless" )
+    return compression_mode_t::lossless;
+  else if ( name == "lossy" )
+    return compression_mode_t::lossy;
+  else
+    THROW_RUNTIME_ERROR( "Unknown compression mode \"" << name << "\"" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The compression settings of one field.
+///////////////////////////////////////////////////////////////////////////////
+struct compression_t {
+
+  //! the compression mode
+  compression_mode_t mode = compression_mode_t::lossless;
+
+  //! the maximum absolute error of the lossy mode
+  double absolute = 0;
+
+  //! the maximum error of the lossy mode, relative to the range of the data
+  double relative = 0;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief The header of a compressed block.
+///////////////////////////////////////////////////////////////////////////////
+struct block_header_t {
+
+  //! the compression mode used
+  compression_mode_t mode = compression_mode_t::none;
+  //! the size of each element in bytes
+  std::uint8_t elem_size = 0;
+  //! the number of interleaved components
+  std::uint32_t stride = 1;
+  //! the number of elements
+  std::uint64_t count = 0;
+  //! the quantization step of the lossy mode
+  double quantum = 0;
+  //! the size of the payload once decompressed
+  std::uint64_t raw_size = 0;
+  //! the size of the payload
+  std::uint64_t payload_size = 0;
+
+};
+
+//! the magic bytes at the start of every block
+static constexpr char block_magic[4] = {'F','L','Z','B'};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Read the header of a compressed block.
+///
+/// \param [in,out] ip  The start of the block, advanced past the header.
+/// \param [in] end  The end of the stream.
+////////////////////////////////////////////////////////////////////////////////
+inline block_header_t read_block_header( const byte_t *& ip, const byte_t * end )
+{
+  if ( ip + sizeof(block_magic) > end ||
+       std::memcmp( ip, block_magic, sizeof(block_magic) ) != 0 )
+    THROW_RUNTIME_ERROR( "Not a compressed block" );
+  ip += sizeof(block_magic);
+
+  block_header_t h;
+  h.mode = detail::read_value<compression_mode_t>( ip, end );
+  h.elem_size = detail::read_value<std::uint8_t>( ip, end );
+  h.stride = detail::read_value<std::uint32_t>( ip, end );
+  h.count = detail::read_value<std::uint64_t>( ip, end );
+  h.quantum = detail::read_value<double>( ip, end );
+  h.raw_size = detail::read_value<std::uint64_t>( ip, end );
+  h.payload_size = detail::read_value<std::uint64_t>( ip, end );
+  return h;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Append the header of a compressed block.
+////////////////////////////////////////////////////////////////////////////////
+inline void write_block_header(
+  const block_header_t & h, std::vector<byte_t> & out
+) {
+  out.insert( out.end(), block_magic, block_magic + sizeof(block_magic) );
+  detail::write_value( h.mode, out );
+  detail::write_value( h.elem_size, out );
+  detail::write_value( h.stride, out );
+  detail::write_value( h.count, out );
+  detail::write_value( h.quantum, out );
+  detail::write_value( h.raw_size, out );
+  detail::write_value( h.payload_size, out );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Compute the lossy quantization step for some data.
+///
+/// \param [in] data  The values to compress.
+/// \param [in] n  The number of values.
+/// \param [in] opts  The compression settings.
+/// \return The quantization step, or zero if the data cannot be quantized
+///         and has to be stored losslessly.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+double lossy_quantum( const T * data, std::size_t n, const compression_t & opts )
+{
+  if ( n == 0 ) return 0;
+
+  auto lo = std::numeric_limits<double>::max();
+  auto hi = std::numeric_limits<double>::lowest();
+  for ( std::size_t i=0; i<n; ++i ) {
+    if ( !std::isfinite(data[i]) ) return 0;
+    lo = std::min<double>( lo, data[i] );
+    hi = std::max<double>( hi, data[i] );
+  }
+
+  auto tol = std::numeric_limits<double>::max();
+  if ( opts.absolute > 0 ) tol = opts.absolute;
+  if ( opts.relative > 0 ) tol = std::min( tol, opts.relative * (hi - lo) );
+  if ( !( tol > 0 ) || tol == std::numeric_limits<double>::max() ) return 0;
+
+  // the integers have to fit in 63 bits
+  auto mag = std::max( std::abs(lo), std::abs(hi) );
+  if ( mag / (2*tol) > 0x1p62 ) return 0;
+
+  return 2 * tol;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Compress an array of values.
+///
+/// \param [in] data  The values to compress.
+/// \param [in] n  The number of values.
+/// \param [in] opts  The compression settings.
+/// \param [in] stride  The number of interleaved components, e.g. the
+///                     number of dimensions of a vector field.
+/// \param [in,out] out  The compressed block is appended here.
+///
+/// The lossy mode is only available for floating point data.  It falls back
+/// to the lossless mode when the data contains non-finite values or when
+/// the error bound cannot be met.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void compress(
+  const T * data,
+  std::size_t n,
+  const compression_t & opts,
+  std::size_t stride,
+  std::vector<byte_t> & out
+) {
+
+  static_assert( std::is_trivially_copyable<T>::value,
+    "only trivially copyable types can be compressed" );
+
+  block_header_t h;
+  h.mode = opts.mode;
+  h.elem_size = sizeof(T);
+  h.stride = stride;
+  h.count = n;
+
+  auto bytes = reinterpret_cast<const byte_t *>( data );
+  std::vector<byte_t> raw;
+
+  //---------------------------------------------------------------------------
+  // Lossy: quantize and delta encode
+  if ( h.mode == compression_mode_t::lossy ) {
+
+    if constexpr ( std::is_floating_point<T>::value ) {
+
+      h.quantum = lossy_quantum( data, n, opts );
+      auto tol = h.quantum / 2;
+
+      std::vector<std::int64_t> q( n );
+      for ( std::size_t i=0; h.quantum > 0 && i<n; ++i ) {
+        q[i] = std::llround( data[i] / h.quantum );
+        // make sure the bound holds after rounding
+        T x = q[i] * h.quantum;
+        if ( std::abs( x - data[i] ) > tol ) h.quantum = 0;
+      }
+
+      if ( h.quantum > 0 ) {
+        raw.reserve( n );
+        for ( std::size_t i=0; i<n; ++i ) {
+          auto prev = i >= stride ? q[i-stride] : 0;
+          detail::write_varint( q[i] - prev, raw );
+        }
+      }
+
+    }
+
+    if ( h.quantum == 0 ) h.mode = compression_mode_t::lossless;
+
+  }
+
+  //---------------------------------------------------------------------------
+  // Lossless: shuffle the bytes
+  if ( h.mode == compression_mode_t::lossless ) {
+    raw.resize( n * sizeof(T) );
+    detail::shuffle( bytes, n, sizeof(T), raw.data() );
+  }
+
+  //---------------------------------------------------------------------------
+  // Write the block
+  std::vector<byte_t> payload;
+  if ( h.mode == compression_mode_t::none ) {
+    h.raw_size = n * sizeof(T);
+    payload.assign( bytes, bytes + h.raw_size );
+  }
+  else {
+    h.raw_size = raw.size();
+    detail::lz_compress( raw.data(), raw.size(), payload );
+  }
+
+  h.payload_size = payload.size();
+  write_block_header( h, out );
+  out.insert( out.end(), payload.begin(), payload.end() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Compress an array of values.
+/// \return The compressed block.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+std::vector<byte_t> compress(
+  const T * data,
+  std::size_t n,
+  const compression_t & opts,
+  std::size_t stride = 1
+) {
+  std::vector<byte_t> out;
+  compress( data, n, opts, stride, out );
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Decompress a block.
+///
+/// \param [in,out] ip  The start of the block, advanced past its end.
+/// \param [in] end  The end of the stream.
+/// \param [out] h  The block header.
+/// \return The decompressed values.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+std::vector<T> decompress(
+  const byte_t *& ip, const byte_t * end, block_header_t & h
+) {
+
+  h = read_block_header( ip, end );
+
+  if ( h.elem_size != sizeof(T) )
+    THROW_RUNTIME_ERROR(
+      "Block holds " << static_cast<int>(h.elem_size) << " byte elements, "
+      "expected " << sizeof(T)
+    );
+  if ( ip + h.payload_size > end )
+    THROW_RUNTIME_ERROR( "Truncated compressed block" );
+
+  const auto * payload = ip;
+  ip += h.payload_size;
+
+  std::vector<T> values( h.count );
+  auto bytes = reinterpret_cast<byte_t *>( values.data() );
+
+  if ( h.mode == compression_mode_t::none ) {
+    if ( h.payload_size != h.count * sizeof(T) )
+      THROW_RUNTIME_ERROR( "Corrupt compressed block" );
+    std::memcpy( bytes, payload, h.payload_size );
+    return values;
+  }
+
+  std::vector<byte_t> raw;
+  detail::lz_decompress( payload, h.payload_size, h.raw_size, raw );
+
+  if ( h.mode == compression_mode_t::lossless ) {
+    if ( raw.size() != h.count * sizeof(T) )
+      THROW_RUNTIME_ERROR( "Corrupt compressed block" );
+    detail::unshuffle( raw.data(), h.count, sizeof(T), bytes );
+  }
+  else if ( h.mode == compression_mode_t::lossy ) {
+    if constexpr ( std::is_floating_point<T>::value ) {
+      std::vector<std::int64_t> q( h.count );
+      const auto * rp = raw.data();
+      const auto * rend = rp + raw.size();
+      for ( std::size_t i=0; i<h.count; ++i ) {
+        auto prev = i >= h.stride ? q[i-h.stride] : 0;
+        q[i] = prev + detail::read_varint( rp, rend );
+        values[i] = q[i] * h.quantum;
+      }
+    }
+    else {
+      THROW_RUNTIME_ERROR( "Lossy blocks can only hold floating point data" );
+    }
+  }
+  else {
+    THROW_RUNTIME_ERROR( "Unknown compression mode" );
+  }
+
+  return values;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Decompress a block.
+/// \return The decompressed values.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+std::vector<T> decompress( const std::vector<byte_t> & block )
+{
+  const auto * ip = block.data();
+  block_header_t h;
+  return decompress<T>( ip, ip + block.size(), h );
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,311 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief The building blocks of the field compressors.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include <ristra/assertions/errors.h>
+
+// system includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace flecsale {
+namespace io {
+namespace detail {
+
+//! the byte type used by all the codecs
+using byte_t = std::uint8_t;
+
+//! the minimum match length of the lz coder
+static constexpr std::size_t lz_min_match = 4;
+
+//! the maximum match offset of the lz coder
+static constexpr std::size_t lz_max_offset = 65535;
+
+//! the number of bits used to hash the lz dictionary
+static constexpr std::size_t lz_hash_bits = 14;
+
+///////////////////////////////////////////////////////////////////
+/// \brief Transpose the bytes of an array of elements.
+///
+/// All the first bytes of each element are stored first, then all the
+/// second bytes, and so on.  The sign and exponent bytes of smooth
+/// floating point data then end up next to each other, which makes them
+/// much easier to compress.
+///
+/// \param [in] in  The input bytes.
+/// \param [in] num_elem  The number of elements.
+/// \param [in] elem_size  The size of each element in bytes.
+/// \param [out] out  The shuffled bytes.
+///////////////////////////////////////////////////////////////////
+inline void shuffle(
+  const byte_t * in,
+  std::size_t num_elem,
+  std::size_t elem_size,
+  byte_t * out
+) {
+  for ( std::size_t i=0; i<num_elem; ++i )
+    for ( std::size_t b=0; b<elem_size; ++b )
+      out[ b*num_elem + i ] = in[ i*elem_size + b ];
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Undo a byte shuffle.
+/// \see shuffle
+///////////////////////////////////////////////////////////////////
+inline void unshuffle(
+  const byte_t * in,
+  std::size_t num_elem,
+  std::size_t elem_size,
+  byte_t * out
+) {
+  for ( std::size_t i=0; i<num_elem; ++i )
+    for ( std::size_t b=0; b<elem_size; ++b )
+      out[ i*elem_size + b ] = in[ b*num_elem + i ];
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Append an lz length extension.
+///////////////////////////////////////////////////////////////////
+inline void lz_write_length( std::size_t len, std::vector<byte_t> & out )
+{
+  while ( len >= 255 ) {
+    out.push_back( 255 );
+    len -= 255;
+  }
+  out.push_back( static_cast<byte_t>(len) );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Read an lz length extension.
+///////////////////////////////////////////////////////////////////
+inline std::size_t lz_read_length( const byte_t *& ip, const byte_t * end )
+{
+  std::size_t len = 0;
+  byte_t b;
+  do {
+    if ( ip >= end ) THROW_RUNTIME_ERROR( "Truncated lz stream" );
+    b = *ip++;
+    len += b;
+  } while ( b == 255 );
+  return len;
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Append one lz sequence: a run of literals followed by a match.
+///
+/// \param [in] lit  The start of the literals.
+/// \param [in] num_lit  The number of literals.
+/// \param [in] offset  The distance back to the match.
+/// \param [in] match_len  The length of the match, zero for the last
+///                        sequence, which has no match.
+/// \param [in,out] out  The output stream.
+///////////////////////////////////////////////////////////////////
+inline void lz_write_sequence(
+  const byte_t * lit,
+  std::size_t num_lit,
+  std::size_t offset,
+  std::size_t match_len,
+  std::vector<byte_t> & out
+) {
+  auto has_match = match_len > 0;
+  auto mlen = has_match ? match_len - lz_min_match : 0;
+
+  byte_t token = ( std::min<std::size_t>( num_lit, 15 ) << 4 ) |
+    std::min<std::size_t>( mlen, 15 );
+  out.push_back( token );
+
+  if ( num_lit >= 15 ) lz_write_length( num_lit - 15, out );
+  out.insert( out.end(), lit, lit + num_lit );
+
+  if ( !has_match ) return;
+
+  out.push_back( static_cast<byte_t>( offset & 0xff ) );
+  out.push_back( static_cast<byte_t>( offset >> 8 ) );
+  if ( mlen >= 15 ) lz_write_length( mlen - 15, out );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Compress a byte stream with a greedy lz77 coder.
+///
+/// The format follows the lz4 block layout: each sequence is a token byte
+/// holding the literal and match lengths, optional length extensions, the
+/// literals, and a two byte match offset.  The last sequence only has
+/// literals.
+///
+/// \param [in] in  The bytes to compress.
+/// \param [in] n  The number of bytes.
+/// \param [in,out] out  The compressed bytes are appended here.
+///////////////////////////////////////////////////////////////////
+inline void lz_compress(
+  const byte_t * in, std::size_t n, std::vector<byte_t> & out
+) {
+  constexpr std::size_t table_size = 1 << lz_hash_bits;
+  std::vector<std::int64_t> table( table_size, -1 );
+
+  auto read32 = [in]( std::size_t i ) {
+    std::uint32_t v;
+    std::memcpy( &v, in+i, sizeof(v) );
+    return v;
+  };
+  auto hash = []( std::uint32_t v ) {
+    return ( v * 2654435761u ) >> ( 32 - lz_hash_bits );
+  };
+
+  std::size_t anchor = 0;
+  std::size_t i = 0;
+
+  while ( i + lz_min_match <= n ) {
+
+    auto seq = read32(i);
+    auto h = hash(seq);
+    auto cand = table[h];
+    table[h] = i;
+
+    if ( cand >= 0 && i - cand <= lz_max_offset && read32(cand) == seq ) {
+      // extend the match as far as it goes
+      std::size_t len = lz_min_match;
+      while ( i + len < n && in[cand + len] == in[i + len] ) ++len;
+      lz_write_sequence( in + anchor, i - anchor, i - cand, len, out );
+      i += len;
+      anchor = i;
+    }
+    else {
+      ++i;
+    }
+
+  }
+
+  // the trailing literals
+  lz_write_sequence( in + anchor, n - anchor, 0, 0, out );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Decompress a byte stream produced by lz_compress.
+///
+/// \param [in] in  The compressed bytes.
+/// \param [in] n  The number of compressed bytes.
+/// \param [in] raw_size  The expected number of decompressed bytes.
+/// \param [out] out  The decompressed bytes, resized to raw_size.
+///////////////////////////////////////////////////////////////////
+inline void lz_decompress(
+  const byte_t * in,
+  std::size_t n,
+  std::size_t raw_size,
+  std::vector<byte_t> & out
+) {
+  out.clear();
+  out.reserve( raw_size );
+
+  const auto * ip = in;
+  const auto * end = in + n;
+
+  while ( ip < end ) {
+
+    auto token = *ip++;
+
+    // literals
+    std::size_t num_lit = token >> 4;
+    if ( num_lit == 15 ) num_lit += lz_read_length( ip, end );
+    if ( ip + num_lit > end ) THROW_RUNTIME_ERROR( "Truncated lz stream" );
+    out.insert( out.end(), ip, ip + num_lit );
+    ip += num_lit;
+
+    // the last sequence has no match
+    if ( ip >= end ) break;
+
+    // the match
+    if ( ip + 2 > end ) THROW_RUNTIME_ERROR( "Truncated lz stream" );
+    std::size_t offset = ip[0] | ( ip[1] << 8 );
+    ip += 2;
+    std::size_t len = token & 0x0f;
+    if ( len == 15 ) len += lz_read_length( ip, end );
+    len += lz_min_match;
+
+    if ( offset == 0 || offset > out.size() )
+      THROW_RUNTIME_ERROR( "Corrupt lz stream" );
+
+    // matches may overlap the output, so copy byte by byte
+    auto start = out.size() - offset;
+    for ( std::size_t j=0; j<len; ++j )
+      out.push_back( out[start + j] );
+
+  }
+
+  if ( out.size() != raw_size )
+    THROW_RUNTIME_ERROR(
+      "Expected " << raw_size << " decompressed bytes, got " << out.size()
+    );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Append a zigzag, variable length encoded integer.
+///
+/// Small magnitudes, of either sign, use few bytes.
+///////////////////////////////////////////////////////////////////
+inline void write_varint( std::int64_t v, std::vector<byte_t> & out )
+{
+  auto u = ( static_cast<std::uint64_t>(v) << 1 ) ^
+    static_cast<std::uint64_t>( v >> 63 );
+  while ( u >= 0x80 ) {
+    out.push_back( static_cast<byte_t>( u | 0x80 ) );
+    u >>= 7;
+  }
+  out.push_back( static_cast<byte_t>(u) );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Read a zigzag, variable length encoded integer.
+/// \see write_varint
+///////////////////////////////////////////////////////////////////
+inline std::int64_t read_varint( const byte_t *& ip, const byte_t * end )
+{
+  std::uint64_t u = 0;
+  int shift = 0;
+  byte_t b;
+  do {
+    if ( ip >= end || shift > 63 ) THROW_RUNTIME_ERROR( "Corrupt varint" );
+    b = *ip++;
+    u |= static_cast<std::uint64_t>( b & 0x7f ) << shift;
+    shift += 7;
+  } while ( b & 0x80 );
+  return static_cast<std::int64_t>( u >> 1 ) ^ -static_cast<std::int64_t>( u & 1 );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Append a fixed size value to a byte stream.
+///////////////////////////////////////////////////////////////////
+template< typename T >
+void write_value( const T & v, std::vector<byte_t> & out )
+{
+  auto p = reinterpret_cast<const byte_t *>( &v );
+  out.insert( out.end(), p, p + sizeof(T) );
+}
+
+///////////////////////////////////////////////////////////////////
+/// \brief Read a fixed size value from a byte stream.
+///////////////////////////////////////////////////////////////////
+template< typename T >
+T read_value( const byte_t *& ip, const byte_t * end )
+{
+  if ( ip + sizeof(T) > end ) THROW_RUNTIME_ERROR( "Truncated stream" );
+  T v;
+  std::memcpy( &v, ip, sizeof(T) );
+  ip += sizeof(T);
+  return v;
+}
+
+} // namespace
+} // namespace
+} // namespace
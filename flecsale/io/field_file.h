@@ -0,0 +1,253 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief A simple binary container for compressed fields.
+///
+/// The file starts with a magic string, the iteration and the time.  It is
+/// followed by one record per field: the name, the number of components,
+/// and the compressed block.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// user includes
+#include "compression.h"
+
+// system includes
+#include <fstream>
+#include <map>
+#include <string>
+
+namespace flecsale {
+namespace io {
+
+//! the magic bytes at the start of every field file
+static constexpr char field_file_magic[8] = {'F','L','E','C','F','L','D','1'};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief An in-memory buffer of compressed field records.
+///
+/// This is the body of a field file, and the slice a rank sends to its
+/// writer when the output is aggregated.
+////////////////////////////////////////////////////////////////////////////////
+class field_records_t {
+
+public:
+
+  //! \brief Compress and append a field.
+  //! \param [in] name  The field name.
+  //! \param [in] data  The field values, with the components interleaved.
+  //! \param [in] n  The number of values.
+  //! \param [in] components  The number of components per entity.
+  //! \param [in] opts  The compression settings.
+  template< typename T >
+  void write(
+    const std::string & name,
+    const T * data,
+    std::size_t n,
+    std::size_t components,
+    const compression_t & opts
+  ) {
+    detail::write_value<std::uint32_t>( name.size(), bytes_ );
+    bytes_.insert( bytes_.end(), name.begin(), name.end() );
+    detail::write_value<std::uint32_t>( components, bytes_ );
+    compress( data, n, opts, components, bytes_ );
+  }
+
+  //! \brief Return the records.
+  const std::vector<byte_t> & bytes() const
+  { return bytes_; }
+
+  //! \brief Return the records, so they can be moved from.
+  std::vector<byte_t> & bytes()
+  { return bytes_; }
+
+  //! \brief Drop all the records.
+  void clear()
+  { bytes_.clear(); }
+
+private:
+
+  //! the records
+  std::vector<byte_t> bytes_;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Write compressed fields to a file.
+////////////////////////////////////////////////////////////////////////////////
+class field_file_writer_t {
+
+public:
+
+  //! \brief Open the file and write the header.
+  //! \param [in] filename  The name of the file to write.
+  //! \param [in] iteration  The current iteration.
+  //! \param [in] time  The current solution time.
+  field_file_writer_t(
+    const std::string & filename, std::size_t iteration, double time
+  ) {
+    file_.open( filename, std::ios::out | std::ios::binary );
+    if ( !file_.good() )
+      THROW_RUNTIME_ERROR( "Could not open \"" << filename << "\"" );
+
+    std::vector<byte_t> buf( field_file_magic,
+      field_file_magic + sizeof(field_file_magic) );
+    detail::write_value<std::uint64_t>( iteration, buf );
+    detail::write_value<double>( time, buf );
+    flush( buf );
+  }
+
+  //! \brief Compress and write a field.
+  //! \see field_records_t::write
+  template< typename T >
+  void write(
+    const std::string & name,
+    const T * data,
+    std::size_t n,
+    std::size_t components,
+    const compression_t & opts
+  ) {
+    records_.clear();
+    records_.write( name, data, n, components, opts );
+    flush( records_.bytes() );
+  }
+
+  //! \brief Write records that were already compressed.
+  void write_records( const field_records_t & records )
+  { flush( records.bytes() ); }
+
+  //! \brief Return the number of bytes written so far.
+  std::size_t bytes_written() const
+  { return bytes_; }
+
+private:
+
+  //! \brief write a buffer to disk
+  void flush( const std::vector<byte_t> & buf )
+  {
+    file_.write( reinterpret_cast<const char*>(buf.data()), buf.size() );
+    bytes_ += buf.size();
+  }
+
+  //! the output stream
+  std::ofstream file_;
+  //! a scratch buffer for the records
+  field_records_t records_;
+  //! the number of bytes written
+  std::size_t bytes_ = 0;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief A decompressed field.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+struct field_u {
+  //! the number of components per entity
+  std::size_t components = 1;
+  //! the values, with the components interleaved
+  std::vector<T> values;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Decompress a sequence of field records.
+///
+/// \param [in] ip  The start of the records.
+/// \param [in] end  The end of the records.
+/// \param [in,out] fields  The fields are added here, keyed by name.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+void read_field_records(
+  const byte_t * ip,
+  const byte_t * end,
+  std::map<std::string, field_u<T>> & fields
+) {
+  while ( ip < end ) {
+    auto len = detail::read_value<std::uint32_t>( ip, end );
+    if ( ip + len > end ) THROW_RUNTIME_ERROR( "Truncated field records" );
+    std::string name( reinterpret_cast<const char*>(ip), len );
+    ip += len;
+    auto & f = fields[name];
+    f.components = detail::read_value<std::uint32_t>( ip, end );
+    block_header_t h;
+    f.values = decompress<T>( ip, end, h );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Read all the fields of a compressed field file.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T >
+class field_file_reader_u {
+
+public:
+
+  //! a decompressed field
+  using field_t = field_u<T>;
+
+  //! \brief Read a field file.
+  //! \param [in] filename  The name of the file to read.
+  explicit field_file_reader_u( const std::string & filename )
+  {
+    std::ifstream file( filename, std::ios::in | std::ios::binary );
+    if ( !file.good() )
+      THROW_RUNTIME_ERROR( "Could not open \"" << filename << "\"" );
+
+    std::vector<byte_t> buf(
+      (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()
+    );
+
+    const auto * ip = buf.data();
+    const auto * end = ip + buf.size();
+
+    if ( buf.size() < sizeof(field_file_magic) ||
+         std::memcmp( ip, field_file_magic, sizeof(field_file_magic) ) != 0 )
+      THROW_RUNTIME_ERROR( "\"" << filename << "\" is not a field file" );
+    ip += sizeof(field_file_magic);
+
+    iteration_ = detail::read_value<std::uint64_t>( ip, end );
+    time_ = detail::read_value<double>( ip, end );
+
+    read_field_records( ip, end, fields_ );
+  }
+
+  //! \brief Return the iteration stored in the file.
+  std::size_t iteration() const
+  { return iteration_; }
+
+  //! \brief Return the time stored in the file.
+  double time() const
+  { return time_; }
+
+  //! \brief Return all the fields.
+  const auto & fields() const
+  { return fields_; }
+
+  //! \brief Return a field by name.
+  const field_t & field( const std::string & name ) const
+  {
+    auto it = fields_.find( name );
+    if ( it == fields_.end() )
+      THROW_RUNTIME_ERROR( "No field named \"" << name << "\"" );
+    return it->second;
+  }
+
+private:
+
+  //! the iteration
+  std::size_t iteration_ = 0;
+  //! the solution time
+  double time_ = 0;
+  //! the fields, keyed by name
+  std::map<std::string, field_t> fields_;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,108 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the aggregated output.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/io/aggregator.h>
+
+
+// explicitly use some stuff
+using std::vector;
+
+using namespace flecsale;
+using namespace flecsale::io;
+
+//! \brief write this rank's slice through an aggregator and read it back
+void check_aggregation( const aggregation_t & opts, const std::string & name )
+{
+  int rank, size;
+  MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+  MPI_Comm_size( MPI_COMM_WORLD, &size );
+
+  aggregator_t agg( MPI_COMM_WORLD, opts );
+
+  // each rank owns a few ids, stored backwards
+  constexpr std::size_t num_ids = 10;
+  vector<std::uint64_t> ids( num_ids );
+  vector<double> density( num_ids ), velocity( 2*num_ids );
+  for ( std::size_t i=0; i<num_ids; ++i ) {
+    ids[i] = rank*num_ids + (num_ids - i - 1);
+    density[i] = 0.5 * ids[i];
+    velocity[2*i] = ids[i];
+    velocity[2*i+1] = -1.0 * ids[i];
+  }
+
+  field_records_t records;
+  records.write( "density", density.data(), density.size(), 1, compression_t{} );
+  records.write( "velocity", velocity.data(), velocity.size(), 2, compression_t{} );
+
+  // write to the temporary directory, not the working one
+  const char * tmp_dir = std::getenv( "TMPDIR" );
+  auto filename = std::string( tmp_dir ? tmp_dir : "/tmp" ) + "/flecsale_" +
+    name + "_writer" + std::to_string( agg.writer_rank() ) + ".flz";
+
+  // the records can go once the write is posted, since it owns its buffers
+  auto pending = agg.post( filename, 7, 1.5, ids, records );
+  records = field_records_t();
+  pending.test();
+  pending.wait();
+  ASSERT_FALSE( pending.pending() );
+
+  MPI_Barrier( MPI_COMM_WORLD );
+
+  // every rank can find its own ids in its writer's file
+  aggregate_file_reader_u<double> file( filename );
+  ASSERT_EQ( 7, file.iteration() );
+  ASSERT_EQ( 1.5, file.time() );
+  ASSERT_EQ( agg.group_size(), file.slices().size() );
+  for ( auto id : ids ) {
+    ASSERT_EQ( 0.5 * id, file.value( "density", id ) );
+    ASSERT_EQ( 1.0 * id, file.value( "velocity", id, 0 ) );
+    ASSERT_EQ( -1.0 * id, file.value( "velocity", id, 1 ) );
+  }
+  ASSERT_THROW( file.value( "density", size*num_ids ), std::runtime_error );
+
+  // every rank is done reading, so the writers can remove their files
+  MPI_Barrier( MPI_COMM_WORLD );
+  if ( agg.is_writer() ) {
+    EXPECT_EQ( 0, std::remove( filename.c_str() ) );
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test aggregation with a fixed ratio of ranks per writer
+///////////////////////////////////////////////////////////////////////////////
+TEST(io, aggregate_ratio) {
+
+  aggregation_t opts;
+  opts.ranks_per_writer = 2;
+  check_aggregation( opts, "aggregate_ratio" );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test aggregation with one writer per node
+///////////////////////////////////////////////////////////////////////////////
+TEST(io, aggregate_node) {
+
+  aggregation_t opts;
+  opts.writers_per_node = 1;
+  check_aggregation( opts, "aggregate_node" );
+
+} // TEST
@@ -0,0 +1,156 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the field compressors.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// user includes
+#include <flecsale-config.h>
+#include <flecsale/io/compression.h>
+#include <flecsale/io/field_file.h>
+
+
+// explicitly use some stuff
+using std::vector;
+
+using namespace flecsale;
+using namespace flecsale::io;
+
+
+//! \brief build a smooth test field
+vector<double> smooth_field( std::size_t n )
+{
+  vector<double> x( n );
+  for ( std::size_t i=0; i<n; ++i ) x[i] = 2 + std::sin( 1.e-3 * i );
+  return x;
+}
+
+//! \brief return the largest pointwise difference
+double max_error( const vector<double> & a, const vector<double> & b )
+{
+  double err = 0;
+  for ( std::size_t i=0; i<a.size(); ++i )
+    err = std::max( err, std::abs( a[i] - b[i] ) );
+  return err;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the lossless mode
+///////////////////////////////////////////////////////////////////////////////
+TEST(io, lossless) {
+
+  compression_t opts;
+  opts.mode = compression_mode_t::lossless;
+
+  // smooth data is reproduced exactly, and shrinks
+  auto x = smooth_field( 10000 );
+  auto block = compress( x.data(), x.size(), opts );
+  ASSERT_EQ( x, decompress<double>( block ) );
+  ASSERT_LT( block.size(), x.size() * sizeof(double) );
+
+  // so is random data
+  std::mt19937 gen( 42 );
+  std::uniform_real_distribution<double> dist;
+  for ( auto & v : x ) v = dist( gen );
+  block = compress( x.data(), x.size(), opts );
+  ASSERT_EQ( x, decompress<double>( block ) );
+
+  // and integers
+  vector<std::size_t> ids( 1000 );
+  for ( std::size_t i=0; i<ids.size(); ++i ) ids[i] = 3*i;
+  auto id_block = compress( ids.data(), ids.size(), opts );
+  ASSERT_EQ( ids, decompress<std::size_t>( id_block ) );
+
+  // empty arrays work too
+  vector<double> empty;
+  block = compress( empty.data(), empty.size(), opts );
+  ASSERT_TRUE( decompress<double>( block ).empty() );
+
+  // the element size is checked
+  ASSERT_THROW( decompress<float>( block ), std::runtime_error );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the lossy mode
+///////////////////////////////////////////////////////////////////////////////
+TEST(io, lossy) {
+
+  auto x = smooth_field( 10000 );
+
+  compression_t lossless;
+  auto lossless_size = compress( x.data(), x.size(), lossless ).size();
+
+  // absolute tolerance
+  compression_t opts;
+  opts.mode = compression_mode_t::lossy;
+  opts.absolute = 1.e-6;
+  auto block = compress( x.data(), x.size(), opts );
+  ASSERT_LE( max_error( x, decompress<double>( block ) ), opts.absolute );
+  ASSERT_LT( block.size(), lossless_size );
+
+  // relative tolerance, the data spans a range of two
+  opts.absolute = 0;
+  opts.relative = 1.e-4;
+  block = compress( x.data(), x.size(), opts, 2 );
+  ASSERT_LE( max_error( x, decompress<double>( block ) ), 2.e-4 );
+
+  // non-finite values fall back to lossless
+  x[10] = std::numeric_limits<double>::infinity();
+  block = compress( x.data(), x.size(), opts );
+  ASSERT_EQ( x, decompress<double>( block ) );
+
+} // TEST
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test the field file container
+///////////////////////////////////////////////////////////////////////////////
+TEST(io, field_file) {
+
+  auto x = smooth_field( 1000 );
+
+  compression_t lossy;
+  lossy.mode = compression_mode_t::lossy;
+  lossy.absolute = 1.e-8;
+
+  // write to the temporary directory, not the working one
+  const char * tmp_dir = std::getenv( "TMPDIR" );
+  auto file_name =
+    std::string( tmp_dir ? tmp_dir : "/tmp" ) + "/flecsale_field_file.flz";
+
+  {
+    field_file_writer_t file( file_name, 12, 0.5 );
+    file.write( "density", x.data(), x.size(), 1, compression_t{} );
+    file.write( "velocity", x.data(), x.size(), 2, lossy );
+  }
+
+  {
+    field_file_reader_u<double> file( file_name );
+    EXPECT_EQ( 12, file.iteration() );
+    EXPECT_EQ( 0.5, file.time() );
+    EXPECT_EQ( 2, file.fields().size() );
+    EXPECT_EQ( x, file.field("density").values );
+    EXPECT_EQ( 2, file.field("velocity").components );
+    EXPECT_LE( max_error( x, file.field("velocity").values ), lossy.absolute );
+  }
+
+  // the reader is closed, so the file can go
+  EXPECT_EQ( 0, std::remove( file_name.c_str() ) );
+
+} // TEST
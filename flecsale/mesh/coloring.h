@@ -0,0 +1,111 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Color mesh entities so that their scatters do not conflict.
+///
+/// A loop over faces that adds each flux to the two cells of the face can
+/// not run in parallel as is, since two threads may write to the same cell.
+/// If the faces are split into colors, with no two faces of one color
+/// touching the same cell, the colors are processed one after the other and
+/// the faces of each color in parallel, without atomics.  The same goes for
+/// corners scattering into their vertex or cell.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace flecsale {
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief A partition of items into conflict free colors.
+//!
+//! Two items conflict when they scatter into a common target.  The colors
+//! are found greedily, each item taking the lowest color not used by any
+//! item sharing one of its targets.  This needs at most one color more than
+//! the largest number of items touching any target, for example a few
+//! colors for the faces of a quad or hex mesh.
+////////////////////////////////////////////////////////////////////////////////
+class coloring_t {
+
+public:
+
+  //! the id type
+  using id_t = std::size_t;
+
+  //! \brief return true once the colors have been found
+  bool is_built() const
+  { return !color_.empty(); }
+
+  //! \brief Color the items.
+  //! \param [in] num_items  The number of items.
+  //! \param [in] targets  A function returning the list of target ids that
+  //!                      an item, given by its index, scatters into.
+  template< typename T >
+  void build( std::size_t num_items, T && targets )
+  {
+    color_.assign( num_items, 0 );
+    items_.clear();
+
+    // the colors already taken around each target
+    std::vector< std::vector<id_t> > target_colors;
+    std::vector<bool> is_taken;
+
+    for ( std::size_t i=0; i<num_items; ++i ) {
+
+      // mark the colors of the neighbors
+      std::fill( is_taken.begin(), is_taken.end(), false );
+      for ( auto t : targets(i) ) {
+        id_t id = t;
+        if ( id >= target_colors.size() ) target_colors.resize( id+1 );
+        for ( auto c : target_colors[id] ) is_taken[c] = true;
+      }
+
+      // take the first free one
+      auto color = std::distance( is_taken.begin(),
+        std::find( is_taken.begin(), is_taken.end(), false ) );
+      if ( static_cast<std::size_t>(color) == is_taken.size() ) {
+        is_taken.emplace_back( false );
+        items_.emplace_back();
+      }
+
+      color_[i] = color;
+      items_[color].emplace_back( i );
+      for ( auto t : targets(i) )
+        target_colors[ static_cast<id_t>(t) ].emplace_back( color );
+
+    }
+  }
+
+  //! \brief the number of colors
+  std::size_t num_colors() const
+  { return items_.size(); }
+
+  //! \brief the color of an item
+  std::size_t color( id_t item ) const
+  { return color_[item]; }
+
+  //! \brief the items of one color, in increasing order
+  const std::vector<id_t> & items( std::size_t color ) const
+  { return items_[color]; }
+
+private:
+
+  //! the color of each item
+  std::vector<std::size_t> color_;
+  //! the items of each color
+  std::vector< std::vector<id_t> > items_;
+
+};
+
+} // namespace
+} // namespace
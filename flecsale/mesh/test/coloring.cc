@@ -0,0 +1,100 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the coloring of mesh entities.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <array>
+#include <vector>
+
+// user includes
+#include <flecsale/mesh/coloring.h>
+
+using namespace flecsale::mesh;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Build the cells of each face of a structured quad mesh.
+//!
+//! The boundary faces only have one cell.
+///////////////////////////////////////////////////////////////////////////////
+std::vector< std::vector<std::size_t> > quad_faces( std::size_t nx, std::size_t ny )
+{
+  std::vector< std::vector<std::size_t> > faces;
+  auto cell = [=]( std::size_t i, std::size_t j ) { return i + nx*j; };
+  // the vertical faces
+  for ( std::size_t j=0; j<ny; ++j )
+    for ( std::size_t i=0; i<=nx; ++i ) {
+      faces.emplace_back();
+      if ( i > 0 ) faces.back().emplace_back( cell(i-1, j) );
+      if ( i < nx ) faces.back().emplace_back( cell(i, j) );
+    }
+  // the horizontal faces
+  for ( std::size_t j=0; j<=ny; ++j )
+    for ( std::size_t i=0; i<nx; ++i ) {
+      faces.emplace_back();
+      if ( j > 0 ) faces.back().emplace_back( cell(i, j-1) );
+      if ( j < ny ) faces.back().emplace_back( cell(i, j) );
+    }
+  return faces;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the faces of one color never share a cell
+///////////////////////////////////////////////////////////////////////////////
+TEST(coloring, faces) {
+
+  auto faces = quad_faces( 7, 5 );
+  coloring_t coloring;
+  ASSERT_FALSE( coloring.is_built() );
+  coloring.build( faces.size(), [&]( auto f ) { return faces[f]; } );
+  ASSERT_TRUE( coloring.is_built() );
+
+  // a cell has four faces
+  ASSERT_GE( coloring.num_colors(), 4 );
+  ASSERT_LE( coloring.num_colors(), 7 );
+
+  std::size_t num_items = 0;
+  for ( std::size_t color=0; color<coloring.num_colors(); ++color ) {
+    std::vector<bool> is_touched( 7*5, false );
+    for ( auto f : coloring.items(color) ) {
+      ASSERT_EQ( color, coloring.color(f) );
+      for ( auto c : faces[f] ) {
+        ASSERT_FALSE( is_touched[c] );
+        is_touched[c] = true;
+      }
+      ++num_items;
+    }
+  }
+  // every face has exactly one color
+  ASSERT_EQ( faces.size(), num_items );
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that independent items share one color
+///////////////////////////////////////////////////////////////////////////////
+TEST(coloring, independent) {
+
+  std::vector< std::array<std::size_t, 2> > pairs = { {0,1}, {2,3}, {4,5} };
+  coloring_t coloring;
+  coloring.build( pairs.size(), [&]( auto i ) { return pairs[i]; } );
+  ASSERT_EQ( 1, coloring.num_colors() );
+  ASSERT_EQ( 3, coloring.items(0).size() );
+
+  // a chain needs two colors
+  std::vector< std::array<std::size_t, 2> > chain = { {0,1}, {1,2}, {2,3} };
+  coloring.build( chain.size(), [&]( auto i ) { return chain[i]; } );
+  ASSERT_EQ( 2, coloring.num_colors() );
+  ASSERT_EQ( 0, coloring.color(0) );
+  ASSERT_EQ( 1, coloring.color(1) );
+  ASSERT_EQ( 0, coloring.color(2) );
+
+}
@@ -0,0 +1,221 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Parallel reductions whose results do not depend on the number of
+///        threads or ranks.
+///
+/// Floating point addition is not associative, so a sum split over threads
+/// or ranks changes in the last bits with their number.  Here the sums
+/// within a rank are split into chunks of a fixed size, summed in a fixed
+/// order whatever thread handles them.  Across ranks, the values are first
+/// rounded to a grid fixed by a global bound, so the partial sums are exact
+/// and can be added in any order (the pre-rounding of Demmel and Nguyen).
+/// Minima and maxima are exact in any order, only the location of ties has
+/// to be fixed.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace flecsale {
+namespace utils {
+
+//! the number of values summed by one chunk
+constexpr std::size_t reduction_chunk_size = 1024;
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Sum f(i) for i in [0,n), independently of the number of threads.
+//!
+//! Each chunk is summed with compensation, and the chunk sums are then
+//! added pairwise.
+//!
+//! \param [in] n  The number of values.
+//! \param [in] f  Return the i-th value.
+//! \param [in] chunk_size  The number of values per chunk.
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, typename F >
+T reproducible_sum(
+  std::size_t n, F && f, std::size_t chunk_size = reduction_chunk_size
+) {
+  if ( n == 0 ) return 0;
+  auto num_chunks = ( n + chunk_size - 1 ) / chunk_size;
+  std::vector<T> partial( num_chunks );
+
+  #pragma omp parallel for
+  for ( std::size_t k = 0; k < num_chunks; ++k ) {
+    auto end = std::min( n, (k+1) * chunk_size );
+    // Neumaier's variant of the Kahan summation
+    T sum = 0, comp = 0;
+    for ( auto i = k * chunk_size; i < end; ++i ) {
+      T x = f(i);
+      T t = sum + x;
+      if ( std::abs(sum) >= std::abs(x) )
+        comp += ( sum - t ) + x;
+      else
+        comp += ( x - t ) + sum;
+      sum = t;
+    }
+    partial[k] = sum + comp;
+  }
+
+  // add neighbours until one is left
+  for ( std::size_t stride = 1; stride < num_chunks; stride *= 2 )
+    for ( std::size_t k = 0; k + stride < num_chunks; k += 2*stride )
+      partial[k] += partial[k + stride];
+
+  return partial.front();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Find the smallest f(i) for i in [0,n) and its location.
+//!
+//! Of several equal values, the one with the lowest index is returned, so
+//! the location does not depend on the number of threads either.
+//!
+//! \param [in] n  The number of values.
+//! \param [in] f  Return the i-th value.
+//! \return the value and its index, or the largest value and n if n is 0
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, typename F >
+std::pair<T, std::size_t> reproducible_min_loc( std::size_t n, F && f )
+{
+  using result_t = std::pair<T, std::size_t>;
+  auto num_chunks =
+    ( n + reduction_chunk_size - 1 ) / reduction_chunk_size;
+  std::vector<result_t> partial(
+    num_chunks, result_t( std::numeric_limits<T>::max(), n ) );
+
+  #pragma omp parallel for
+  for ( std::size_t k = 0; k < num_chunks; ++k ) {
+    auto end = std::min( n, (k+1) * reduction_chunk_size );
+    auto & best = partial[k];
+    for ( auto i = k * reduction_chunk_size; i < end; ++i ) {
+      T x = f(i);
+      if ( x < best.first ) best = result_t( x, i );
+    }
+  }
+
+  // the chunks are visited in order, so the first tie is kept
+  result_t best( std::numeric_limits<T>::max(), n );
+  for ( const auto & p : partial )
+    if ( p.first < best.first ) best = p;
+  return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Find the smallest f(i) for i in [0,n).
+//! \return the smallest value, or the largest value of T if n is 0
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, typename F >
+T reproducible_min( std::size_t n, F && f )
+{ return reproducible_min_loc<T>( n, std::forward<F>(f) ).first; }
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Find the largest f(i) for i in [0,n).
+//! \return the largest value, or the lowest value of T if n is 0
+////////////////////////////////////////////////////////////////////////////////
+template< typename T, typename F >
+T reproducible_max( std::size_t n, F && f )
+{
+  auto neg = reproducible_min_loc<T>( n, [&]( std::size_t i ) { return -f(i); } );
+  return n == 0 ? std::numeric_limits<T>::lowest() : -neg.first;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief A sum that gives the same bits whatever the order of its terms.
+//!
+//! Given a bound on the magnitude of the terms and on their number, every
+//! term is split into a few folds, each rounded to a fixed grid coarse
+//! enough that any sum of the folds is exact.  Partial sums of the folds
+//! from different ranks can then be added in any order, for example by a
+//! sum reduction, and the folds are only combined at the end.
+//!
+//! Each fold keeps about 52-log2(n) bits, so three folds are more accurate
+//! than a plain sum in double precision.
+////////////////////////////////////////////////////////////////////////////////
+class folded_sum_t {
+
+public:
+
+  //! the number of folds
+  static constexpr int num_folds = 3;
+
+  //! the sum of each fold
+  using folds_t = std::array<double, num_folds>;
+
+  //! \brief Set up the grids.
+  //! \param [in] bound  The largest magnitude of any term, over all ranks.
+  //! \param [in] count  The number of terms, over all ranks.
+  folded_sum_t( double bound, double count )
+  {
+    if ( !( bound > 0 ) || !( count > 0 ) ) return;
+    int bound_exp, count_exp;
+    std::frexp( bound, &bound_exp );
+    std::frexp( count, &count_exp );
+    // the sum of all the folds stays below half the grid extent
+    auto exp = bound_exp + count_exp + 1;
+    for ( auto & s : shift_ ) {
+      s = std::ldexp( 1.5, exp );
+      exp -= std::numeric_limits<double>::digits - count_exp - 1;
+    }
+    enabled_ = true;
+  }
+
+  //! \brief Split a term into its folds, and add them.
+  //! \param [in] x  The term.
+  //! \param [in,out] folds  The sum of the folds.
+  void add( double x, folds_t & folds ) const
+  {
+    if ( !enabled_ ) return;
+    for ( int k = 0; k < num_folds; ++k ) {
+      // round to the grid, the remainder is exact
+      double q = ( shift_[k] + x ) - shift_[k];
+      folds[k] += q;
+      x -= q;
+    }
+  }
+
+  //! \brief the part of a term in one fold
+  double fold( double x, int k ) const
+  {
+    if ( !enabled_ ) return 0;
+    double q = 0;
+    for ( int i = 0; i <= k; ++i ) {
+      q = ( shift_[i] + x ) - shift_[i];
+      x -= q;
+    }
+    return q;
+  }
+
+  //! \brief Combine the folds, smallest first.
+  static double result( const folds_t & folds )
+  {
+    double sum = 0;
+    for ( int k = num_folds - 1; k >= 0; --k ) sum += folds[k];
+    return sum;
+  }
+
+private:
+
+  //! the grid of each fold is set by the unit in the last place of these
+  std::array<double, num_folds> shift_ = {};
+  //! false if all terms are zero
+  bool enabled_ = false;
+
+};
+
+} // namespace
+} // namespace
@@ -0,0 +1,132 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the reproducible reductions.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+// user includes
+#include <flecsale/utils/reduction.h>
+
+using namespace flecsale::utils;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Values of very different magnitudes, so the order matters.
+///////////////////////////////////////////////////////////////////////////////
+std::vector<double> make_values( std::size_t n )
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> mantissa( -1, 1 );
+  std::uniform_int_distribution<int> exponent( -20, 20 );
+  std::vector<double> values( n );
+  for ( auto & x : values ) x = std::ldexp( mantissa(gen), exponent(gen) );
+  return values;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the chunked sum does not depend on the thread count
+///////////////////////////////////////////////////////////////////////////////
+TEST(reduction, sum) {
+
+  auto values = make_values( 10000 );
+  auto f = [&]( std::size_t i ) { return values[i]; };
+
+  auto sum = reproducible_sum<double>( values.size(), f );
+
+#ifdef _OPENMP
+  for ( int num_threads : {1, 2, 3, 7} ) {
+    omp_set_num_threads( num_threads );
+    ASSERT_EQ( sum, reproducible_sum<double>( values.size(), f ) );
+  }
+#endif
+
+  // compare with a sum in long double
+  long double exact = 0;
+  for ( auto x : values ) exact += x;
+  ASSERT_NEAR( static_cast<double>(exact), sum, 1.e-9 );
+
+  ASSERT_EQ( 0, reproducible_sum<double>( 0, f ) );
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that ties are resolved to the lowest index
+///////////////////////////////////////////////////////////////////////////////
+TEST(reduction, min_max) {
+
+  std::vector<double> values( 5000, 1 );
+  values[1234] = values[4321] = -2;
+  values[2000] = values[3000] = 5;
+  auto f = [&]( std::size_t i ) { return values[i]; };
+
+  auto loc = reproducible_min_loc<double>( values.size(), f );
+  ASSERT_EQ( -2, loc.first );
+  ASSERT_EQ( 1234, loc.second );
+  ASSERT_EQ( -2, reproducible_min<double>( values.size(), f ) );
+  ASSERT_EQ( 5, reproducible_max<double>( values.size(), f ) );
+
+  ASSERT_EQ( 0, reproducible_min_loc<double>( 0, f ).second );
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that the folded sum does not depend on the partition or order
+///////////////////////////////////////////////////////////////////////////////
+TEST(reduction, folded_sum) {
+
+  auto values = make_values( 10000 );
+  double bound = 0;
+  for ( auto x : values ) bound = std::max( bound, std::abs(x) );
+  folded_sum_t folder( bound, values.size() );
+
+  // split the terms over a number of "ranks", sum each, and then add the
+  // ranks in reverse order
+  auto sum_over = [&]( std::size_t num_ranks ) {
+    std::vector<folded_sum_t::folds_t> ranks( num_ranks, folded_sum_t::folds_t{} );
+    for ( std::size_t i=0; i<values.size(); ++i )
+      folder.add( values[i], ranks[ (i * 7919) % num_ranks ] );
+    folded_sum_t::folds_t total = {};
+    for ( auto r = ranks.rbegin(); r != ranks.rend(); ++r )
+      for ( int k=0; k<folded_sum_t::num_folds; ++k ) total[k] += (*r)[k];
+    return folded_sum_t::result( total );
+  };
+
+  auto sum = sum_over( 1 );
+  for ( std::size_t num_ranks : {2, 3, 16, 100} )
+    ASSERT_EQ( sum, sum_over( num_ranks ) );
+
+  long double exact = 0;
+  for ( auto x : values ) exact += x;
+  ASSERT_NEAR( static_cast<double>(exact), sum, 1.e-9 );
+
+  // the folds of one term add up to the term
+  for ( auto x : { values[0], values[1] } ) {
+    double total = 0;
+    for ( int k=folded_sum_t::num_folds-1; k>=0; --k )
+      total += folder.fold( x, k );
+    ASSERT_EQ( x, total );
+  }
+
+  // all zero terms
+  folded_sum_t zero( 0, 10 );
+  folded_sum_t::folds_t folds = {};
+  zero.add( 0, folds );
+  ASSERT_EQ( 0, folded_sum_t::result( folds ) );
+
+}
@@ -0,0 +1,73 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief Tests related to the work stealing loop.
+///
+////////////////////////////////////////////////////////////////////////////////
+
+// system includes
+#include <cinchtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+// user includes
+#include <flecsale/utils/work_stealing.h>
+
+using namespace flecsale::utils;
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test that every iteration runs exactly once
+///////////////////////////////////////////////////////////////////////////////
+TEST(work_stealing, coverage) {
+
+  for ( std::size_t n : {0, 1, 63, 64, 65, 1000, 12345} ) {
+    for ( std::size_t chunk_size : {1, 7, 64, 5000} ) {
+      std::vector< std::atomic<int> > count( n );
+      for ( auto & c : count ) c = 0;
+      work_stealing_for( n, [&]( std::size_t i ) { ++count[i]; }, chunk_size );
+      for ( std::size_t i = 0; i < n; ++i )
+        ASSERT_EQ( 1, count[i] ) << "n = " << n << ", chunk = " << chunk_size;
+    }
+  }
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//! \brief Test an uneven loop, where all the work sits in the first block
+///////////////////////////////////////////////////////////////////////////////
+TEST(work_stealing, uneven) {
+
+  constexpr std::size_t n = 4000;
+  std::vector<double> result( n, 0 );
+
+  auto body = [&]( std::size_t i ) {
+    auto reps = i < n/8 ? 2000 : 1;
+    double x = i;
+    for ( int r = 0; r < reps; ++r ) x = std::sqrt( x + r );
+    result[i] = x;
+  };
+
+#ifdef _OPENMP
+  for ( int num_threads : {1, 2, 3, 7} ) {
+    omp_set_num_threads( num_threads );
+    std::fill( result.begin(), result.end(), 0 );
+    work_stealing_for( n, body, 4 );
+    for ( std::size_t i = 0; i < n; ++i ) ASSERT_GT( result[i], 0 );
+  }
+#else
+  work_stealing_for( n, body, 4 );
+  for ( std::size_t i = 0; i < n; ++i ) ASSERT_GT( result[i], 0 );
+#endif
+
+}
@@ -0,0 +1,130 @@
+/*~-------------------------------------------------------------------------~~*
+ * Copyright (c) 2016 Los Alamos National Laboratory, LLC
+ * All rights reserved
+ *~-------------------------------------------------------------------------~~*/
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \file
+///
+/// \brief A parallel loop that balances irregular work with stealing.
+///
+/// The iterations are grouped into chunks, and every thread starts with a
+/// contiguous block of chunks, the same block a static schedule would give
+/// it, so the pages placed by a parallel first touch start out local.  A
+/// thread takes its chunks from the front of its block.  Once it runs out,
+/// it steals the back half of the chunks left to another thread, so the
+/// threads only meet when the work is uneven.  The stolen chunks may sit on
+/// another socket, which is the price of the balance.
+///
+////////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+namespace flecsale {
+namespace utils {
+
+//! the default number of iterations per chunk
+constexpr std::size_t work_stealing_chunk_size = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+//! \brief Call f(i) for i in [0,n), balancing the threads by stealing.
+//!
+//! The calls of f must be independent, since they run in any order.  Small
+//! chunks balance better and large chunks lock less, so the chunk size is
+//! best picked per loop from the cost of one iteration.
+//!
+//! \param [in] n  The number of iterations.
+//! \param [in] f  The loop body, called with the iteration number.
+//! \param [in] chunk_size  The number of iterations per chunk.
+////////////////////////////////////////////////////////////////////////////////
+template< typename F >
+void work_stealing_for(
+  std::size_t n, F && f, std::size_t chunk_size = work_stealing_chunk_size
+) {
+  if ( n == 0 ) return;
+  chunk_size = std::max<std::size_t>( chunk_size, 1 );
+  auto num_chunks = ( n + chunk_size - 1 ) / chunk_size;
+
+  auto run_chunk = [&]( std::size_t k ) {
+    auto end = std::min( n, (k+1) * chunk_size );
+    for ( auto i = k * chunk_size; i < end; ++i ) f(i);
+  };
+
+#ifdef _OPENMP
+
+  // the chunks left to one thread, padded to their own cache line
+  struct alignas(64) queue_t {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+  };
+
+  std::size_t num_queues = omp_get_max_threads();
+  std::vector<queue_t> queues( num_queues );
+  for ( std::size_t t = 0; t < num_queues; ++t ) {
+    queues[t].begin = num_chunks * t / num_queues;
+    queues[t].end = num_chunks * (t+1) / num_queues;
+  }
+
+  #pragma omp parallel
+  {
+    // if fewer threads start, their blocks are left to be stolen
+    std::size_t me = omp_get_thread_num();
+    auto & mine = queues[me];
+
+    // take chunks from the front of my block until it is empty
+    auto drain = [&]() {
+      while ( true ) {
+        std::size_t k;
+        {
+          std::lock_guard<std::mutex> lock( mine.mutex );
+          if ( mine.begin == mine.end ) return;
+          k = mine.begin++;
+        }
+        run_chunk( k );
+      }
+    };
+
+    // move the back half of another block into mine
+    auto steal = [&]() {
+      for ( std::size_t s = 1; s < num_queues; ++s ) {
+        auto & victim = queues[ (me + s) % num_queues ];
+        std::size_t begin, end;
+        {
+          std::lock_guard<std::mutex> lock( victim.mutex );
+          auto left = victim.end - victim.begin;
+          if ( left == 0 ) continue;
+          end = victim.end;
+          begin = end - ( left + 1 ) / 2;
+          victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock( mine.mutex );
+        mine.begin = begin;
+        mine.end = end;
+        return true;
+      }
+      // every block is empty, the chunks being run are all that is left
+      return false;
+    };
+
+    do { drain(); } while ( steal() );
+  }
+
+#else
+
+  for ( std::size_t k = 0; k < num_chunks; ++k ) run_chunk( k );
+
+#endif
+}
+
+} // namespace
+} // namespace